@@ -0,0 +1,282 @@
+/**     @file AssemblyGenerator.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Procedural STL parts and assemblies for stress testing.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "AssemblyGenerator.h"
+#include "AssemblyManifest.h"
+#include "JobSystem.h"
+
+#include <QDir>
+
+#include <vtkAppendPolyData.h>
+#include <vtkCylinderSource.h>
+#include <vtkLinearSubdivisionFilter.h>
+#include <vtkNew.h>
+#include <vtkReverseSense.h>
+#include <vtkSphereSource.h>
+#include <vtkSTLWriter.h>
+#include <vtkTessellatedBoxSource.h>
+#include <vtkTriangleFilter.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+
+/* vtkSphereSource clamps both resolutions to VTK_MAX_SPHERE_RESOLUTION, which is about 2M triangles */
+static const qint64 maxSphereTriangles = 2ll * VTK_MAX_SPHERE_RESOLUTION * (VTK_MAX_SPHERE_RESOLUTION - 1);
+
+/*!
+ * \brief subdivisions
+ * \return how many times a mesh must be split into four to reach triangles without starting above most
+ */
+static int subdivisions(qint64 triangles, qint64 most) {
+    int passes = 0;
+    for (; triangles > most; triangles /= 4)
+        passes++;
+    return passes;
+}
+
+/*!
+ * \brief subdivided
+ * Splits every triangle into four, passes times. The new points lie on the old triangles, which at the
+ * sphere source's finest resolution is far below what can be seen.
+ */
+static vtkSmartPointer<vtkPolyData> subdivided(vtkAlgorithmOutput* input, int passes) {
+    vtkNew<vtkLinearSubdivisionFilter> subdivide;
+    subdivide->SetInputConnection(input);
+    subdivide->SetNumberOfSubdivisions(passes);
+    subdivide->Update();
+    return subdivide->GetOutput();
+}
+
+/*!
+ * \brief AssemblyGenerator::sphere
+ * A UV sphere with resolution r in both directions has 2r(r - 1) triangles. Past the largest resolution
+ * a coarser sphere is subdivided.
+ */
+vtkSmartPointer<vtkPolyData> AssemblyGenerator::sphere(qint64 triangles, double radius) {
+    int passes = subdivisions(triangles, maxSphereTriangles);
+    qint64 base = triangles >> (2 * passes);
+    int resolution = std::max(8, (int)std::lround(std::sqrt(base / 2.0)) + 1);
+    vtkNew<vtkSphereSource> source;
+    source->SetRadius(radius);
+    source->SetThetaResolution(resolution);
+    source->SetPhiResolution(resolution);
+    if (passes > 0)
+        return subdivided(source->GetOutputPort(), passes);
+    source->Update();
+    return source->GetOutput();
+}
+
+/*!
+ * \brief AssemblyGenerator::block
+ * Most of the triangles go on the box, whose faces are split into an even grid like a CAD export
+ * of a flat face, the rest go round the boss
+ */
+vtkSmartPointer<vtkPolyData> AssemblyGenerator::block(qint64 triangles, double size) {
+    /* The boss side has two triangles per facet and each cap about one. vtkCylinderSource clamps
+       its resolution to VTK_CELL_SIZE, so the box takes whatever the boss cannot. */
+    int facets = (int)std::clamp<qint64>((qint64)(triangles * 0.2 / 4.0), 8, VTK_CELL_SIZE);
+
+    /* Each face of a box at level L has 2(L + 1)^2 triangles */
+    qint64 boxTriangles = std::max<qint64>(12, triangles - 4 * facets);
+    int level = std::max(0, (int)std::lround(std::sqrt(boxTriangles / 12.0)) - 1);
+    vtkNew<vtkTessellatedBoxSource> box;
+    box->SetBounds(0., size, 0., 0.4 * size, 0., 0.6 * size);
+    box->SetLevel(level);
+    box->QuadsOff();
+
+    vtkNew<vtkCylinderSource> boss;
+    boss->SetResolution(facets);
+    boss->SetRadius(0.15 * size);
+    boss->SetHeight(0.2 * size);
+    boss->SetCenter(0.5 * size, 0.5 * size, 0.3 * size);
+    boss->CappingOn();
+
+    vtkNew<vtkAppendPolyData> append;
+    append->AddInputConnection(box->GetOutputPort());
+    append->AddInputConnection(boss->GetOutputPort());
+    vtkNew<vtkTriangleFilter> triangulate;
+    triangulate->SetInputConnection(append->GetOutputPort());
+    triangulate->Update();
+    return triangulate->GetOutput();
+}
+
+/*!
+ * \brief AssemblyGenerator::shell
+ * Two hemispheres 2% of the radius apart, the inner one turned inside out so the normals point out of
+ * the wall. Thin walls like this are the hardest case for clipping and depth precision.
+ */
+vtkSmartPointer<vtkPolyData> AssemblyGenerator::shell(qint64 triangles, double radius) {
+    /* Holding both hemispheres together under the sphere limit keeps each one well inside it */
+    int passes = subdivisions(triangles, maxSphereTriangles);
+    qint64 base = triangles >> (2 * passes);
+    int resolution = std::max(8, (int)std::lround(std::sqrt(base / 4.0)));
+
+    vtkNew<vtkSphereSource> outer;
+    outer->SetRadius(radius);
+    outer->SetThetaResolution(resolution);
+    outer->SetPhiResolution(resolution);
+    outer->SetEndPhi(90.);
+
+    vtkNew<vtkSphereSource> inner;
+    inner->SetRadius(radius * 0.98);
+    inner->SetThetaResolution(resolution);
+    inner->SetPhiResolution(resolution);
+    inner->SetEndPhi(90.);
+    vtkNew<vtkReverseSense> flip;
+    flip->SetInputConnection(inner->GetOutputPort());
+
+    vtkNew<vtkAppendPolyData> append;
+    append->AddInputConnection(outer->GetOutputPort());
+    append->AddInputConnection(flip->GetOutputPort());
+    if (passes > 0)
+        return subdivided(append->GetOutputPort(), passes);
+    append->Update();
+    return append->GetOutput();
+}
+
+bool AssemblyGenerator::parseShape(const QString& name, Shape* shape) {
+    QString lower = name.trimmed().toLower();
+    if (lower == "sphere")
+        *shape = Sphere;
+    else if (lower == "block")
+        *shape = Block;
+    else if (lower == "shell")
+        *shape = Shell;
+    else
+        return false;
+    return true;
+}
+
+/*!
+ * \brief addItems
+ * Splits the parts into at most branching sub-assemblies, recursively, until a sub-assembly is small
+ * enough to hold its parts directly
+ * \param nodes receives the items in tree order
+ * \param partFiles the file index used by each part
+ * \param first the first part to add
+ * \param count the number of parts to add
+ * \param depth the depth of the items
+ * \param branching the most items in one sub-assembly
+ */
+static void addItems(QList<AssemblyManifest::Node>& nodes, const std::vector<qint64>& partFiles,
+                     qint64 first, qint64 count, int depth, int branching) {
+    if (count <= branching) {
+        for (qint64 i = first; i < first + count; i++) {
+            AssemblyManifest::Node node;
+            node.name = QString("Part %1").arg(i, 6, 10, QChar('0'));
+            node.file = QString("parts/part_%1.stl").arg(partFiles[i], 6, 10, QChar('0'));
+            node.depth = depth;
+            nodes.append(node);
+        }
+        return;
+    }
+
+    qint64 perGroup = (count + branching - 1) / branching;
+    for (qint64 start = first; start < first + count; start += perGroup) {
+        AssemblyManifest::Node group;
+        group.name = QString("Assembly %1").arg(start, 6, 10, QChar('0'));
+        group.depth = depth;
+        nodes.append(group);
+        addItems(nodes, partFiles, start, std::min(perGroup, first + count - start), depth + 1, branching);
+    }
+}
+
+/*!
+ * \brief AssemblyGenerator::generate
+ * The size and shape of every file and the file used by every part are drawn from the seed first, then the
+ * files are built and written on the JobSystem workers.
+ * \param options what to generate
+ * \param error receives the reason if it failed
+ * \return what was written
+ */
+AssemblyGenerator::Result AssemblyGenerator::generate(const Options& options, QString* error) {
+    Result result;
+    QDir dir(options.outputDir);
+    if (options.parts < 1 || options.shapes.isEmpty() || !dir.mkpath("parts")) {
+        if (error)
+            *error = QString("Cannot write to %1").arg(options.outputDir);
+        return result;
+    }
+
+    double duplication = std::clamp(options.duplication, 0., 1.);
+    qint64 unique = std::max<qint64>(1, std::llround(options.parts * (1. - duplication)));
+
+    struct FileSpec {
+        Shape shape;
+        qint64 triangles;
+        double size;
+    };
+    std::mt19937 random(options.seed);
+    std::uniform_real_distribution<double> spread(0.5, 1.5);
+    std::uniform_real_distribution<double> sizes(5., 50.);
+    std::vector<FileSpec> specs((size_t)unique);
+    for (FileSpec& spec : specs) {
+        spec.shape = options.shapes[(int)(random() % options.shapes.size())];
+        spec.triangles = std::max<qint64>(12, (qint64)(options.triangles * spread(random)));
+        spec.size = sizes(random);
+    }
+
+    /* The first parts use each file once, the duplicates are spread at random over them */
+    std::vector<qint64> partFiles((size_t)options.parts);
+    std::uniform_int_distribution<qint64> pick(0, unique - 1);
+    for (qint64 i = 0; i < options.parts; i++)
+        partFiles[i] = i < unique ? i : pick(random);
+
+    std::vector<qint64> written((size_t)unique, 0);
+    std::atomic<bool> failed(false);
+    for (qint64 i = 0; i < unique; i++) {
+        JobSystem::instance().submit([&, i]() {
+            const FileSpec& spec = specs[i];
+            vtkSmartPointer<vtkPolyData> polyData;
+            if (spec.shape == Sphere)
+                polyData = sphere(spec.triangles, spec.size);
+            else if (spec.shape == Block)
+                polyData = block(spec.triangles, spec.size);
+            else
+                polyData = shell(spec.triangles, spec.size);
+
+            QString fileName = dir.filePath(QString("parts/part_%1.stl").arg(i, 6, 10, QChar('0')));
+            vtkNew<vtkSTLWriter> writer;
+            writer->SetInputData(polyData);
+            writer->SetFileName(fileName.toLocal8Bit());
+            if (options.binary)
+                writer->SetFileTypeToBinary();
+            else
+                writer->SetFileTypeToASCII();
+            if (!writer->Write())
+                failed = true;
+            written[i] = polyData->GetNumberOfPolys();
+        }, JobPriority::Normal);
+    }
+    JobSystem::instance().waitForIdle();
+    if (failed) {
+        if (error)
+            *error = QString("Cannot write the parts in %1").arg(dir.filePath("parts"));
+        return result;
+    }
+
+    QList<AssemblyManifest::Node> nodes;
+    addItems(nodes, partFiles, 0, options.parts, 0, std::max(2, options.branching));
+    QString manifest = dir.filePath("assembly.txt");
+    if (!AssemblyManifest::write(manifest, nodes)) {
+        if (error)
+            *error = QString("Cannot write %1").arg(manifest);
+        return result;
+    }
+
+    result.manifest = manifest;
+    result.uniqueFiles = unique;
+    for (qint64 triangles : written)
+        result.uniqueTriangles += triangles;
+    for (qint64 file : partFiles)
+        result.totalTriangles += written[file];
+    return result;
+}
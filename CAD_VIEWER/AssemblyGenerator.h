@@ -0,0 +1,92 @@
+/**     @file AssemblyGenerator.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Procedural STL parts and assemblies for stress testing, used by the
+  *     WS6Generate tool.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_ASSEMBLYGENERATOR_H
+#define VIEWER_ASSEMBLYGENERATOR_H
+
+#include <QString>
+#include <QStringList>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+/*! \class AssemblyGenerator
+ *  \brief Writes a tree of procedural parts and the manifest to open it with.
+ *  Parts are spheres, finely tessellated blocks with a cylindrical boss (like a machined part) or thin
+ *  open shells, each built to roughly the triangle count asked for. Duplicated parts point at the same
+ *  STL file, as repeated fasteners do in a real assembly, so the duplication ratio sets how many unique
+ *  files are written. The parts are grouped into sub-assemblies of at most branching items.
+ */
+class AssemblyGenerator {
+public:
+    /*! Shapes the parts are made from */
+    enum Shape { Sphere, Block, Shell };
+
+    /*! What to generate */
+    struct Options {
+        QString outputDir;                  /*!< The manifest and a parts directory are written here */
+        qint64 parts = 100;                 /*!< Parts in the assembly */
+        qint64 triangles = 10000;           /*!< Average triangles per part */
+        double duplication = 0.;            /*!< Fraction of parts that reuse another part's file, 0 - 1 */
+        int branching = 10;                 /*!< Most items in one sub-assembly */
+        QList<Shape> shapes = { Sphere, Block, Shell };
+        bool binary = true;                 /*!< Binary or ASCII STL */
+        quint32 seed = 1;                   /*!< Seed for the sizes and shapes, the same seed gives the same files */
+    };
+
+    /*! What was generated */
+    struct Result {
+        QString manifest;
+        qint64 uniqueFiles = 0;
+        qint64 uniqueTriangles = 0;         /*!< Triangles written to disk */
+        qint64 totalTriangles = 0;          /*!< Triangles in the assembly, counting duplicates */
+    };
+
+    /*!
+     * \brief sphere
+     * \param triangles the triangles wanted
+     * \param radius the radius
+     * \return a closed sphere
+     */
+    static vtkSmartPointer<vtkPolyData> sphere(qint64 triangles, double radius);
+
+    /*!
+     * \brief block
+     * \param triangles the triangles wanted
+     * \param size the length of the block, it is 60% as wide and 40% as high
+     * \return a tessellated box with a cylindrical boss on top
+     */
+    static vtkSmartPointer<vtkPolyData> block(qint64 triangles, double size);
+
+    /*!
+     * \brief shell
+     * \param triangles the triangles wanted
+     * \param radius the outer radius
+     * \return half a sphere with a thin wall, open at the bottom
+     */
+    static vtkSmartPointer<vtkPolyData> shell(qint64 triangles, double radius);
+
+    /*!
+     * \brief parseShape
+     * \param name sphere, block or shell
+     * \param shape receives the shape
+     * \return true if the name was known
+     */
+    static bool parseShape(const QString& name, Shape* shape);
+
+    /*!
+     * \brief generate writes the parts and the manifest
+     * \param options what to generate
+     * \param error receives the reason if it failed, may be null
+     * \return what was written, the manifest is empty on failure
+     */
+    static Result generate(const Options& options, QString* error = nullptr);
+};
+
+#endif
@@ -0,0 +1,92 @@
+/**     @file AssemblyManifest.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Reads and writes the .txt assembly files.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "AssemblyManifest.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include <algorithm>
+
+/*!
+ * \brief AssemblyManifest::read
+ * A line indented deeper than one level below the line before it is treated as a child of that line,
+ * so a badly indented file still gives a valid tree.
+ * \param fileName the manifest file
+ * \param error receives the reason if it could not be read
+ * \return the items
+ */
+QList<AssemblyManifest::Node> AssemblyManifest::read(const QString& fileName, QString* error) {
+    QList<Node> nodes;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error)
+            *error = QString("Cannot open %1").arg(fileName);
+        return nodes;
+    }
+
+    QDir dir = QFileInfo(fileName).absoluteDir();
+    QTextStream in(&file);
+    int previousDepth = -1;
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        QString trimmed = line.trimmed();
+        if (trimmed.isEmpty() || trimmed.startsWith('#'))
+            continue;
+
+        int indent = 0;
+        while (indent < line.size() && line[indent] == ' ')
+            indent++;
+
+        Node node;
+        node.depth = std::min(indent / 2, previousDepth + 1);
+        previousDepth = node.depth;
+
+        int tab = trimmed.indexOf('\t');
+        if (tab >= 0) {
+            node.name = trimmed.left(tab).trimmed();
+            node.file = trimmed.mid(tab + 1).trimmed();
+        }
+        else if (trimmed.endsWith(".stl", Qt::CaseInsensitive)) {
+            node.file = trimmed;
+            node.name = QFileInfo(trimmed).fileName();
+        }
+        else
+            node.name = trimmed;
+
+        if (!node.file.isEmpty() && QDir::isRelativePath(node.file))
+            node.file = dir.filePath(node.file);
+        nodes.append(node);
+    }
+    return nodes;
+}
+
+/*!
+ * \brief AssemblyManifest::write
+ * \param fileName the manifest file
+ * \param nodes the items in tree order
+ * \return true if the file was written
+ */
+bool AssemblyManifest::write(const QString& fileName, const QList<Node>& nodes) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+        return false;
+
+    QTextStream out(&file);
+    out << "# WS6 assembly: name<tab>file.stl for a part, a name alone for a group, two spaces per level\n";
+    for (const Node& node : nodes) {
+        out << QString(node.depth * 2, ' ') << node.name;
+        if (!node.file.isEmpty())
+            out << '\t' << node.file;
+        out << '\n';
+    }
+    return out.status() == QTextStream::Ok;
+}
@@ -0,0 +1,49 @@
+/**     @file AssemblyManifest.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Reads and writes the .txt assembly files opened by the viewer and WS6Batch
+  *     and written by WS6Generate.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_ASSEMBLYMANIFEST_H
+#define VIEWER_ASSEMBLYMANIFEST_H
+
+#include <QList>
+#include <QString>
+
+/*! \class AssemblyManifest
+ *  \brief Text description of a tree of parts.
+ *  Each line is one tree item, indented by two spaces per level below its parent. A line is either
+ *  "name<tab>file.stl" for a part, a bare "file.stl" for a part named after its file, or just a name
+ *  for a group. Blank lines and lines starting with # are skipped, and relative file names are taken
+ *  from the manifest's directory. A plain list of STL files is therefore a flat assembly.
+ */
+class AssemblyManifest {
+public:
+    /*! One item of the tree, in the order it appears in the file */
+    struct Node {
+        QString name;
+        QString file;       /*!< STL file, empty for a group */
+        int depth = 0;      /*!< 0 for the top level */
+    };
+
+    /*!
+     * \brief read parses a manifest
+     * \param fileName the manifest file
+     * \param error receives the reason if it could not be read, may be null
+     * \return the items in file order with absolute file names, empty on error
+     */
+    static QList<Node> read(const QString& fileName, QString* error = nullptr);
+
+    /*!
+     * \brief write writes a manifest, file names are written as given
+     * \param fileName the manifest file
+     * \param nodes the items in tree order
+     * \return true if the file was written
+     */
+    static bool write(const QString& fileName, const QList<Node>& nodes);
+};
+
+#endif
@@ -0,0 +1,287 @@
+/**     @file BatchRunner.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Headless batch processing for the WS6Batch tool.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "BatchRunner.h"
+#include "JobSystem.h"
+#include "AssemblyManifest.h"
+#include "Trace.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+#include <vtkCamera.h>
+#include <vtkExtractVOI.h>
+#include <vtkNew.h>
+#include <vtkPNGWriter.h>
+#include <vtkProperty.h>
+#include <vtkRenderWindow.h>
+#include <vtkWindowToImageFilter.h>
+
+#include <algorithm>
+#include <cstdio>
+
+/*!
+ * \brief elapsedMs
+ * \param timer a started timer
+ * \return the time since the timer was started in milliseconds
+ */
+static double elapsedMs(const QElapsedTimer& timer) {
+    return timer.nsecsElapsed() / 1.0e6;
+}
+
+/*!
+ * \brief BatchRunner::BatchRunner
+ * Constructor
+ * \param options the settings for the batch
+ */
+BatchRunner::BatchRunner(const Options& options)
+    : options(options), out(stdout) {
+}
+
+/*!
+ * \brief BatchRunner::~BatchRunner
+ * Destructor
+ */
+BatchRunner::~BatchRunner() {
+    for (Entry& entry : entries)
+        ModelPart::destroy(entry.part);
+}
+
+/*!
+ * \brief BatchRunner::expandInputs
+ * A .txt input is an assembly manifest, every part in it with a file is loaded and the groups are ignored
+ * \return the STL files to load
+ */
+QStringList BatchRunner::expandInputs() const {
+    QStringList files;
+    for (const QString& input : options.inputs) {
+        if (QFileInfo(input).suffix().toLower() != "txt") {
+            files.append(input);
+            continue;
+        }
+
+        QString error;
+        QList<AssemblyManifest::Node> nodes = AssemblyManifest::read(input, &error);
+        if (!error.isEmpty())
+            fprintf(stderr, "%s\n", qPrintable(error));
+        for (const AssemblyManifest::Node& node : nodes)
+            if (!node.file.isEmpty())
+                files.append(node.file);
+    }
+    return files;
+}
+
+/*!
+ * \brief BatchRunner::process
+ * Reads the file and runs the clip stages, called on a worker. With repeat set above one the clip stages
+ * are run that many times and the mean time is kept.
+ * \param entry the file to process, its timings are filled in
+ */
+void BatchRunner::process(Entry& entry) const {
+    QElapsedTimer timer;
+    timer.start();
+    entry.source = ModelPart::readSTLFile(entry.fileName);
+    entry.readMs = elapsedMs(timer);
+    if (entry.source->GetNumberOfPolys() == 0)
+        return;
+
+    int repeat = std::max(1, options.repeat);
+    for (int i = 0; i < repeat; i++) {
+        timer.restart();
+        entry.clipStage = ModelPart::computeClipPlanes(entry.source, options.clip);
+        entry.clipMs += elapsedMs(timer);
+
+        timer.restart();
+        entry.clipped = ModelPart::computeShrink(entry.clipStage, options.clip.size);
+        entry.shrinkMs += elapsedMs(timer);
+    }
+    entry.clipMs /= repeat;
+    entry.shrinkMs /= repeat;
+}
+
+/*!
+ * \brief BatchRunner::render
+ * Renders the renderer's props and writes the image. If the image is bigger than MaxTileSize the window is
+ * made smaller and the image is put together from several renders, then cropped to the exact size asked for.
+ * \param renderer the renderer to draw, it must already be in an offscreen window
+ * \param fileName the PNG file to write
+ * \param renderMs receives the time for the first render
+ * \param writeMs receives the time to read back the image and write the file
+ * \return true if the file was written
+ */
+bool BatchRunner::render(vtkRenderer* renderer, const QString& fileName, double* renderMs, double* writeMs) {
+    TRACE_ZONE("renderPNG");
+    vtkRenderWindow* window = renderer->GetRenderWindow();
+    int tiles = (std::max(options.width, options.height) + MaxTileSize - 1) / MaxTileSize;
+    window->SetSize((options.width + tiles - 1) / tiles, (options.height + tiles - 1) / tiles);
+
+    // Start every render from the same view, ResetCamera() keeps the view direction so the rotation would add up
+    vtkCamera* camera = renderer->GetActiveCamera();
+    camera->SetPosition(0., 0., 1.);
+    camera->SetFocalPoint(0., 0., 0.);
+    camera->SetViewUp(0., 1., 0.);
+    renderer->ResetCamera();
+    camera->Azimuth(30);
+    camera->Elevation(30);
+    camera->OrthogonalizeViewUp();
+    renderer->ResetCameraClippingRange();
+
+    QElapsedTimer timer;
+    timer.start();
+    window->Render();
+    *renderMs = elapsedMs(timer);
+
+    timer.restart();
+    vtkNew<vtkWindowToImageFilter> capture;
+    capture->SetInput(window);
+    capture->SetScale(tiles, tiles);
+    capture->ReadFrontBufferOff();
+    capture->Update();
+
+    vtkNew<vtkExtractVOI> crop;
+    crop->SetInputConnection(capture->GetOutputPort());
+    crop->SetVOI(0, options.width - 1, 0, options.height - 1, 0, 0);
+
+    vtkNew<vtkPNGWriter> writer;
+    writer->SetInputConnection(crop->GetOutputPort());
+    writer->SetFileName(fileName.toLocal8Bit());
+    writer->Write();
+    *writeMs = elapsedMs(timer);
+
+    if (writer->GetErrorCode() != 0) {
+        fprintf(stderr, "Cannot write %s\n", qPrintable(fileName));
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief BatchRunner::printEntry
+ * Prints one line with the triangle count and stage times of a file
+ * \param entry the file
+ */
+void BatchRunner::printEntry(const Entry& entry) {
+    vtkIdType triangles = entry.source ? entry.source->GetNumberOfPolys() : 0;
+    out << QString("%1 triangles=%2 read=%3ms clip=%4ms shrink=%5ms")
+               .arg(QFileInfo(entry.fileName).fileName())
+               .arg(triangles)
+               .arg(entry.readMs, 0, 'f', 2)
+               .arg(entry.clipMs, 0, 'f', 2)
+               .arg(entry.shrinkMs, 0, 'f', 2);
+    if (!options.thumbnailDir.isEmpty())
+        out << QString(" render=%1ms write=%2ms").arg(entry.renderMs, 0, 'f', 2).arg(entry.writeMs, 0, 'f', 2);
+    out << Qt::endl;
+}
+
+/*!
+ * \brief BatchRunner::run
+ * Loads and clips every file on the workers, then gives each part its geometry and renders the images
+ * on this thread. The totals at the end give the throughput of the whole batch.
+ * \return the exit code
+ */
+int BatchRunner::run() {
+    QStringList files = expandInputs();
+    if (files.isEmpty()) {
+        fprintf(stderr, "No STL files to process\n");
+        return 1;
+    }
+
+    QElapsedTimer total;
+    total.start();
+
+    /* 1. Read and clip on the workers, each job only writes to its own entry */
+    entries.clear();
+    entries.reserve(files.size());
+    for (const QString& fileName : files) {
+        Entry entry;
+        entry.fileName = fileName;
+        entries.append(entry);
+    }
+    for (Entry& entry : entries)
+        JobSystem::instance().submit([this, &entry]() { process(entry); }, JobPriority::Normal);
+    JobSystem::instance().waitForIdle();
+    double loadMs = elapsedMs(total);
+
+    /* 2. Give the parts their geometry, the same way the viewer does when a load job finishes */
+    int failed = 0;
+    for (Entry& entry : entries) {
+        if (!entry.clipped) {
+            fprintf(stderr, "Cannot read %s\n", qPrintable(entry.fileName));
+            failed++;
+            continue;
+        }
+        ModelPart::ClipSettings c = options.clip;
+        entry.part = new ModelPart({ QFileInfo(entry.fileName).fileName(), QString("true"),
+                                     options.colour[0], options.colour[1], options.colour[2],
+                                     c.minX, c.maxX, c.minY, c.maxY, c.minZ, c.maxZ, c.size });
+        entry.part->setSource(entry.source, entry.fileName);
+        entry.part->setClipResult(entry.clipped, entry.clipStage);
+        entry.part->getActor()->GetProperty()->SetColor(options.colour[0] / 255., options.colour[1] / 255.,
+                                                        options.colour[2] / 255.);
+    }
+
+    /* 3. Render offscreen */
+    vtkNew<vtkRenderWindow> window;
+    window->SetOffScreenRendering(1);
+    window->SetShowWindow(false);
+    window->SetMultiSamples(0);
+    vtkNew<vtkRenderer> renderer;
+    window->AddRenderer(renderer);
+
+    if (!options.thumbnailDir.isEmpty()) {
+        QDir().mkpath(options.thumbnailDir);
+        for (Entry& entry : entries) {
+            if (!entry.part)
+                continue;
+            renderer->RemoveAllViewProps();
+            renderer->AddActor(entry.part->getActor());
+            QString png = QDir(options.thumbnailDir).filePath(QFileInfo(entry.fileName).completeBaseName() + ".png");
+            if (!render(renderer, png, &entry.renderMs, &entry.writeMs))
+                failed++;
+        }
+    }
+
+    double sceneRenderMs = 0., sceneWriteMs = 0.;
+    if (!options.output.isEmpty()) {
+        renderer->RemoveAllViewProps();
+        for (Entry& entry : entries)
+            if (entry.part)
+                renderer->AddActor(entry.part->getActor());
+        if (!render(renderer, options.output, &sceneRenderMs, &sceneWriteMs))
+            failed++;
+    }
+
+    /* 4. Report */
+    quint64 triangles = 0;
+    double readMs = 0., clipMs = 0., shrinkMs = 0.;
+    for (const Entry& entry : entries) {
+        printEntry(entry);
+        if (entry.source)
+            triangles += entry.source->GetNumberOfPolys();
+        readMs += entry.readMs;
+        clipMs += entry.clipMs;
+        shrinkMs += entry.shrinkMs;
+    }
+    double totalMs = elapsedMs(total);
+
+    out << QString("files=%1 failed=%2 triangles=%3 workers=%4")
+               .arg(entries.size()).arg(failed).arg(triangles).arg(JobSystem::instance().threadCount()) << Qt::endl;
+    out << QString("stage totals: read=%1ms clip=%2ms shrink=%3ms (summed over workers)")
+               .arg(readMs, 0, 'f', 2).arg(clipMs, 0, 'f', 2).arg(shrinkMs, 0, 'f', 2) << Qt::endl;
+    if (!options.output.isEmpty())
+        out << QString("scene %1x%2: render=%3ms write=%4ms")
+                   .arg(options.width).arg(options.height)
+                   .arg(sceneRenderMs, 0, 'f', 2).arg(sceneWriteMs, 0, 'f', 2) << Qt::endl;
+    out << QString("wall: load=%1ms total=%2ms throughput=%3 Mtri/s")
+               .arg(loadMs, 0, 'f', 2).arg(totalMs, 0, 'f', 2)
+               .arg(loadMs > 0. ? triangles / loadMs / 1000. : 0., 0, 'f', 2) << Qt::endl;
+
+    return failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,84 @@
+/**     @file BatchRunner.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Headless batch processing for the WS6Batch tool. STL files are loaded and
+  *     clipped through the same ModelPart code as the viewer, rendered offscreen
+  *     to PNG and the time taken by each stage is printed.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_BATCHRUNNER_H
+#define VIEWER_BATCHRUNNER_H
+
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include <vtkSmartPointer.h>
+#include <vtkRenderer.h>
+
+#include "ModelPart.h"
+
+/*! \class BatchRunner
+ *  \brief Runs the load, clip, shrink and render stages without a display.
+ *  Every file is read and clipped on the JobSystem workers, so the load stages of a large batch run in
+ *  parallel. The parts are then rendered with an offscreen vtkRenderWindow, which uses EGL or OSMesa when
+ *  VTK was built with them (VTK_OPENGL_HAS_EGL / VTK_OPENGL_HAS_OSMESA) and no X display is available.
+ *  Images larger than the biggest offscreen buffer are rendered in tiles.
+ */
+class BatchRunner {
+public:
+    /*! Settings for a batch, filled in from the command line */
+    struct Options {
+        QStringList inputs;                     /*!< STL files or .txt assembly manifests */
+        ModelPart::ClipSettings clip = { 0.f, 100.f, 0.f, 100.f, 0.f, 100.f, 100.f };
+        unsigned char colour[3] = { 255, 0, 90 };
+        QString output;                         /*!< PNG of all parts together, not written if empty */
+        QString thumbnailDir;                   /*!< Directory for one PNG per part, not written if empty */
+        int width = 1920;
+        int height = 1080;
+        int repeat = 1;                         /*!< Times the clip stages are run per part, for throughput */
+    };
+
+    /*!
+     * Constructor
+     * \param options the settings for the batch
+     */
+    BatchRunner(const Options& options);
+    ~BatchRunner();
+
+    /*!
+     * \brief run processes every input and prints the timings to standard output
+     * \return the exit code, 0 if every file was loaded and every image written
+     */
+    int run();
+
+    static constexpr int MaxTileSize = 4096;    /*!< Largest offscreen buffer rendered in one go */
+
+private:
+    /*! One input file and the time taken by each of its stages */
+    struct Entry {
+        QString fileName;
+        ModelPart* part = nullptr;
+        vtkSmartPointer<vtkPolyData> source;
+        vtkSmartPointer<vtkPolyData> clipStage;
+        vtkSmartPointer<vtkDataSet> clipped;
+        double readMs = 0.;
+        double clipMs = 0.;
+        double shrinkMs = 0.;
+        double renderMs = 0.;
+        double writeMs = 0.;
+    };
+
+    QStringList expandInputs() const;
+    void process(Entry& entry) const;
+    bool render(vtkRenderer* renderer, const QString& fileName, double* renderMs, double* writeMs);
+    void printEntry(const Entry& entry);
+
+    Options                 options;
+    QList<Entry>            entries;
+    QTextStream             out;
+};
+
+#endif
@@ -0,0 +1,514 @@
+/**     @file Benchmarks.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     QtTest benchmarks of the part pipeline: STL loading, clipping, propagating
+  *     changes down the tree, tree model lookups and rendering. Run with
+  *
+  *         WS6Benchmarks -o results.xml,xml        (or -o results.csv,csv)
+  *
+  *     to get machine-readable results to compare between releases. The STL files are
+  *     generated in a temporary directory; set WS6_BENCH_LARGE=1 to include the 10M and
+  *     50M triangle sizes, which need several GB of disk and memory.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "mainwindow.h"
+#include "ModelPart.h"
+#include "ModelPartList.h"
+#include "JobSystem.h"
+#include "ClipCache.h"
+#include "MeshNormals.h"
+#include "MeshOptimizer.h"
+#include "MeshDecimator.h"
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include <vtkAppendPolyData.h>
+#include <vtkNew.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <vtkSphereSource.h>
+#include <vtkSTLWriter.h>
+#include <vtkTriangleFilter.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+
+/*! \class Benchmarks
+ *  \brief QBENCHMARK suite, each function has a _data table so every size and shape is reported separately.
+ */
+class Benchmarks : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void loadSTL_data();
+    void loadSTL();
+
+    void applyClip_data();
+    void applyClip();
+
+    void updateChildren_data();
+    void updateChildren();
+
+    void modelIndex_data();
+    void modelIndex();
+
+    void updateRender_data();
+    void updateRender();
+
+    void renderMesh_data();
+    void renderMesh();
+
+    void decimate_data();
+    void decimate();
+
+private:
+    static vtkSmartPointer<vtkPolyData> sphere(qint64 triangles);
+    static bool hasAbout(vtkPolyData* mesh, qint64 triangles);
+    static vtkSmartPointer<vtkPolyData> shuffled(vtkPolyData* mesh);
+    QString stlFile(qint64 triangles, bool binary);
+    static void buildTree(ModelPartList* list, ModelPart* parent, const QString& shape, vtkPolyData* geometry);
+    static void addTree(ModelPartList* list, ModelPart* parent, int depth, int branching, vtkPolyData* geometry);
+    static bool walk(const ModelPartList& list, const QModelIndex& parent, qint64& count);
+    static void settle();
+
+    QTemporaryDir       dir;
+    QHash<QString, QString> files;      /*!< Generated STL files, keyed by size and format */
+    bool                large = false;
+};
+
+/*!
+ * \brief Benchmarks::sphere
+ * A sphere has about 2 * resolution^2 triangles, so the resolution is picked from the count wanted.
+ * vtkSphereSource clamps the resolution to VTK_MAX_SPHERE_RESOLUTION, which is about 2M triangles, so
+ * larger meshes are made of several equal spheres side by side.
+ * \param triangles the number of triangles wanted
+ * \return a triangle mesh of closed spheres with about that many triangles
+ */
+vtkSmartPointer<vtkPolyData> Benchmarks::sphere(qint64 triangles) {
+    const qint64 maxSphereTriangles = 2ll * VTK_MAX_SPHERE_RESOLUTION * (VTK_MAX_SPHERE_RESOLUTION - 1);
+    int pieces = (int)((triangles + maxSphereTriangles - 1) / maxSphereTriangles);
+    int resolution = std::max(8, (int)std::lround(std::sqrt(triangles / (2.0 * pieces))));
+    int columns = (int)std::ceil(std::sqrt((double)pieces));
+
+    vtkNew<vtkAppendPolyData> append;
+    for (int i = 0; i < pieces; i++) {
+        vtkNew<vtkSphereSource> source;
+        source->SetRadius(50.0);
+        source->SetCenter(110.0 * (i % columns), 110.0 * (i / columns), 0.0);
+        source->SetThetaResolution(resolution);
+        source->SetPhiResolution(resolution);
+        append->AddInputConnection(source->GetOutputPort());
+    }
+    vtkNew<vtkTriangleFilter> triangulate;
+    triangulate->SetInputConnection(append->GetOutputPort());
+    triangulate->Update();
+    vtkSmartPointer<vtkPolyData> polyData = triangulate->GetOutput();
+    polyData->BuildCells();
+    return polyData;
+}
+
+/*!
+ * \brief Benchmarks::hasAbout
+ * Checks a generated mesh is the size the row is labelled with, the smallest spheres are up to about 8% short
+ * \return true if the mesh has within 10% of the triangles
+ */
+bool Benchmarks::hasAbout(vtkPolyData* mesh, qint64 triangles) {
+    qint64 actual = mesh ? mesh->GetNumberOfPolys() : 0;
+    return std::llabs(actual - triangles) <= triangles / 10;
+}
+
+/*!
+ * \brief Benchmarks::shuffled
+ * CAD exporters write triangles in no useful order, a sphere comes out of its source in strips so its
+ * triangles are shuffled to be like them
+ * \param mesh a triangle mesh
+ * \return the same triangles in a fixed random order
+ */
+vtkSmartPointer<vtkPolyData> Benchmarks::shuffled(vtkPolyData* mesh) {
+    vtkIdType triangles = mesh->GetNumberOfPolys();
+    std::vector<vtkIdType> order(triangles);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(2076));
+
+    vtkNew<vtkCellArray> polys;
+    polys->AllocateExact(triangles, 3 * triangles);
+    vtkIdType count;
+    const vtkIdType* ids;
+    for (vtkIdType id : order) {
+        mesh->GetPolys()->GetCellAtId(id, count, ids);
+        polys->InsertNextCell(count, ids);
+    }
+    vtkSmartPointer<vtkPolyData> result = vtkSmartPointer<vtkPolyData>::New();
+    result->SetPoints(mesh->GetPoints());
+    result->SetPolys(polys);
+    return result;
+}
+
+/*!
+ * \brief Benchmarks::stlFile
+ * Writes the STL file the first time it is asked for, the large ones take a while
+ * \param triangles the number of triangles
+ * \param binary binary or ASCII STL
+ * \return the file name
+ */
+QString Benchmarks::stlFile(qint64 triangles, bool binary) {
+    QString key = QString("%1_%2").arg(triangles).arg(binary ? "binary" : "ascii");
+    if (files.contains(key))
+        return files[key];
+
+    QString fileName = dir.filePath(key + ".stl");
+    vtkNew<vtkSTLWriter> writer;
+    writer->SetInputData(sphere(triangles));
+    writer->SetFileName(fileName.toLocal8Bit());
+    if (binary)
+        writer->SetFileTypeToBinary();
+    else
+        writer->SetFileTypeToASCII();
+    writer->Write();
+    files[key] = fileName;
+    return fileName;
+}
+
+/*!
+ * \brief Benchmarks::addTree
+ * Adds a full tree below parent, every part shares the same geometry but has its own actor
+ */
+void Benchmarks::addTree(ModelPartList* list, ModelPart* parent, int depth, int branching, vtkPolyData* geometry) {
+    if (depth == 0)
+        return;
+    for (int i = 0; i < branching; i++) {
+        ModelPart* part = list->createPart({ QString("Part %1").arg(i), QString("true"), 255, 0, 90,
+                                             0., 100., 0., 100., 0., 100., 100 });
+        parent->appendChild(part);
+        if (geometry) {
+            part->setSource(geometry, QString("bench"));
+            part->setClipResult(geometry);
+        }
+        addTree(list, part, depth - 1, branching, geometry);
+    }
+}
+
+/*!
+ * \brief Benchmarks::buildTree
+ * \param shape "deep" is a chain 1000 parts long, "wide" is 10000 parts under one parent and
+ *        "bushy" has 10 children per part, 4 levels deep
+ */
+void Benchmarks::buildTree(ModelPartList* list, ModelPart* parent, const QString& shape, vtkPolyData* geometry) {
+    if (shape == "deep")
+        addTree(list, parent, 1000, 1, geometry);
+    else if (shape == "wide")
+        addTree(list, parent, 1, 10000, geometry);
+    else
+        addTree(list, parent, 4, 10, geometry);
+}
+
+/*!
+ * \brief Benchmarks::walk
+ * Visits every index of the model the way a view does, asking each child for its parent. QFAIL only
+ * returns from the function it is in, so the result is checked by the test.
+ * \return false if a child's parent() does not match the index it was made from
+ */
+bool Benchmarks::walk(const ModelPartList& list, const QModelIndex& parent, qint64& count) {
+    int rows = list.rowCount(parent);
+    for (int row = 0; row < rows; row++) {
+        QModelIndex child = list.index(row, 0, parent);
+        if (list.parent(child) != parent)
+            return false;
+        count++;
+        if (!walk(list, child, count))
+            return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Benchmarks::settle
+ * Waits for the jobs and delivers their continuations, so a benchmark includes the whole change
+ */
+void Benchmarks::settle() {
+    JobSystem::instance().waitForIdle();
+    QCoreApplication::processEvents();
+}
+
+void Benchmarks::initTestCase() {
+    QVERIFY(dir.isValid());
+    large = qEnvironmentVariableIntValue("WS6_BENCH_LARGE") != 0;
+}
+
+void Benchmarks::cleanupTestCase() {
+    settle();
+}
+
+void Benchmarks::loadSTL_data() {
+    QTest::addColumn<qint64>("triangles");
+    QTest::addColumn<bool>("binary");
+    QTest::addColumn<bool>("optimize");
+
+    QList<qint64> sizes = { 1000, 100000, 1000000 };
+    if (large)
+        sizes << 10000000 << 50000000;
+    for (qint64 size : sizes) {
+        QTest::addRow("binary %lld", size) << size << true << false;
+        // ASCII files are about five times the size, the largest are left out
+        if (size <= 10000000)
+            QTest::addRow("ascii %lld", size) << size << false << false;
+        QTest::addRow("binary %lld optimised", size) << size << true << true;
+    }
+}
+
+/*!
+ * \brief Benchmarks::loadSTL
+ * ModelPart::readSTLFile, which the viewer runs on a worker for every part it opens. An optimised import
+ * is read from the MeshCache after the first time, which is done before timing, so those rows are the
+ * time to open a part again.
+ */
+void Benchmarks::loadSTL() {
+    QFETCH(qint64, triangles);
+    QFETCH(bool, binary);
+    QFETCH(bool, optimize);
+    QString fileName = stlFile(triangles, binary);
+    ModelPart::ImportSettings settings;
+    settings.optimize = optimize;
+    if (optimize)
+        ModelPart::readSTLFile(fileName, settings);
+
+    vtkSmartPointer<vtkPolyData> read;
+    QBENCHMARK {
+        read = ModelPart::readSTLFile(fileName, settings);
+    }
+    QVERIFY2(hasAbout(read, triangles), "the file does not have the number of triangles in the row name");
+}
+
+void Benchmarks::applyClip_data() {
+    QTest::addColumn<qint64>("triangles");
+    QTest::addColumn<float>("cut");
+    QTest::addColumn<float>("size");
+
+    qint64 triangles = large ? 10000000 : 1000000;
+    for (float cut : { 0.f, 25.f, 50.f, 75.f })
+        QTest::addRow("cut %d%%", (int)cut) << triangles << cut << 100.f;
+    QTest::addRow("cut 50%% shrink 90%%") << triangles << 50.f << 90.f;
+}
+
+/*!
+ * \brief Benchmarks::applyClip
+ * ModelPart::computeClip with the given fraction cut off the +X side, optionally shrunk as well
+ */
+void Benchmarks::applyClip() {
+    QFETCH(qint64, triangles);
+    QFETCH(float, cut);
+    QFETCH(float, size);
+
+    vtkSmartPointer<vtkPolyData> source = sphere(triangles);
+    QVERIFY2(hasAbout(source, triangles), "the mesh does not have the number of triangles in the row name");
+    ModelPart::ClipSettings settings = { 0.f, 100.f - cut, 0.f, 100.f, 0.f, 100.f, size };
+
+    vtkSmartPointer<vtkDataSet> clipped;
+    QBENCHMARK {
+        clipped = ModelPart::computeClip(source, settings);
+    }
+    QVERIFY(clipped);
+}
+
+void Benchmarks::updateChildren_data() {
+    QTest::addColumn<QString>("shape");
+    QTest::addColumn<bool>("clip");
+
+    for (const char* shape : { "deep", "wide", "bushy" }) {
+        QTest::addRow("%s colour", shape) << QString(shape) << false;
+        QTest::addRow("%s clip", shape) << QString(shape) << true;
+    }
+}
+
+/*!
+ * \brief Benchmarks::updateChildren
+ * MainWindow::updateChildren from the top of the tree. A colour change only touches the actors, a clip
+ * change re-runs the pipeline of every part on the job system, the benchmark waits for all of them.
+ * The clip cache is turned off so every iteration runs the filters.
+ */
+void Benchmarks::updateChildren() {
+    QFETCH(QString, shape);
+    QFETCH(bool, clip);
+
+    MainWindow window;
+    ModelPart* top = window.partList->getRootItem()->child(0);
+    vtkSmartPointer<vtkPolyData> geometry = sphere(1000);
+    buildTree(window.partList, top, shape, geometry);
+
+    qint64 budget = ClipCache::instance().budget();
+    ClipCache::instance().setBudget(0);
+
+    int iteration = 0;
+    QBENCHMARK {
+        // alternate between two settings so every call is a change
+        bool odd = (iteration++ % 2) != 0;
+        float maxX = clip && odd ? 50.f : 100.f;
+        window.updateChildren(top, true, odd ? 0 : 255, 0, 90, 0.f, maxX, 0.f, 100.f, 0.f, 100.f, 100.f);
+        if (clip)
+            settle();
+    }
+
+    settle();
+    ClipCache::instance().setBudget(budget);
+}
+
+void Benchmarks::modelIndex_data() {
+    QTest::addColumn<QString>("shape");
+
+    for (const char* shape : { "deep", "wide", "bushy" })
+        QTest::addRow("%s", shape) << QString(shape);
+}
+
+/*!
+ * \brief Benchmarks::modelIndex
+ * ModelPartList::index and ModelPartList::parent for every part in the tree
+ */
+void Benchmarks::modelIndex() {
+    QFETCH(QString, shape);
+
+    ModelPartList list("Bench");
+    ModelPart* top = list.createPart({ QString("Model"), QString("true"), 255, 0, 90,
+                                       0., 100., 0., 100., 0., 100., 100 });
+    top->empty_node = true;
+    list.getRootItem()->appendChild(top);
+    buildTree(&list, top, shape, nullptr);
+
+    qint64 count = 0;
+    QBENCHMARK {
+        count = 0;
+        QVERIFY2(walk(list, QModelIndex(), count), "parent() does not match index()");
+    }
+    QVERIFY(count > 1);
+}
+
+void Benchmarks::updateRender_data() {
+    QTest::addColumn<int>("parts");
+
+    for (int parts : { 10, 100, 1000 })
+        QTest::addRow("%d parts", parts) << parts;
+}
+
+/*!
+ * \brief Benchmarks::updateRender
+ * MainWindow::updateRender followed by a frame, with the renderer moved into an offscreen window so no
+ * display is needed
+ */
+void Benchmarks::updateRender() {
+    QFETCH(int, parts);
+
+    MainWindow window;
+    ModelPart* top = window.partList->getRootItem()->child(0);
+    addTree(window.partList, top, 1, parts, sphere(1000));
+
+    vtkNew<vtkRenderWindow> offscreen;
+    offscreen->SetOffScreenRendering(1);
+    offscreen->SetShowWindow(false);
+    offscreen->SetSize(1280, 720);
+    window.renderWindow->RemoveRenderer(window.renderer);
+    offscreen->AddRenderer(window.renderer);
+
+    QBENCHMARK {
+        window.updateRender();
+        offscreen->Render();
+    }
+
+    offscreen->RemoveRenderer(window.renderer);
+}
+
+void Benchmarks::renderMesh_data() {
+    QTest::addColumn<qint64>("triangles");
+    QTest::addColumn<bool>("optimize");
+
+    QList<qint64> sizes = { 1000000 };
+    if (large)
+        sizes << 10000000;
+    for (qint64 size : sizes) {
+        QTest::addRow("%lld exporter order", size) << size << false;
+        QTest::addRow("%lld optimised", size) << size << true;
+    }
+}
+
+/*!
+ * \brief Benchmarks::renderMesh
+ * One frame of a single dense part, as imported with and without MeshOptimizer. The frame waits for the
+ * GPU to finish, so the difference is the vertex cache and overdraw saving.
+ */
+void Benchmarks::renderMesh() {
+    QFETCH(qint64, triangles);
+    QFETCH(bool, optimize);
+
+    vtkSmartPointer<vtkPolyData> mesh = MeshNormals::smooth(MeshNormals::weld(shuffled(sphere(triangles))));
+    QVERIFY2(hasAbout(mesh, triangles), "the mesh does not have the number of triangles in the row name");
+    if (optimize)
+        mesh = MeshOptimizer::optimize(mesh);
+
+    vtkNew<vtkPolyDataMapper> mapper;
+    mapper->SetInputData(mesh);
+    vtkNew<vtkActor> actor;
+    actor->SetMapper(mapper);
+    vtkNew<vtkRenderer> renderer;
+    renderer->AddActor(actor);
+    renderer->ResetCamera();
+
+    vtkNew<vtkRenderWindow> offscreen;
+    offscreen->SetOffScreenRendering(1);
+    offscreen->SetShowWindow(false);
+    offscreen->SetSize(1280, 720);
+    offscreen->AddRenderer(renderer);
+    // The first frame uploads the buffers
+    offscreen->Render();
+
+    QBENCHMARK {
+        offscreen->Render();
+        offscreen->WaitForCompletion();
+    }
+}
+
+void Benchmarks::decimate_data() {
+    QTest::addColumn<qint64>("triangles");
+    QTest::addColumn<qint64>("budget");
+    QTest::addColumn<double>("error");
+
+    QList<qint64> sizes = { 1000000 };
+    if (large)
+        sizes << 10000000;
+    for (qint64 size : sizes) {
+        QTest::addRow("%lld to 10%%", size) << size << size / 10 << 0.;
+        QTest::addRow("%lld error 0.1%%", size) << size << qint64(0) << 0.001;
+    }
+}
+
+/*!
+ * \brief Benchmarks::decimate
+ * MeshDecimator::decimate on a welded sphere, to a triangle budget or to an error bound
+ */
+void Benchmarks::decimate() {
+    QFETCH(qint64, triangles);
+    QFETCH(qint64, budget);
+    QFETCH(double, error);
+
+    vtkSmartPointer<vtkPolyData> welded = MeshNormals::weld(sphere(triangles));
+    QVERIFY2(hasAbout(welded, triangles), "the mesh does not have the number of triangles in the row name");
+    MeshDecimator::Target target;
+    target.triangles = budget;
+    target.error = error;
+
+    vtkIdType kept = 0;
+    QBENCHMARK {
+        kept = MeshDecimator::decimate(welded, target)->GetNumberOfPolys();
+    }
+    QVERIFY(kept < welded->GetNumberOfPolys());
+}
+
+QTEST_MAIN(Benchmarks)
+#include "Benchmarks.moc"
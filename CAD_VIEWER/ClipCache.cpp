@@ -0,0 +1,129 @@
+/**     @file ClipCache.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Memory-bounded LRU cache of clip/shrink results.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "ClipCache.h"
+
+/*!
+ * \brief ClipCache::instance
+ * \return the shared cache
+ */
+ClipCache& ClipCache::instance() {
+    static ClipCache cache;
+    return cache;
+}
+
+/*!
+ * \brief ClipCache::ClipCache
+ * Constructor
+ * \param budgetBytes the budget in bytes
+ */
+ClipCache::ClipCache(qint64 budgetBytes)
+    : budgetBytes(budgetBytes), usedBytes(0), hitCount(0), missCount(0) {
+}
+
+/*!
+ * \brief ClipCache::keyFor
+ * The settings come from the options dialog as whole percentages, two decimals is enough to tell
+ * any two settings apart without float noise making equal settings miss.
+ * \param geometryId the source geometry
+ * \param settings the clip settings
+ * \return the key
+ */
+QString ClipCache::keyFor(quint64 geometryId, const ModelPart::ClipSettings& settings) {
+    return QString("%1|%2|%3|%4|%5|%6|%7|%8")
+        .arg(geometryId)
+        .arg(settings.minX, 0, 'f', 2)
+        .arg(settings.maxX, 0, 'f', 2)
+        .arg(settings.minY, 0, 'f', 2)
+        .arg(settings.maxY, 0, 'f', 2)
+        .arg(settings.minZ, 0, 'f', 2)
+        .arg(settings.maxZ, 0, 'f', 2)
+        .arg(settings.size, 0, 'f', 2);
+}
+
+vtkSmartPointer<vtkDataSet> ClipCache::find(quint64 geometryId, const ModelPart::ClipSettings& settings) {
+    auto it = index.find(keyFor(geometryId, settings));
+    if (it == index.end()) {
+        missCount++;
+        return nullptr;
+    }
+
+    hitCount++;
+    entries.splice(entries.begin(), entries, it.value());
+    return it.value()->result;
+}
+
+void ClipCache::insert(quint64 geometryId, const ModelPart::ClipSettings& settings, vtkSmartPointer<vtkDataSet> result) {
+    if (!result || geometryId == 0)
+        return;
+
+    QString key = keyFor(geometryId, settings);
+    auto existing = index.find(key);
+    if (existing != index.end())
+        erase(existing.value());
+
+    /* GetActualMemorySize() is in kibibytes */
+    qint64 size = (qint64)result->GetActualMemorySize() * 1024;
+    if (size > budgetBytes)
+        return;
+
+    entries.push_front({ key, geometryId, result, size });
+    index.insert(key, entries.begin());
+    usedBytes += size;
+    evict();
+}
+
+void ClipCache::removeGeometry(quint64 geometryId) {
+    for (auto it = entries.begin(); it != entries.end();) {
+        auto next = std::next(it);
+        if (it->geometryId == geometryId)
+            erase(it);
+        it = next;
+    }
+}
+
+void ClipCache::setBudget(qint64 budgetBytes) {
+    this->budgetBytes = budgetBytes;
+    evict();
+}
+
+/*!
+ * \brief ClipCache::evict
+ * Drops least recently used results until the cache is within budget
+ */
+void ClipCache::evict() {
+    while (usedBytes > budgetBytes && !entries.empty())
+        erase(std::prev(entries.end()));
+}
+
+void ClipCache::erase(EntryList::iterator entry) {
+    usedBytes -= entry->bytes;
+    index.remove(entry->key);
+    entries.erase(entry);
+}
+
+qint64 ClipCache::budget() const {
+    return budgetBytes;
+}
+
+qint64 ClipCache::bytes() const {
+    return usedBytes;
+}
+
+int ClipCache::count() const {
+    return (int)entries.size();
+}
+
+quint64 ClipCache::hits() const {
+    return hitCount;
+}
+
+quint64 ClipCache::misses() const {
+    return missCount;
+}
@@ -0,0 +1,103 @@
+/**     @file ClipCache.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Memory-bounded LRU cache of clip/shrink results, so going back to a section
+  *     setting that was used before does not re-run the clip filters.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_CLIPCACHE_H
+#define VIEWER_CLIPCACHE_H
+
+#include <QHash>
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkDataSet.h>
+
+#include <list>
+
+#include "ModelPart.h"
+
+/*! \class ClipCache
+ *  \brief Least recently used cache of clip results, keyed by geometry and clip settings.
+ *  The size of each entry is taken from vtkDataSet::GetActualMemorySize() and the oldest entries are
+ *  evicted once the total goes over the budget. Results are shared, not copied, so a cached result
+ *  must not be modified. Only used from the GUI thread.
+ *  The cache has its own budget and is not counted by GeometryMemoryManager: a cached result is often the
+ *  one a part is showing, which the manager already counts as that part's cost. When the manager evicts a
+ *  part its cached results are dropped with removeGeometry().
+ */
+class ClipCache {
+public:
+    /*!
+     * \brief instance
+     * \return the cache shared by all parts
+     */
+    static ClipCache& instance();
+
+    /*!
+     * Constructor
+     * \param budgetBytes is the most memory the cached results may use
+     */
+    explicit ClipCache(qint64 budgetBytes = DefaultBudget);
+
+    /*!
+     * \brief find looks up a result and marks it as most recently used
+     * \param geometryId identifies the source geometry, see ModelPart::geometryId()
+     * \param settings are the clip percentages and size
+     * \return the cached result, or null
+     */
+    vtkSmartPointer<vtkDataSet> find(quint64 geometryId, const ModelPart::ClipSettings& settings);
+
+    /*!
+     * \brief insert adds a result, evicting the least recently used results if over budget
+     * \param geometryId identifies the source geometry
+     * \param settings are the clip percentages and size the result was made with
+     * \param result is the clipped geometry
+     */
+    void insert(quint64 geometryId, const ModelPart::ClipSettings& settings, vtkSmartPointer<vtkDataSet> result);
+
+    /*!
+     * \brief removeGeometry drops every result made from a geometry, used when a part is deleted
+     * \param geometryId identifies the source geometry
+     */
+    void removeGeometry(quint64 geometryId);
+
+    /*!
+     * \brief setBudget changes the budget, evicting results if needed
+     * \param budgetBytes is the most memory the cached results may use
+     */
+    void setBudget(qint64 budgetBytes);
+
+    qint64 budget() const;              /*!< \return the budget in bytes */
+    qint64 bytes() const;               /*!< \return memory used by the cached results in bytes */
+    int count() const;                  /*!< \return number of cached results */
+    quint64 hits() const;               /*!< \return number of lookups that found a result */
+    quint64 misses() const;             /*!< \return number of lookups that did not */
+
+    static constexpr qint64 DefaultBudget = 512ll * 1024 * 1024;   /*!< 512MB */
+
+private:
+    struct Entry {
+        QString                         key;
+        quint64                         geometryId;
+        vtkSmartPointer<vtkDataSet>     result;
+        qint64                          bytes;
+    };
+    using EntryList = std::list<Entry>;
+
+    static QString keyFor(quint64 geometryId, const ModelPart::ClipSettings& settings);
+    void evict();
+    void erase(EntryList::iterator entry);
+
+    EntryList                           entries;        /*!< Most recently used first */
+    QHash<QString, EntryList::iterator> index;
+    qint64                              budgetBytes;
+    qint64                              usedBytes;
+    quint64                             hitCount;
+    quint64                             missCount;
+};
+
+#endif
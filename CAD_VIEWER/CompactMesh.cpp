@@ -0,0 +1,224 @@
+/**     @file CompactMesh.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Compact in-memory form of a triangle mesh.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "CompactMesh.h"
+#include "Trace.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkFloatArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkUnstructuredGrid.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/* Octahedral normal encoding - the unit sphere is projected onto an octahedron which is unfolded
+ * into a square, so a normal is two numbers with near-uniform precision in every direction. */
+static float signNotZero(float v) {
+    return v >= 0.f ? 1.f : -1.f;
+}
+
+static void octEncode(const float n[3], qint16 out[2]) {
+    float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    float u = 0.f, v = 0.f;
+    if (l1 > 0.f) {
+        u = n[0] / l1;
+        v = n[1] / l1;
+        if (n[2] < 0.f) {
+            float fu = (1.f - std::fabs(v)) * signNotZero(u);
+            float fv = (1.f - std::fabs(u)) * signNotZero(v);
+            u = fu;
+            v = fv;
+        }
+    }
+    out[0] = (qint16)std::lround(std::clamp(u, -1.f, 1.f) * 32767.f);
+    out[1] = (qint16)std::lround(std::clamp(v, -1.f, 1.f) * 32767.f);
+}
+
+static void octDecode(const qint16 in[2], float n[3]) {
+    float u = in[0] / 32767.f;
+    float v = in[1] / 32767.f;
+    float z = 1.f - std::fabs(u) - std::fabs(v);
+    if (z < 0.f) {
+        float fu = (1.f - std::fabs(v)) * signNotZero(u);
+        float fv = (1.f - std::fabs(u)) * signNotZero(v);
+        u = fu;
+        v = fv;
+    }
+    float length = std::sqrt(u * u + v * v + z * z);
+    n[0] = u / length;
+    n[1] = v / length;
+    n[2] = z / length;
+}
+
+/*!
+ * \brief CompactMesh::encode
+ * Quantizes the points against the bounding box and copies the triangle indices and normals. Fails
+ * for meshes with cells other than triangles, or too many points or triangles for 32-bit indices and
+ * offsets, the caller then keeps the polydata as it is.
+ * \param polyData the mesh
+ * \return the compact mesh or null
+ */
+std::shared_ptr<CompactMesh> CompactMesh::encode(vtkPolyData* polyData) {
+    if (!polyData || !polyData->GetPoints())
+        return nullptr;
+
+    vtkCellArray* polys = polyData->GetPolys();
+    vtkIdType triangles = polys->GetNumberOfCells();
+    vtkIdType points = polyData->GetNumberOfPoints();
+    if (polyData->GetNumberOfCells() != triangles || polys->GetNumberOfConnectivityIds() != 3 * triangles)
+        return nullptr;
+    if (points >= std::numeric_limits<qint32>::max())
+        return nullptr;
+    // decode() writes the cell offsets 3 * i as 32-bit values too
+    if (3 * triangles >= std::numeric_limits<qint32>::max())
+        return nullptr;
+
+    std::shared_ptr<CompactMesh> mesh(new CompactMesh());
+
+    double bounds[6];
+    polyData->GetBounds(bounds);
+    for (int c = 0; c < 3; c++) {
+        mesh->origin[c] = bounds[2 * c];
+        mesh->scale[c] = (bounds[2 * c + 1] - bounds[2 * c]) / 65535.0;
+    }
+
+    mesh->positions.resize(3 * points);
+    vtkDataArray* pointData = polyData->GetPoints()->GetData();
+    vtkSMPTools::For(0, points, [&](vtkIdType begin, vtkIdType end) {
+        double p[3];
+        for (vtkIdType i = begin; i < end; i++) {
+            pointData->GetTuple(i, p);
+            for (int c = 0; c < 3; c++) {
+                double q = mesh->scale[c] > 0. ? (p[c] - mesh->origin[c]) / mesh->scale[c] : 0.;
+                mesh->positions[3 * i + c] = (quint16)std::lround(std::clamp(q, 0., 65535.));
+            }
+        }
+    });
+
+    mesh->indices.resize(3 * triangles);
+    const auto connectivity = vtk::DataArrayValueRange<1>(polys->GetConnectivityArray());
+    vtkSMPTools::For(0, 3 * triangles, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++)
+            mesh->indices[i] = (quint32)connectivity[i];
+    });
+
+    vtkDataArray* normals = polyData->GetPointData()->GetNormals();
+    if (normals) {
+        mesh->normals.resize(2 * points);
+        vtkSMPTools::For(0, points, [&](vtkIdType begin, vtkIdType end) {
+            double n[3];
+            for (vtkIdType i = begin; i < end; i++) {
+                normals->GetTuple(i, n);
+                float f[3] = { (float)n[0], (float)n[1], (float)n[2] };
+                octEncode(f, &mesh->normals[2 * i]);
+            }
+        });
+    }
+
+    return mesh;
+}
+
+/*!
+ * \brief CompactMesh::decode
+ * \return a new polydata with float points, 32-bit cell storage and float normals if the mesh has them
+ */
+vtkSmartPointer<vtkPolyData> CompactMesh::decode() const {
+    TRACE_ZONE("decodeCompact");
+    vtkIdType points = pointCount();
+    vtkIdType triangles = triangleCount();
+
+    vtkNew<vtkFloatArray> pointArray;
+    pointArray->SetNumberOfComponents(3);
+    pointArray->SetNumberOfTuples(points);
+    float* p = pointArray->GetPointer(0);
+    vtkSMPTools::For(0, points, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++)
+            for (int c = 0; c < 3; c++)
+                p[3 * i + c] = (float)(origin[c] + positions[3 * i + c] * scale[c]);
+    });
+
+    vtkNew<vtkTypeInt32Array> offsets;
+    offsets->SetNumberOfValues(triangles + 1);
+    vtkNew<vtkTypeInt32Array> connectivity;
+    connectivity->SetNumberOfValues(3 * triangles);
+    vtkTypeInt32* o = offsets->GetPointer(0);
+    vtkTypeInt32* conn = connectivity->GetPointer(0);
+    vtkSMPTools::For(0, triangles + 1, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++)
+            o[i] = (vtkTypeInt32)(3 * i);
+    });
+    vtkSMPTools::For(0, 3 * triangles, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++)
+            conn[i] = (vtkTypeInt32)indices[i];
+    });
+
+    vtkNew<vtkPoints> pts;
+    pts->SetData(pointArray);
+    vtkNew<vtkCellArray> polys;
+    polys->SetData(offsets, connectivity);
+
+    vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+    polyData->SetPoints(pts);
+    polyData->SetPolys(polys);
+
+    if (!normals.empty()) {
+        vtkNew<vtkFloatArray> normalArray;
+        normalArray->SetName("Normals");
+        normalArray->SetNumberOfComponents(3);
+        normalArray->SetNumberOfTuples(points);
+        float* n = normalArray->GetPointer(0);
+        vtkSMPTools::For(0, points, [&](vtkIdType begin, vtkIdType end) {
+            for (vtkIdType i = begin; i < end; i++)
+                octDecode(&normals[2 * i], &n[3 * i]);
+        });
+        polyData->GetPointData()->SetNormals(normalArray);
+    }
+
+    polyData->BuildCells();
+    return polyData;
+}
+
+qint64 CompactMesh::bytes() const {
+    return (qint64)(positions.size() * sizeof(quint16) + indices.size() * sizeof(quint32) + normals.size() * sizeof(qint16));
+}
+
+qint64 CompactMesh::pointCount() const {
+    return (qint64)positions.size() / 3;
+}
+
+qint64 CompactMesh::triangleCount() const {
+    return (qint64)indices.size() / 3;
+}
+
+/*!
+ * \brief CompactMesh::use32BitCells
+ * \param dataSet a polydata or unstructured grid
+ * \return true if its cells now use 32-bit storage
+ */
+bool CompactMesh::use32BitCells(vtkDataSet* dataSet) {
+    bool converted = false;
+    if (vtkPolyData* polyData = vtkPolyData::SafeDownCast(dataSet)) {
+        vtkCellArray* arrays[4] = { polyData->GetVerts(), polyData->GetLines(), polyData->GetPolys(), polyData->GetStrips() };
+        for (vtkCellArray* cells : arrays)
+            if (cells && cells->GetNumberOfCells() > 0 && cells->CanConvertTo32BitStorage())
+                converted = cells->ConvertTo32BitStorage() || converted;
+    }
+    else if (vtkUnstructuredGrid* grid = vtkUnstructuredGrid::SafeDownCast(dataSet)) {
+        vtkCellArray* cells = grid->GetCells();
+        if (cells && cells->CanConvertTo32BitStorage())
+            converted = cells->ConvertTo32BitStorage();
+    }
+    return converted;
+}
@@ -0,0 +1,74 @@
+/**     @file CompactMesh.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Compact in-memory form of a triangle mesh, used to keep very large parts
+  *     resident at a fraction of the memory of a vtkPolyData.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_COMPACTMESH_H
+#define VIEWER_COMPACTMESH_H
+
+#include <QtGlobal>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkDataSet.h>
+
+#include <memory>
+#include <vector>
+
+/*! \class CompactMesh
+ *  \brief Triangle mesh with quantized positions, 32-bit indices and octahedral normals.
+ *  Each position is stored as three 16-bit fractions of the part's bounding box (6 bytes instead of 12),
+ *  each triangle as three 32-bit indices (12 bytes instead of 24 plus a 64-bit offset) and each normal,
+ *  if the mesh has them, as two 16-bit octahedral coordinates (4 bytes instead of 12). The positions are
+ *  accurate to 1/65535 of the bounding box. The mesh is immutable once encoded, so it can be shared by
+ *  any number of threads; decode() rebuilds a vtkPolyData when the filters need one.
+ */
+class CompactMesh {
+public:
+    /*!
+     * \brief encode builds the compact form of a mesh, using the VTK SMP thread pool
+     * \param polyData is the mesh, it must only contain triangles
+     * \return the compact mesh, or null if the mesh cannot be stored this way
+     */
+    static std::shared_ptr<CompactMesh> encode(vtkPolyData* polyData);
+
+    /*!
+     * \brief decode rebuilds the mesh as a vtkPolyData with float points and 32-bit cell storage
+     * \return the new polydata
+     */
+    vtkSmartPointer<vtkPolyData> decode() const;
+
+    /*!
+     * \brief bytes
+     * \return memory used by the compact form
+     */
+    qint64 bytes() const;
+
+    qint64 pointCount() const;      /*!< \return number of points */
+    qint64 triangleCount() const;   /*!< \return number of triangles */
+
+    /*!
+     * \brief use32BitCells switches the cell storage of a filter output to 32-bit offsets and
+     * connectivity, which halves its size. Used on clip results made from compact meshes.
+     * \param dataSet is the polydata or unstructured grid
+     * \return true if the storage was converted
+     */
+    static bool use32BitCells(vtkDataSet* dataSet);
+
+    static constexpr qint64 DefaultTriangleThreshold = 50000000;  /*!< Parts above this many triangles are stored compactly */
+
+private:
+    CompactMesh() = default;
+
+    double                  origin[3];      /*!< Minimum corner of the bounding box */
+    double                  scale[3];       /*!< Size of the bounding box / 65535 */
+    std::vector<quint16>    positions;      /*!< x, y, z per point */
+    std::vector<quint32>    indices;        /*!< Three per triangle */
+    std::vector<qint16>     normals;        /*!< Octahedral u, v per point, empty if no normals */
+};
+
+#endif
@@ -0,0 +1,277 @@
+/**     @file EnvironmentLoader.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Loads an equirectangular HDR environment on a worker thread.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "EnvironmentLoader.h"
+#include "Trace.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include <vtkNew.h>
+#include <vtkHDRReader.h>
+#include <vtkPointData.h>
+#include <vtkSphericalHarmonics.h>
+#include <vtkTable.h>
+#ifdef WS6_HAVE_OPENEXR
+#include <vtkEXRReader.h>
+#endif
+
+#include <cstring>
+
+/* Cache files start with this so a file from another version is never misread */
+static const char CacheMagic[8] = { 'W', 'S', '6', 'E', 'N', 'V', '0', '1' };
+
+/*!
+ * \brief EnvironmentLoader::EnvironmentLoader
+ * Constructor
+ * \param fileName the environment file
+ */
+EnvironmentLoader::EnvironmentLoader(const QString& fileName)
+    : m_fileName(fileName), m_fromCache(false) {
+}
+
+QString EnvironmentLoader::fileName() const {
+    return m_fileName;
+}
+
+Environment EnvironmentLoader::environment() const {
+    return m_environment;
+}
+
+QString EnvironmentLoader::sourceHash() const {
+    return m_hash;
+}
+
+bool EnvironmentLoader::fromCache() const {
+    return m_fromCache;
+}
+
+QString EnvironmentLoader::errorString() const {
+    return m_error;
+}
+
+/*!
+ * \brief EnvironmentLoader::cacheDirectory
+ * \return the environments folder in the user's cache location
+ */
+QString EnvironmentLoader::cacheDirectory() {
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("environments");
+}
+
+/*!
+ * \brief EnvironmentLoader::makeTexture
+ * \param image the equirectangular image
+ * \return a texture suitable for vtkSkybox (sphere projection) and vtkRenderer::SetEnvironmentTexture()
+ */
+vtkSmartPointer<vtkTexture> EnvironmentLoader::makeTexture(vtkImageData* image) {
+    vtkSmartPointer<vtkTexture> texture = vtkSmartPointer<vtkTexture>::New();
+    texture->SetInputData(image);
+    texture->SetColorModeToDirectScalars();
+    texture->InterpolateOn();
+    texture->MipmapOn();
+    return texture;
+}
+
+/*!
+ * \brief EnvironmentLoader::load
+ * Hashes the source file, then either reads the cache file for that hash or decodes the source,
+ * computes the irradiance and writes a new cache file.
+ * \return true on success
+ */
+bool EnvironmentLoader::load() {
+    TRACE_ZONE("environmentLoad");
+    QFile source(m_fileName);
+    if (!source.open(QIODevice::ReadOnly)) {
+        m_error = QString("Cannot open environment file");
+        return false;
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&source);
+    source.close();
+    m_hash = QString::fromLatin1(hash.result().toHex());
+
+    QString cacheFile = QDir(cacheDirectory()).filePath(m_hash + ".env");
+    if (QFile::exists(cacheFile) && readCache(cacheFile)) {
+        m_fromCache = true;
+    }
+    else {
+        if (!decode())
+            return false;
+        computeSphericalHarmonics();
+        QDir().mkpath(cacheDirectory());
+        writeCache(cacheFile);
+    }
+
+    m_environment.texture = makeTexture(m_environment.image);
+    return true;
+}
+
+/*!
+ * \brief EnvironmentLoader::decode
+ * Reads the source file and downsamples it if it is wider than MaxWidth. The skybox is never shown
+ * at more than this resolution and the lighting is computed from much smaller mip levels anyway.
+ * \return true on success
+ */
+bool EnvironmentLoader::decode() {
+    QString suffix = QFileInfo(m_fileName).suffix().toLower();
+    QByteArray name = m_fileName.toLocal8Bit();
+    vtkSmartPointer<vtkImageData> decoded;
+
+    if (suffix == "hdr") {
+        vtkNew<vtkHDRReader> reader;
+        if (!reader->CanReadFile(name.constData())) {
+            m_error = QString("Not a Radiance HDR file");
+            return false;
+        }
+        reader->SetFileName(name.constData());
+        reader->Update();
+        decoded = reader->GetOutput();
+    }
+#ifdef WS6_HAVE_OPENEXR
+    else if (suffix == "exr") {
+        vtkNew<vtkEXRReader> reader;
+        reader->SetFileName(name.constData());
+        reader->Update();
+        decoded = reader->GetOutput();
+    }
+#endif
+    else {
+        m_error = QString("Unsupported environment format: .%1").arg(suffix);
+        return false;
+    }
+
+    vtkDataArray* scalars = decoded ? decoded->GetPointData()->GetScalars() : nullptr;
+    if (!scalars || scalars->GetDataType() != VTK_FLOAT || scalars->GetNumberOfComponents() < 3) {
+        m_error = QString("Environment must be a floating point RGB image");
+        return false;
+    }
+
+    int dims[3];
+    decoded->GetDimensions(dims);
+    int components = scalars->GetNumberOfComponents();
+    int factor = (dims[0] + MaxWidth - 1) / MaxWidth;
+
+    /* Box filter down to at most MaxWidth, keeping RGB only */
+    int width = dims[0] / factor;
+    int height = dims[1] / factor;
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(width, height, 1);
+    image->AllocateScalars(VTK_FLOAT, 3);
+
+    const float* src = static_cast<const float*>(scalars->GetVoidPointer(0));
+    float* dst = static_cast<float*>(image->GetScalarPointer());
+    float weight = 1.f / (factor * factor);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float sum[3] = { 0.f, 0.f, 0.f };
+            for (int sy = 0; sy < factor; sy++) {
+                const float* row = src + ((size_t)(y * factor + sy) * dims[0] + (size_t)x * factor) * components;
+                for (int sx = 0; sx < factor; sx++)
+                    for (int c = 0; c < 3; c++)
+                        sum[c] += row[sx * components + c];
+            }
+            float* out = dst + ((size_t)y * width + x) * 3;
+            for (int c = 0; c < 3; c++)
+                out[c] = sum[c] * weight;
+        }
+    }
+
+    m_environment.image = image;
+    return true;
+}
+
+/*!
+ * \brief EnvironmentLoader::computeSphericalHarmonics
+ * Projects the environment onto the first 9 spherical harmonics. This is the irradiance map VTK
+ * uses for diffuse image-based lighting, computing it here keeps it off the GUI thread.
+ */
+void EnvironmentLoader::computeSphericalHarmonics() {
+    vtkNew<vtkSphericalHarmonics> sh;
+    sh->SetInputData(m_environment.image);
+    sh->Update();
+
+    vtkTable* table = vtkTable::SafeDownCast(sh->GetOutputDataObject(0));
+    if (table)
+        m_environment.sphericalHarmonics = vtkFloatArray::SafeDownCast(table->GetColumn(0));
+}
+
+/*!
+ * \brief EnvironmentLoader::readCache
+ * Cache layout: magic, width, height, number of SH tuples, SH coefficients (RGB floats), pixels (RGB floats)
+ * \param cacheFile the file to read
+ * \return true if the file was valid
+ */
+bool EnvironmentLoader::readCache(const QString& cacheFile) {
+    QFile file(cacheFile);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    char magic[8];
+    qint32 header[3];
+    if (file.read(magic, 8) != 8 || std::memcmp(magic, CacheMagic, 8) != 0)
+        return false;
+    if (file.read(reinterpret_cast<char*>(header), sizeof(header)) != sizeof(header))
+        return false;
+
+    qint32 width = header[0], height = header[1], shTuples = header[2];
+    if (width <= 0 || height <= 0 || shTuples < 0)
+        return false;
+
+    vtkSmartPointer<vtkFloatArray> coefficients;
+    if (shTuples > 0) {
+        coefficients = vtkSmartPointer<vtkFloatArray>::New();
+        coefficients->SetNumberOfComponents(3);
+        coefficients->SetNumberOfTuples(shTuples);
+        qint64 bytes = (qint64)shTuples * 3 * sizeof(float);
+        if (file.read(reinterpret_cast<char*>(coefficients->GetPointer(0)), bytes) != bytes)
+            return false;
+    }
+
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(width, height, 1);
+    image->AllocateScalars(VTK_FLOAT, 3);
+    qint64 bytes = (qint64)width * height * 3 * sizeof(float);
+    if (file.read(static_cast<char*>(image->GetScalarPointer()), bytes) != bytes)
+        return false;
+
+    m_environment.image = image;
+    m_environment.sphericalHarmonics = coefficients;
+    return true;
+}
+
+/*!
+ * \brief EnvironmentLoader::writeCache
+ * Writes to a temporary file first so a half written cache file is never read
+ * \param cacheFile the file to write
+ * \return true on success
+ */
+bool EnvironmentLoader::writeCache(const QString& cacheFile) const {
+    QString temporary = cacheFile + ".part";
+    QFile file(temporary);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    int dims[3];
+    m_environment.image->GetDimensions(dims);
+    vtkFloatArray* coefficients = m_environment.sphericalHarmonics;
+    qint32 header[3] = { dims[0], dims[1], coefficients ? (qint32)coefficients->GetNumberOfTuples() : 0 };
+
+    file.write(CacheMagic, 8);
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    if (coefficients)
+        file.write(reinterpret_cast<const char*>(coefficients->GetPointer(0)), (qint64)header[2] * 3 * sizeof(float));
+    file.write(static_cast<const char*>(m_environment.image->GetScalarPointer()), (qint64)dims[0] * dims[1] * 3 * sizeof(float));
+    file.close();
+
+    QFile::remove(cacheFile);
+    return QFile::rename(temporary, cacheFile);
+}
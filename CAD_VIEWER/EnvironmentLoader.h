@@ -0,0 +1,109 @@
+/**     @file EnvironmentLoader.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Loads an equirectangular HDR environment on a worker thread for use as a skybox and
+  *     for image-based lighting, with a disk cache so an environment is only decoded once.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_ENVIRONMENTLOADER_H
+#define VIEWER_ENVIRONMENTLOADER_H
+
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkFloatArray.h>
+#include <vtkTexture.h>
+
+/*! \struct Environment
+ *  \brief A loaded environment, ready to be given to a renderer.
+ *  The image is shared (read only) between the desktop and VR textures so it is never decoded twice.
+ */
+struct Environment {
+    vtkSmartPointer<vtkImageData>   image;                  /*!< Equirectangular float RGB image */
+    vtkSmartPointer<vtkFloatArray>  sphericalHarmonics;     /*!< Irradiance as 9 RGB spherical harmonics coefficients */
+    vtkSmartPointer<vtkTexture>     texture;                /*!< Texture for the desktop renderer */
+};
+
+/*! \class EnvironmentLoader
+ *  \brief Job that loads a .hdr (or .exr if VTK has OpenEXR) equirectangular environment.
+ *  The irradiance is precomputed on the worker as spherical harmonics. The decoded (and if needed
+ *  downsampled) image and the coefficients are written to a cache file named after the SHA-1 of the
+ *  source file, so the next time the same environment is opened it is read back without decoding.
+ */
+class EnvironmentLoader {
+public:
+    /*!
+     * Constructor
+     * \param fileName is the environment file to load
+     */
+    EnvironmentLoader(const QString& fileName);
+
+    /*!
+     * \brief load loads the environment, called on a worker thread
+     * \return true if the environment was loaded
+     */
+    bool load();
+
+    /*!
+     * \brief fileName
+     * \return the file being loaded
+     */
+    QString fileName() const;
+
+    /*!
+     * \brief environment should be called once load() has returned
+     * \return the environment, its texture is null if loading failed
+     */
+    Environment environment() const;
+
+    /*!
+     * \brief sourceHash
+     * \return SHA-1 of the source file (hex), which names the cache file
+     */
+    QString sourceHash() const;
+
+    /*!
+     * \brief fromCache
+     * \return true if the environment was read from the disk cache
+     */
+    bool fromCache() const;
+
+    /*!
+     * \brief errorString
+     * \return the reason loading failed, empty on success
+     */
+    QString errorString() const;
+
+    /*!
+     * \brief cacheDirectory
+     * \return the folder environment cache files are kept in
+     */
+    static QString cacheDirectory();
+
+    /*!
+     * \brief makeTexture creates a texture from an already loaded image, used to give
+     * the VR renderer its own texture of the same image
+     * \param image is the equirectangular image
+     * \return the new texture
+     */
+    static vtkSmartPointer<vtkTexture> makeTexture(vtkImageData* image);
+
+    static constexpr int MaxWidth = 4096;   /*!< Larger images are downsampled to this width */
+
+private:
+    bool decode();
+    bool readCache(const QString& cacheFile);
+    bool writeCache(const QString& cacheFile) const;
+    void computeSphericalHarmonics();
+
+    QString                         m_fileName;
+    QString                         m_hash;
+    QString                         m_error;
+    bool                            m_fromCache;
+    Environment                     m_environment;
+};
+
+#endif
@@ -0,0 +1,128 @@
+/**     @file GeometryMemoryManager.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Memory budget for part geometry.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "GeometryMemoryManager.h"
+#include "ModelPart.h"
+
+#include <algorithm>
+
+/*!
+ * \brief GeometryMemoryManager::GeometryMemoryManager
+ * Constructor
+ * \param budgetBytes the budget in bytes
+ */
+GeometryMemoryManager::GeometryMemoryManager(qint64 budgetBytes)
+    : budgetBytes(budgetBytes), idleSeconds(DefaultIdleTimeout) {
+    clock.start();
+}
+
+void GeometryMemoryManager::add(ModelPart* part) {
+    Tracked& tracked = parts[part];
+    tracked.lastUsed = clock.elapsed();
+    tracked.evictedBytes = 0;
+}
+
+void GeometryMemoryManager::remove(ModelPart* part) {
+    parts.remove(part);
+}
+
+void GeometryMemoryManager::touch(ModelPart* part) {
+    auto it = parts.find(part);
+    if (it != parts.end())
+        it->lastUsed = clock.elapsed();
+}
+
+/*!
+ * \brief GeometryMemoryManager::enforce
+ * First evicts hidden parts that have been idle for longer than the idle timeout, then, while the resident
+ * total is over budget, evicts the least recently used hidden parts.
+ * \return the evicted parts
+ */
+QList<ModelPart*> GeometryMemoryManager::enforce() {
+    QList<ModelPart*> evicted;
+    qint64 now = clock.elapsed();
+    qint64 resident = 0;
+
+    QList<QPair<qint64, ModelPart*>> candidates;
+    for (auto it = parts.begin(); it != parts.end(); ++it) {
+        ModelPart* part = it.key();
+        if (part->isEvicted())
+            continue;
+
+        if (!part->visible() && idleSeconds > 0 && now - it->lastUsed > idleSeconds * 1000ll) {
+            evict(part, it.value());
+            evicted.append(part);
+            continue;
+        }
+
+        resident += part->residentBytes();
+        if (!part->visible())
+            candidates.append(qMakePair(it->lastUsed, part));
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const QPair<qint64, ModelPart*>& a, const QPair<qint64, ModelPart*>& b) {
+        return a.first < b.first;
+    });
+    for (const auto& candidate : candidates) {
+        if (resident <= budgetBytes)
+            break;
+        Tracked& tracked = parts[candidate.second];
+        evict(candidate.second, tracked);
+        resident -= tracked.evictedBytes;
+        evicted.append(candidate.second);
+    }
+
+    return evicted;
+}
+
+void GeometryMemoryManager::evict(ModelPart* part, Tracked& tracked) {
+    tracked.evictedBytes = part->residentBytes();
+    part->evictGeometry();
+}
+
+GeometryMemoryManager::Usage GeometryMemoryManager::usage() const {
+    Usage usage;
+    for (auto it = parts.begin(); it != parts.end(); ++it) {
+        if (it.key()->isEvicted()) {
+            usage.evictedBytes += it->evictedBytes;
+            usage.evictedParts++;
+        }
+        else {
+            usage.residentBytes += it.key()->residentBytes();
+            usage.residentParts++;
+        }
+    }
+    return usage;
+}
+
+QString GeometryMemoryManager::usageString() const {
+    Usage u = usage();
+    return QString("Geometry: %1MB resident (%2 parts), %3MB evicted (%4 parts), budget %5MB")
+        .arg(u.residentBytes / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(u.residentParts)
+        .arg(u.evictedBytes / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(u.evictedParts)
+        .arg(budgetBytes / (1024 * 1024));
+}
+
+void GeometryMemoryManager::setBudget(qint64 budgetBytes) {
+    this->budgetBytes = budgetBytes;
+}
+
+qint64 GeometryMemoryManager::budget() const {
+    return budgetBytes;
+}
+
+void GeometryMemoryManager::setIdleTimeout(int seconds) {
+    idleSeconds = seconds;
+}
+
+int GeometryMemoryManager::idleTimeout() const {
+    return idleSeconds;
+}
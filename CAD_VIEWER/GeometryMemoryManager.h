@@ -0,0 +1,104 @@
+/**     @file GeometryMemoryManager.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Keeps the geometry held in memory by the parts within a budget by dropping the
+  *     geometry of hidden parts, which is read back from the STL file when they are shown.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_GEOMETRYMEMORYMANAGER_H
+#define VIEWER_GEOMETRYMEMORYMANAGER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+class ModelPart;
+
+/*! \class GeometryMemoryManager
+ *  \brief Memory budget for part geometry.
+ *  Parts are registered once their geometry is loaded and touched whenever they are used. enforce()
+ *  evicts hidden parts that have not been used for a while, and if the resident geometry is still over
+ *  budget it evicts further hidden parts, least recently used first. Visible parts are never evicted.
+ *  An evicted part keeps its tree item, actor and settings, only its geometry is dropped; the caller
+ *  reloads it in the background when the part is shown again. Only used from the GUI thread.
+ *  Results held only by ClipCache are not counted, the cache keeps itself within its own budget.
+ */
+class GeometryMemoryManager {
+public:
+    /*! Resident and evicted totals over all registered parts */
+    struct Usage {
+        qint64 residentBytes = 0;   /*!< Geometry and clip results held in memory */
+        qint64 evictedBytes = 0;    /*!< Memory the evicted parts used before they were evicted */
+        int residentParts = 0;
+        int evictedParts = 0;
+    };
+
+    /*!
+     * Constructor
+     * \param budgetBytes is the most memory the part geometry should use
+     */
+    explicit GeometryMemoryManager(qint64 budgetBytes = DefaultBudget);
+
+    /*!
+     * \brief add starts tracking a part whose geometry has been loaded, or marks an evicted part resident again
+     * \param part is the part
+     */
+    void add(ModelPart* part);
+
+    /*!
+     * \brief remove stops tracking a part, called before the part is deleted
+     * \param part is the part
+     */
+    void remove(ModelPart* part);
+
+    /*!
+     * \brief touch marks a part as used now
+     * \param part is the part
+     */
+    void touch(ModelPart* part);
+
+    /*!
+     * \brief enforce evicts hidden parts that are idle or needed to get within budget
+     * \return the parts that were evicted
+     */
+    QList<ModelPart*> enforce();
+
+    /*!
+     * \brief usage
+     * \return the resident and evicted totals
+     */
+    Usage usage() const;
+
+    /*!
+     * \brief usageString formats the usage for the status bar
+     * \return one line summary
+     */
+    QString usageString() const;
+
+    void setBudget(qint64 budgetBytes);             /*!< \param budgetBytes the new budget in bytes */
+    qint64 budget() const;                          /*!< \return the budget in bytes */
+
+    void setIdleTimeout(int seconds);               /*!< \param seconds hidden parts unused for longer than this are evicted even within budget, 0 to disable */
+    int idleTimeout() const;                        /*!< \return the idle timeout in seconds */
+
+    static constexpr qint64 DefaultBudget = 8ll * 1024 * 1024 * 1024;  /*!< 8GB */
+    static constexpr int DefaultIdleTimeout = 300;                      /*!< 5 minutes */
+
+private:
+    struct Tracked {
+        qint64 lastUsed = 0;        /*!< Milliseconds on clock when last touched */
+        qint64 evictedBytes = 0;    /*!< Resident size at eviction, 0 while resident */
+    };
+
+    void evict(ModelPart* part, Tracked& tracked);
+
+    QHash<ModelPart*, Tracked>  parts;
+    QElapsedTimer               clock;
+    qint64                      budgetBytes;
+    int                         idleSeconds;
+};
+
+#endif
@@ -0,0 +1,206 @@
+/**     @file JobSystem.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Shared work-stealing task scheduler.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "JobSystem.h"
+#include "Trace.h"
+#include "Log.h"
+
+#include <QDebug>
+
+#include <exception>
+
+/* Index of the worker running on this thread, -1 for any other thread */
+static thread_local int workerIndex = -1;
+
+/*!
+ * \brief JobSystem::instance
+ * \return the shared job system
+ */
+JobSystem& JobSystem::instance() {
+    static JobSystem jobs;
+    return jobs;
+}
+
+/*!
+ * \brief JobSystem::JobSystem
+ * Constructor, starts the workers
+ * \param threadCount number of workers, 0 for one per core less one
+ */
+JobSystem::JobSystem(int threadCount)
+    : queued(0), pending(0), nextWorker(0), stopping(false) {
+    if (threadCount <= 0) {
+        int cores = (int)std::thread::hardware_concurrency();
+        threadCount = cores > 2 ? cores - 1 : 2;
+    }
+
+    for (int i = 0; i < threadCount; i++)
+        workers.push_back(std::make_unique<Worker>());
+    for (int i = 0; i < threadCount; i++)
+        workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+}
+
+/*!
+ * \brief JobSystem::~JobSystem
+ * Destructor, runs when the program exits. The jobs still queued are dropped, so quitting does not wait for
+ * work nobody will see, and the workers are joined once the jobs they are running return. Tools that need
+ * every job to finish call waitForIdle() first.
+ */
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    for (auto& w : workers) {
+        std::lock_guard<std::mutex> lock(w->mutex);
+        for (auto& q : w->queues) {
+            queued -= (int)q.size();
+            pending -= (int)q.size();
+            q.clear();
+        }
+    }
+    wake.notify_all();
+    for (auto& w : workers)
+        w->thread.join();
+}
+
+int JobSystem::threadCount() const {
+    return (int)workers.size();
+}
+
+int JobSystem::pendingCount() const {
+    return pending;
+}
+
+int JobSystem::currentWorker() {
+    return workerIndex;
+}
+
+/*!
+ * \brief JobSystem::submit
+ * Jobs from a worker go on its own queue, jobs from other threads are handed out round robin
+ * \param task the job
+ * \param priority the priority of the job
+ */
+void JobSystem::submit(Task task, JobPriority priority) {
+    // Jobs submitted by running jobs while the program exits are dropped like the queued ones
+    if (stopping)
+        return;
+
+    int target = workerIndex;
+    if (target < 0)
+        target = (int)(nextWorker++ % workers.size());
+
+    pending++;
+    {
+        Worker& w = *workers[target];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.queues[(int)priority].push_back(std::move(task));
+    }
+    queued++;
+
+    /* Take the sleep lock so a worker checking for work cannot miss the notification */
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+/*!
+ * \brief JobSystem::take
+ * Finds the next job for a worker. For each priority, highest first, the worker's own queue is checked and
+ * then the other workers' queues, so a high priority job anywhere is run before any lower priority job.
+ */
+bool JobSystem::take(int index, Task& task) {
+    for (int priority = 0; priority < 3; priority++) {
+        if (popLocal(index, priority, task) || steal(index, priority, task))
+            return true;
+    }
+    return false;
+}
+
+/*!
+ * \brief JobSystem::popLocal
+ * Takes the newest job of the given priority from the worker's own queue
+ */
+bool JobSystem::popLocal(int index, int priority, Task& task) {
+    Worker& w = *workers[index];
+    std::lock_guard<std::mutex> lock(w.mutex);
+    auto& q = w.queues[priority];
+    if (q.empty())
+        return false;
+    task = std::move(q.back());
+    q.pop_back();
+    return true;
+}
+
+/*!
+ * \brief JobSystem::steal
+ * Takes the oldest job of the given priority from another worker
+ */
+bool JobSystem::steal(int thief, int priority, Task& task) {
+    int n = (int)workers.size();
+    for (int i = 1; i < n; i++) {
+        Worker& victim = *workers[(thief + i) % n];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock())
+            continue;
+        auto& q = victim.queues[priority];
+        if (!q.empty()) {
+            task = std::move(q.front());
+            q.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::workerLoop(int index) {
+    workerIndex = index;
+    Trace::setThreadName(QString("Worker %1").arg(index));
+
+    while (true) {
+        Task task;
+        if (take(index, task)) {
+            queued--;
+            try {
+                TRACE_ZONE("job");
+                task();
+            }
+            catch (const std::exception& e) {
+                LOG_ERROR(Jobs) << "Job failed:" << e.what();
+            }
+            catch (...) {
+                LOG_ERROR(Jobs) << "Job failed with an unknown exception";
+            }
+
+            if (--pending == 0) {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                idle.notify_all();
+            }
+            continue;
+        }
+
+        /* Nothing found (a steal can miss a job when a lock is busy, so only sleep if nothing is queued) */
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (stopping)
+            return;
+        wake.wait(lock, [this]() { return queued > 0 || stopping; });
+        if (stopping && queued == 0)
+            return;
+    }
+}
+
+/*!
+ * \brief JobSystem::waitForIdle
+ * Blocks until there are no jobs queued or running
+ */
+void JobSystem::waitForIdle() {
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    idle.wait(lock, [this]() { return pending == 0; });
+}
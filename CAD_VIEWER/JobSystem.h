@@ -0,0 +1,165 @@
+/**     @file JobSystem.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Shared work-stealing task scheduler. Heavy work (loading, clipping, image processing)
+  *     is run on a pool of worker threads and its result is handed back to the GUI thread,
+  *     so the GUI thread never has to wait for it.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_JOBSYSTEM_H
+#define VIEWER_JOBSYSTEM_H
+
+#include <QObject>
+#include <QPointer>
+#include <QMetaObject>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*! Priority of a job, workers always take the highest priority job available */
+enum class JobPriority {
+    High = 0,       /*!< Work the user is waiting to see, e.g. the part they just edited */
+    Normal = 1,     /*!< Default */
+    Low = 2         /*!< Background work, e.g. pre-computing caches */
+};
+
+/*! \class CancellationToken
+ *  \brief Shared flag used to cancel a job.
+ *  Copies of a token share the same flag. Cancelling stops a job that has not started, stops its
+ *  continuation from running, and long running work can check isCancelled() to stop early.
+ */
+class CancellationToken {
+public:
+    /*! Constructor, creates a new (not cancelled) flag */
+    CancellationToken() : m_flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    /*! \brief cancel sets the flag for every copy of this token */
+    void cancel() const { m_flag->store(true); }
+
+    /*! \brief isCancelled \return true if cancel() has been called on any copy */
+    bool isCancelled() const { return m_flag->load(); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
+/*! \class JobSystem
+ *  \brief Pool of worker threads with per-worker deques and work stealing.
+ *  Each worker has its own queue for each priority. A job submitted from a worker goes on that
+ *  worker's queue and is taken newest first (it is likely to use data still in cache), idle workers
+ *  steal the oldest jobs from the other workers. Jobs submitted from other threads are spread over
+ *  the workers in turn. Every queue is checked for a higher priority job before a lower priority
+ *  job is taken from any of them.
+ */
+class JobSystem {
+public:
+    using Task = std::function<void()>;
+
+    /*!
+     * \brief instance
+     * \return the shared job system, created on first use with one worker per core (less one for the GUI)
+     */
+    static JobSystem& instance();
+
+    /*!
+     * Constructor
+     * \param threadCount is the number of workers, 0 to choose from the number of cores
+     */
+    explicit JobSystem(int threadCount = 0);
+
+    /*! Destructor, drops the jobs still queued and joins the workers once their running jobs return */
+    ~JobSystem();
+
+    /*!
+     * \brief submit queues a job
+     * \param task is the job to run
+     * \param priority is the priority of the job
+     */
+    void submit(Task task, JobPriority priority = JobPriority::Normal);
+
+    /*!
+     * \brief run queues a job whose result is passed to a continuation on the context object's thread
+     * (the GUI thread for widgets). Neither the job nor the continuation run if the token is cancelled first.
+     * \param work is called on a worker as work(token) and returns the result
+     * \param context is the object the continuation runs for, it is not run if the object has been deleted
+     * \param continuation is called as continuation(result) on the context's thread
+     * \param token can be used to cancel the job
+     * \param priority is the priority of the job
+     */
+    template <typename Work, typename Continuation>
+    void run(Work work, QObject* context, Continuation continuation,
+             CancellationToken token = CancellationToken(), JobPriority priority = JobPriority::Normal);
+
+    /*!
+     * \brief waitForIdle blocks until every queued and running job has finished. Only for tools
+     * without an event loop (batch mode, benchmarks), the GUI thread must never call this.
+     */
+    void waitForIdle();
+
+    /*!
+     * \brief threadCount
+     * \return the number of worker threads
+     */
+    int threadCount() const;
+
+    /*!
+     * \brief pendingCount
+     * \return the number of jobs queued or running
+     */
+    int pendingCount() const;
+
+    /*!
+     * \brief currentWorker
+     * \return index of the worker the calling thread is, or -1 if it is not a worker
+     */
+    static int currentWorker();
+
+private:
+    struct Worker {
+        std::mutex          mutex;
+        std::deque<Task>    queues[3];      /*!< One queue per priority */
+        std::thread         thread;
+    };
+
+    void workerLoop(int index);
+    bool take(int index, Task& task);
+    bool popLocal(int index, int priority, Task& task);
+    bool steal(int thief, int priority, Task& task);
+
+    std::vector<std::unique_ptr<Worker>>    workers;
+    std::atomic<int>                        queued;         /*!< Jobs waiting in a queue */
+    std::atomic<int>                        pending;        /*!< Jobs queued or running */
+    std::atomic<unsigned>                   nextWorker;
+    std::atomic<bool>                       stopping;
+
+    std::mutex                              sleepMutex;
+    std::condition_variable                 wake;           /*!< Signalled when a job is queued */
+    std::condition_variable                 idle;           /*!< Signalled when pending reaches 0 */
+};
+
+
+template <typename Work, typename Continuation>
+void JobSystem::run(Work work, QObject* context, Continuation continuation, CancellationToken token, JobPriority priority) {
+    QPointer<QObject> guard(context);
+    submit([work, guard, continuation, token]() mutable {
+        if (token.isCancelled())
+            return;
+        auto result = work(token);
+        if (token.isCancelled() || !guard)
+            return;
+        QMetaObject::invokeMethod(guard.data(), [continuation, token, result]() mutable {
+            if (!token.isCancelled())
+                continuation(std::move(result));
+        }, Qt::QueuedConnection);
+    }, priority);
+}
+
+#endif
@@ -0,0 +1,139 @@
+/**     @file LatencyHistogram.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Lock-free histogram of durations.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*!
+ * \brief LatencyHistogram::LatencyHistogram
+ * Constructor
+ * \param name label for the histogram
+ */
+LatencyHistogram::LatencyHistogram(const QString& name)
+    : m_name(name) {
+    reset();
+}
+
+/*!
+ * \brief LatencyHistogram::bucketFor
+ * Bucket 0 holds everything under 1us, after that each power of two is split linearly into SubBuckets
+ * \param us duration in microseconds
+ * \return index of the bucket
+ */
+int LatencyHistogram::bucketFor(quint64 us) {
+    if (us < 1)
+        return 0;
+
+    /* Index of the leading one bit (portable, MSVC has no __builtin_clzll) */
+    int octave = 0;
+    while ((us >> (octave + 1)) != 0)
+        octave++;
+    if (octave >= Octaves)
+        return BucketCount - 1;
+
+    /* Position within the octave, using the bits below the leading one */
+    int sub;
+    if (octave >= 3)
+        sub = (int)((us >> (octave - 3)) & (SubBuckets - 1));
+    else
+        sub = (int)((us << (3 - octave)) & (SubBuckets - 1));
+
+    return 1 + octave * SubBuckets + sub;
+}
+
+/*!
+ * \brief LatencyHistogram::bucketUpperBound
+ * \param bucket index of the bucket
+ * \return upper edge of the bucket in milliseconds
+ */
+double LatencyHistogram::bucketUpperBound(int bucket) {
+    if (bucket <= 0)
+        return 0.001;
+    int octave = (bucket - 1) / SubBuckets;
+    int sub = (bucket - 1) % SubBuckets;
+    double us = std::ldexp(1.0 + (sub + 1) / (double)SubBuckets, octave);
+    return us / 1000.0;
+}
+
+void LatencyHistogram::record(double ms) {
+    quint64 us = ms > 0. ? (quint64)(ms * 1000.0) : 0;
+
+    buckets[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+    samples.fetch_add(1, std::memory_order_relaxed);
+    totalUs.fetch_add(us, std::memory_order_relaxed);
+
+    quint64 previous = maxUs.load(std::memory_order_relaxed);
+    while (us > previous && !maxUs.compare_exchange_weak(previous, us, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < BucketCount; i++)
+        buckets[i].store(0, std::memory_order_relaxed);
+    samples.store(0, std::memory_order_relaxed);
+    totalUs.store(0, std::memory_order_relaxed);
+    maxUs.store(0, std::memory_order_relaxed);
+}
+
+QString LatencyHistogram::name() const {
+    return m_name;
+}
+
+quint64 LatencyHistogram::count() const {
+    return samples.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const {
+    quint64 n = count();
+    if (n == 0)
+        return 0.;
+    return totalUs.load(std::memory_order_relaxed) / 1000.0 / n;
+}
+
+double LatencyHistogram::max() const {
+    return maxUs.load(std::memory_order_relaxed) / 1000.0;
+}
+
+/*!
+ * \brief LatencyHistogram::percentile
+ * Walks the buckets until p% of the samples have been passed. As samples may be recorded while this
+ * runs, the total is taken from the buckets themselves so the result is always consistent.
+ * \param p the percentile wanted, 0 - 100
+ * \return upper edge of the bucket containing the percentile, in milliseconds
+ */
+double LatencyHistogram::percentile(double p) const {
+    quint64 counts[BucketCount];
+    quint64 total = 0;
+    for (int i = 0; i < BucketCount; i++) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0)
+        return 0.;
+
+    quint64 target = (quint64)std::ceil(total * p / 100.0);
+    if (target < 1)
+        target = 1;
+
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; i++) {
+        seen += counts[i];
+        if (seen >= target)
+            return std::min(bucketUpperBound(i), max());
+    }
+    return max();
+}
+
+quint64 LatencyHistogram::bucketCount(int bucket) const {
+    if (bucket < 0 || bucket >= BucketCount)
+        return 0;
+    return buckets[bucket].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,102 @@
+/**     @file LatencyHistogram.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Lock-free histogram of durations, used to record frame timings from the
+  *     VR thread while the GUI thread reads them.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_LATENCYHISTOGRAM_H
+#define VIEWER_LATENCYHISTOGRAM_H
+
+#include <QString>
+
+#include <atomic>
+
+/*! \class LatencyHistogram
+ *  \brief Histogram of durations with log-spaced buckets.
+ *  Each power of two (in microseconds) is split into 8 buckets, so any percentile is reported to
+ *  within about 12% of its true value from 1us up to several seconds. Recording is a handful of
+ *  relaxed atomic increments, so it can be called every frame by one thread while another thread
+ *  reads the percentiles.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SubBuckets = 8;                        /*!< Buckets per power of two */
+    static constexpr int Octaves = 24;                          /*!< Powers of two covered (1us to ~16s) */
+    static constexpr int BucketCount = 1 + Octaves * SubBuckets;
+
+    /*!
+     * Constructor
+     * \param name is used as the label when the histogram is written out
+     */
+    LatencyHistogram(const QString& name = QString());
+
+    /*!
+     * \brief record adds one sample, safe to call from any thread
+     * \param ms duration in milliseconds
+     */
+    void record(double ms);
+
+    /*!
+     * \brief reset clears all samples
+     */
+    void reset();
+
+    /*!
+     * \brief name
+     * \return the label of the histogram
+     */
+    QString name() const;
+
+    /*!
+     * \brief count
+     * \return the number of samples recorded
+     */
+    quint64 count() const;
+
+    /*!
+     * \brief mean
+     * \return the mean duration in milliseconds
+     */
+    double mean() const;
+
+    /*!
+     * \brief max
+     * \return the longest duration recorded in milliseconds
+     */
+    double max() const;
+
+    /*!
+     * \brief percentile
+     * \param p is the percentile wanted, 0 - 100
+     * \return the duration in milliseconds below which p% of the samples fall
+     */
+    double percentile(double p) const;
+
+    /*!
+     * \brief bucketCount
+     * \param bucket index of the bucket
+     * \return number of samples in the bucket
+     */
+    quint64 bucketCount(int bucket) const;
+
+    /*!
+     * \brief bucketUpperBound
+     * \param bucket index of the bucket
+     * \return the upper edge of the bucket in milliseconds
+     */
+    static double bucketUpperBound(int bucket);
+
+private:
+    static int bucketFor(quint64 us);
+
+    QString                 m_name;
+    std::atomic<quint64>    buckets[BucketCount];
+    std::atomic<quint64>    samples;
+    std::atomic<quint64>    totalUs;
+    std::atomic<quint64>    maxUs;
+};
+
+#endif
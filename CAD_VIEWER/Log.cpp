@@ -0,0 +1,234 @@
+/**     @file Log.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Categorised, levelled logging into a lock-free ring buffer.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "Log.h"
+
+#include <QStringList>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+std::atomic<int> Log::levels[(int)LogCategory::Count] = {
+    { (int)LogLevel::Info }, { (int)LogLevel::Info }, { (int)LogLevel::Info }, { (int)LogLevel::Info },
+    { (int)LogLevel::Info }, { (int)LogLevel::Info }, { (int)LogLevel::Info }
+};
+
+namespace {
+
+/*! One message. sequence is odd while the slot is being written and 2 * (index + 1) once message
+ *  number index is in it, so a reader can tell a torn or overwritten slot and skip it. */
+struct Slot {
+    std::atomic<quint64>    sequence{ 0 };
+    qint64                  timeUs = 0;
+    int                     thread = 0;
+    LogLevel                level = LogLevel::Info;
+    LogCategory             category = LogCategory::Model;
+    char                    text[Log::MessageSize] = {};
+};
+
+Slot                    ring[Log::Slots];
+std::atomic<quint64>    head(0);
+std::atomic<int>        echoLevel((int)LogLevel::Info);
+std::atomic<int>        nextThread(1);
+char                    crashFileName[1024] = {};   // Empty for no crash file
+const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+int threadNumber() {
+    thread_local int number = nextThread.fetch_add(1, std::memory_order_relaxed);
+    return number;
+}
+
+/*!
+ * \brief readSlot copies a slot if it holds a complete message
+ * \return true if the copy is consistent
+ */
+bool readSlot(const Slot& slot, Slot& copy, quint64& index) {
+    quint64 before = slot.sequence.load(std::memory_order_acquire);
+    if (before == 0 || (before & 1))
+        return false;
+    copy.timeUs = slot.timeUs;
+    copy.thread = slot.thread;
+    copy.level = slot.level;
+    copy.category = slot.category;
+    std::memcpy(copy.text, slot.text, sizeof(copy.text));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != before)
+        return false;
+    copy.text[Log::MessageSize - 1] = '\0';
+    index = before / 2 - 1;
+    return true;
+}
+
+/*!
+ * \brief formatLine formats a message as one line without allocating
+ */
+int formatLine(char* line, size_t size, qint64 timeUs, int thread, LogLevel level, LogCategory category, const char* text) {
+    return std::snprintf(line, size, "%10.3f [%d] %-7s %-6s %s\n", timeUs / 1000.0, thread,
+                         Log::levelName(level), Log::categoryName(category), text);
+}
+
+/*!
+ * \brief dumpRing writes the ring oldest first, only fixed size buffers are used so it can run
+ * in the crash handler
+ */
+void dumpRing(FILE* file) {
+    quint64 end = head.load(std::memory_order_acquire);
+    quint64 start = end > (quint64)Log::Slots ? end - Log::Slots : 0;
+    char line[Log::MessageSize + 64];
+    for (quint64 i = start; i < end; i++) {
+        Slot copy;
+        quint64 index;
+        if (!readSlot(ring[i % Log::Slots], copy, index) || index != i)
+            continue;
+        int length = formatLine(line, sizeof(line), copy.timeUs, copy.thread, copy.level, copy.category, copy.text);
+        if (length > 0)
+            std::fwrite(line, 1, std::min<size_t>(length, sizeof(line) - 1), file);
+    }
+    std::fflush(file);
+}
+
+void crashDump(const char* reason) {
+    std::fprintf(stderr, "\n*** %s, last log messages:\n", reason);
+    dumpRing(stderr);
+    // The file is only created when there is a crash to write, a normal run leaves nothing behind
+    FILE* crashFile = crashFileName[0] ? std::fopen(crashFileName, "a") : nullptr;
+    if (crashFile) {
+        std::fprintf(crashFile, "*** %s\n", reason);
+        dumpRing(crashFile);
+        std::fclose(crashFile);
+    }
+}
+
+extern "C" void onCrashSignal(int signal) {
+    crashDump(signal == SIGSEGV ? "Segmentation fault" : signal == SIGABRT ? "Abort" : "Fatal signal");
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+void onTerminate() {
+    crashDump("Terminated");
+    // abort() raises SIGABRT, which would otherwise be caught by onCrashSignal and dumped a second time
+    std::signal(SIGABRT, SIG_DFL);
+    std::abort();
+}
+
+LogLevel parseLevel(const QString& name, bool* ok) {
+    static const char* names[] = { "trace", "debug", "info", "warning", "error" };
+    for (int i = 0; i < 5; i++)
+        if (name == QLatin1String(names[i])) {
+            *ok = true;
+            return (LogLevel)i;
+        }
+    *ok = false;
+    return LogLevel::Info;
+}
+
+}
+
+const char* Log::levelName(LogLevel level) {
+    static const char* names[] = { "TRACE", "DEBUG", "INFO", "WARNING", "ERROR" };
+    return names[(int)level];
+}
+
+const char* Log::categoryName(LogCategory category) {
+    static const char* names[] = { "model", "clip", "jobs", "render", "vr", "ui", "io" };
+    return names[(int)category];
+}
+
+void Log::setLevel(LogCategory category, LogLevel level) {
+    levels[(int)category].store((int)level, std::memory_order_relaxed);
+}
+
+void Log::setLevel(LogLevel level) {
+    for (int i = 0; i < (int)LogCategory::Count; i++)
+        setLevel((LogCategory)i, level);
+}
+
+void Log::setEchoLevel(LogLevel level) {
+    echoLevel.store((int)level, std::memory_order_relaxed);
+}
+
+/*!
+ * \brief Log::configure
+ * Unknown names are ignored, so a typo never stops the program starting
+ */
+void Log::configure() {
+    QString setting = qEnvironmentVariable("WS6_LOG").toLower();
+    for (const QString& entry : setting.split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        int colon = entry.indexOf(':');
+        LogLevel level = parseLevel(entry.mid(colon + 1).trimmed(), &ok);
+        if (!ok)
+            continue;
+        if (colon < 0) {
+            setLevel(level);
+            continue;
+        }
+        QString category = entry.left(colon).trimmed();
+        for (int i = 0; i < (int)LogCategory::Count; i++)
+            if (category == QLatin1String(categoryName((LogCategory)i)))
+                setLevel((LogCategory)i, level);
+    }
+}
+
+/*!
+ * \brief Log::write
+ * Claims the next slot with one atomic increment and fills it in. With thousands of slots a writer
+ * only meets another on the same slot if the ring wraps while it is writing, the reader then skips it.
+ */
+void Log::write(LogLevel level, LogCategory category, const QString& message) {
+    quint64 index = head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = ring[index % Slots];
+
+    qint64 timeUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+    int thread = threadNumber();
+    QByteArray utf8 = message.toUtf8();
+    size_t length = std::min<size_t>(utf8.size(), MessageSize - 1);
+
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timeUs = timeUs;
+    slot.thread = thread;
+    slot.level = level;
+    slot.category = category;
+    std::memcpy(slot.text, utf8.constData(), length);
+    slot.text[length] = '\0';
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+
+    if ((int)level >= echoLevel.load(std::memory_order_relaxed)) {
+        char line[MessageSize + 64];
+        if (formatLine(line, sizeof(line), timeUs, thread, level, category, utf8.left((int)length).constData()) > 0)
+            std::fputs(line, stderr);
+    }
+}
+
+bool Log::dump(const QString& fileName) {
+    FILE* file = std::fopen(fileName.toLocal8Bit().constData(), "w");
+    if (!file)
+        return false;
+    dumpRing(file);
+    return std::fclose(file) == 0;
+}
+
+void Log::installCrashHandler(const QString& fileName) {
+    // The name is converted now so the handler does not allocate, a name too long for the buffer is not used
+    QByteArray name = fileName.toLocal8Bit();
+    if (name.size() < (int)sizeof(crashFileName))
+        std::memcpy(crashFileName, name.constData(), name.size() + 1);
+    std::signal(SIGSEGV, onCrashSignal);
+    std::signal(SIGABRT, onCrashSignal);
+    std::signal(SIGFPE, onCrashSignal);
+    std::signal(SIGILL, onCrashSignal);
+    std::set_terminate(onTerminate);
+}
@@ -0,0 +1,134 @@
+/**     @file Log.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Categorised, levelled logging into a lock-free ring buffer that can be
+  *     dumped on request or when the program crashes.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_LOG_H
+#define VIEWER_LOG_H
+
+#include <QDebug>
+#include <QString>
+
+#include <atomic>
+
+/*! Severity of a message, in increasing order */
+enum class LogLevel : int { Trace, Debug, Info, Warning, Error };
+
+/*! Part of the program a message comes from, each has its own runtime level */
+enum class LogCategory : int { Model, Clip, Jobs, Render, VR, UI, IO, Count };
+
+/*! Messages below this level are removed by the compiler. Set WS6_LOG_MIN_LEVEL to 0 to keep Trace
+ *  messages in a release build, or higher to strip more. */
+#ifndef WS6_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define WS6_LOG_MIN_LEVEL 2
+#else
+#define WS6_LOG_MIN_LEVEL 1
+#endif
+#endif
+
+/*! \class Log
+ *  \brief Writes messages into a fixed ring of slots that every thread can append to without a lock.
+ *  A message is only formatted if its level passes both the compile-time minimum and the category's
+ *  runtime level, which is one relaxed atomic load, so disabled messages in hot paths cost next to
+ *  nothing. Messages at or above the echo level are also printed to stderr as qDebug did.
+ */
+class Log {
+public:
+    static constexpr int Slots = 4096;          /*!< Messages kept in the ring */
+    static constexpr int MessageSize = 232;     /*!< Bytes of UTF-8 kept per message, longer ones are cut */
+
+    /*!
+     * \brief enabled
+     * \return true if a message of this level and category would be recorded
+     */
+    static bool enabled(LogLevel level, LogCategory category) {
+        return (int)level >= levels[(int)category].load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief setLevel sets the lowest level recorded for a category
+     */
+    static void setLevel(LogCategory category, LogLevel level);
+
+    /*!
+     * \brief setLevel sets the lowest level recorded for every category
+     */
+    static void setLevel(LogLevel level);
+
+    /*!
+     * \brief setEchoLevel sets the lowest level also printed to stderr
+     */
+    static void setEchoLevel(LogLevel level);
+
+    /*!
+     * \brief configure reads the levels from the WS6_LOG environment variable, a comma separated list of
+     * "level" for every category or "category:level", e.g. WS6_LOG=info,clip:trace
+     */
+    static void configure();
+
+    /*!
+     * \brief write records a message, safe to call from any thread
+     */
+    static void write(LogLevel level, LogCategory category, const QString& message);
+
+    /*!
+     * \brief dump writes the messages in the ring, oldest first
+     * \param fileName the text file
+     * \return true if the file was written
+     */
+    static bool dump(const QString& fileName);
+
+    /*!
+     * \brief installCrashHandler dumps the ring to stderr and to a file if the program crashes or terminates
+     * \param fileName the file to append to, empty for none. It is only opened when there is a crash to write.
+     */
+    static void installCrashHandler(const QString& fileName);
+
+    static const char* levelName(LogLevel level);
+    static const char* categoryName(LogCategory category);
+
+private:
+    static std::atomic<int> levels[(int)LogCategory::Count];
+};
+
+/*! \class LogLine
+ *  \brief Collects one message with the same << operators as qDebug() and writes it when destroyed
+ */
+class LogLine {
+public:
+    LogLine(LogLevel level, LogCategory category)
+        : level(level), category(category), stream(&text) {
+    }
+    ~LogLine() {
+        Log::write(level, category, text);
+    }
+
+    QDebug& debug() { return stream; }
+
+private:
+    LogLevel        level;
+    LogCategory     category;
+    QString         text;
+    QDebug          stream;
+};
+
+/*! Streams a message, e.g. LOG(Debug, Clip) << "planes" << minX; the arguments are not evaluated
+ *  when the message is disabled */
+#define LOG(level, category)                                                                        \
+    if ((int)LogLevel::level < WS6_LOG_MIN_LEVEL || !Log::enabled(LogLevel::level, LogCategory::category)) \
+        ;                                                                                           \
+    else                                                                                            \
+        LogLine(LogLevel::level, LogCategory::category).debug()
+
+#define LOG_TRACE(category)     LOG(Trace, category)
+#define LOG_DEBUG(category)     LOG(Debug, category)
+#define LOG_INFO(category)      LOG(Info, category)
+#define LOG_WARNING(category)   LOG(Warning, category)
+#define LOG_ERROR(category)     LOG(Error, category)
+
+#endif
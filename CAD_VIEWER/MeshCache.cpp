@@ -0,0 +1,154 @@
+/**     @file MeshCache.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Disk cache of imported meshes, so a part that has been welded, smoothed
+  *     and optimised once is read back ready to draw.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "MeshCache.h"
+#include "CompactMesh.h"
+#include "Trace.h"
+#include "Log.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <algorithm>
+
+#include <vtkNew.h>
+#include <vtkXMLPolyDataReader.h>
+#include <vtkXMLPolyDataWriter.h>
+
+/* Part of every key, change it when the stored mesh changes so old entries are never read */
+static const char CacheVersion[] = "WS6MESH01";
+
+/*!
+ * \brief MeshCache::cacheDirectory
+ * \return the meshes folder in the user's cache location
+ */
+QString MeshCache::cacheDirectory() {
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("meshes");
+}
+
+QString MeshCache::key(const QString& fileName, const QString& settings) {
+    QFileInfo info(fileName);
+    if (!info.exists())
+        return QString();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(CacheVersion);
+    hash.addData(info.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    hash.addData(settings.toUtf8());
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+/*!
+ * \brief MeshCache::read
+ * The XML reader gives 64-bit cells, they are converted back to the 32-bit form the import makes
+ */
+vtkSmartPointer<vtkPolyData> MeshCache::read(const QString& key) {
+    if (key.isEmpty())
+        return nullptr;
+    QString cacheFile = QDir(cacheDirectory()).filePath(key + ".vtp");
+    if (!QFile::exists(cacheFile))
+        return nullptr;
+
+    TRACE_ZONE("meshCacheRead");
+    vtkNew<vtkXMLPolyDataReader> reader;
+    reader->SetFileName(cacheFile.toLocal8Bit());
+    reader->Update();
+    vtkPolyData* output = reader->GetOutput();
+    if (reader->GetErrorCode() != 0 || !output || output->GetNumberOfPolys() == 0) {
+        LOG_WARNING(IO) << "Ignoring unreadable mesh cache entry" << cacheFile;
+        return nullptr;
+    }
+
+    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+    mesh->ShallowCopy(output);
+    CompactMesh::use32BitCells(mesh);
+    LOG_DEBUG(IO) << "Read cached mesh" << cacheFile;
+
+    // The modification time records the last use for trim(), access times are often not kept
+    QFile used(cacheFile);
+    if (used.open(QIODevice::ReadWrite))
+        used.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return mesh;
+}
+
+bool MeshCache::write(const QString& key, vtkPolyData* mesh) {
+    if (key.isEmpty() || !mesh || mesh->GetNumberOfPolys() == 0)
+        return false;
+
+    TRACE_ZONE("meshCacheWrite");
+    QDir().mkpath(cacheDirectory());
+    QString cacheFile = QDir(cacheDirectory()).filePath(key + ".vtp");
+    // Two workers may import the same file at once, each writes its own temporary file
+    QString temporary = QString("%1.%2.part").arg(cacheFile).arg((quintptr)QThread::currentThreadId());
+
+    vtkNew<vtkXMLPolyDataWriter> writer;
+    writer->SetInputData(mesh);
+    writer->SetFileName(temporary.toLocal8Bit());
+    writer->SetDataModeToAppended();
+    writer->EncodeAppendedDataOff();
+    writer->SetCompressorTypeToLZ4();
+    writer->SetHeaderTypeToUInt64();
+    if (!writer->Write()) {
+        LOG_WARNING(IO) << "Could not write mesh cache entry" << cacheFile;
+        QFile::remove(temporary);
+        return false;
+    }
+
+    QFile::remove(cacheFile);
+    if (!QFile::rename(temporary, cacheFile)) {
+        QFile::remove(temporary);
+        return false;
+    }
+    trim();
+    return true;
+}
+
+/*!
+ * \brief MeshCache::trim
+ * Entries are removed oldest use first. Two workers may trim at once, an entry one of them has already
+ * removed just fails to remove again.
+ */
+qint64 MeshCache::trim(qint64 budgetBytes) {
+    QFileInfoList entries = QDir(cacheDirectory()).entryInfoList({ "*.vtp" }, QDir::Files);
+    qint64 total = 0;
+    for (const QFileInfo& entry : entries)
+        total += entry.size();
+    if (total <= budgetBytes)
+        return 0;
+
+    std::sort(entries.begin(), entries.end(), [](const QFileInfo& a, const QFileInfo& b) {
+        return a.lastModified() < b.lastModified();
+    });
+    qint64 removed = 0;
+    for (const QFileInfo& entry : entries) {
+        if (total - removed <= budgetBytes)
+            break;
+        if (QFile::remove(entry.absoluteFilePath()))
+            removed += entry.size();
+    }
+    LOG_INFO(IO) << "Mesh cache over budget, removed" << removed / (1024 * 1024) << "MB";
+    return removed;
+}
+
+qint64 MeshCache::clear() {
+    qint64 removed = 0;
+    for (const QFileInfo& entry : QDir(cacheDirectory()).entryInfoList({ "*.vtp" }, QDir::Files)) {
+        if (QFile::remove(entry.absoluteFilePath()))
+            removed += entry.size();
+    }
+    LOG_INFO(IO) << "Mesh cache cleared," << removed / (1024 * 1024) << "MB removed";
+    return removed;
+}
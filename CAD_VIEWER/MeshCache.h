@@ -0,0 +1,73 @@
+/**     @file MeshCache.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Disk cache of imported meshes, so a part that has been welded, smoothed
+  *     and optimised once is read back ready to draw.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_MESHCACHE_H
+#define VIEWER_MESHCACHE_H
+
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+/*! \class MeshCache
+ *  \brief Meshes stored as VTK XML polydata (.vtp, raw appended LZ4 data) in the user's cache folder.
+ *  An entry is keyed by the source file's path, size and modification time and by the import settings, so
+ *  editing the STL or changing a setting makes a new entry. The file is not hashed like an environment is
+ *  (see EnvironmentLoader) as hashing a multi-GB STL would cost as much as reading it. The folder is kept
+ *  under a byte budget: reading an entry marks it as used and each write removes the least recently used
+ *  entries once the total is over the budget. All the functions are safe to call from worker threads.
+ */
+class MeshCache {
+public:
+    static constexpr qint64 DefaultBudget = 2048ll * 1024 * 1024;  /*!< 2GB */
+
+    /*!
+     * \brief cacheDirectory
+     * \return the meshes folder in the user's cache location
+     */
+    static QString cacheDirectory();
+
+    /*!
+     * \brief key names the cache entry of a file imported with some settings
+     * \param fileName the source file
+     * \param settings the import settings as text, part of the key
+     * \return the key, empty if the file does not exist
+     */
+    static QString key(const QString& fileName, const QString& settings);
+
+    /*!
+     * \brief read loads a cached mesh
+     * \param key from key()
+     * \return the mesh with 32-bit cells, null if there is no valid entry
+     */
+    static vtkSmartPointer<vtkPolyData> read(const QString& key);
+
+    /*!
+     * \brief write stores a mesh, it is written to a temporary file first so a reader never sees half of it
+     * \param key from key()
+     * \param mesh the mesh
+     * \return true if it was written
+     */
+    static bool write(const QString& key, vtkPolyData* mesh);
+
+    /*!
+     * \brief trim removes the least recently used entries until the cache is within a budget
+     * \param budgetBytes the most the entries may use on disk
+     * \return the bytes removed
+     */
+    static qint64 trim(qint64 budgetBytes = DefaultBudget);
+
+    /*!
+     * \brief clear removes every entry
+     * \return the bytes removed
+     */
+    static qint64 clear();
+};
+
+#endif
@@ -0,0 +1,484 @@
+/**     @file MeshDecimator.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Parallel quadric error simplification of welded meshes to a triangle
+  *     budget or an error bound.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "MeshDecimator.h"
+#include "MeshOptimizer.h"
+#include "Trace.h"
+#include "Log.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkFloatArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+#include <vtkTypeInt32Array.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace {
+
+constexpr int Unowned = -1;     /*!< Owner of a vertex no partition has claimed */
+constexpr int Shared = -2;      /*!< Owner of a vertex used by more than one partition */
+
+/*! Sum of squared distances to a set of planes, weighted by facet area */
+struct Quadric {
+    double a2 = 0., ab = 0., ac = 0., ad = 0., b2 = 0., bc = 0., bd = 0., c2 = 0., cd = 0., d2 = 0.;
+    double area = 0.;
+
+    void addPlane(const double n[3], double d, double w) {
+        a2 += w * n[0] * n[0]; ab += w * n[0] * n[1]; ac += w * n[0] * n[2]; ad += w * n[0] * d;
+        b2 += w * n[1] * n[1]; bc += w * n[1] * n[2]; bd += w * n[1] * d;
+        c2 += w * n[2] * n[2]; cd += w * n[2] * d;
+        d2 += w * d * d;
+        area += w;
+    }
+
+    double evaluate(const double p[3]) const {
+        double x = p[0], y = p[1], z = p[2];
+        return a2 * x * x + 2. * ab * x * y + 2. * ac * x * z + 2. * ad * x
+             + b2 * y * y + 2. * bc * y * z + 2. * bd * y
+             + c2 * z * z + 2. * cd * z + d2;
+    }
+
+    Quadric operator+(const Quadric& o) const {
+        Quadric q = *this;
+        q.a2 += o.a2; q.ab += o.ab; q.ac += o.ac; q.ad += o.ad; q.b2 += o.b2;
+        q.bc += o.bc; q.bd += o.bd; q.c2 += o.c2; q.cd += o.cd; q.d2 += o.d2;
+        q.area += o.area;
+        return q;
+    }
+};
+
+/*! A vertex and the neighbour it is cheapest to collapse onto */
+struct Candidate {
+    double cost;
+    int from;
+    int to;
+    unsigned stamp;     /*!< Stamp of from when this was worked out, older candidates are skipped */
+
+    bool operator<(const Candidate& other) const { return cost > other.cost; }
+};
+
+/*! Working memory of one partition, kept between the partitions a thread runs */
+struct Partition {
+    std::vector<vtkTypeInt32> vertices;     /*!< Vertices of the partition, sorted, index is the local vertex */
+    std::vector<int> corner;                /*!< Local vertex of each corner */
+    std::vector<std::vector<int>> around;   /*!< Triangles around each vertex */
+    std::vector<double> position;
+    std::vector<Quadric> quadrics;
+    std::vector<float> error;               /*!< Furthest the surface around each vertex has moved */
+    std::vector<char> locked, removedVertex, removedTriangle;
+    std::vector<unsigned> stamp;
+    std::vector<std::pair<int, int>> edges;
+    std::vector<int> neighboursFrom, neighboursTo, changed;
+    std::priority_queue<Candidate> queue;
+    double maxError = 0.;
+
+    void run(std::vector<vtkTypeInt32>& connectivity, std::vector<char>& alive, const vtkIdType* triangles, int count,
+             vtkDataArray* points, const std::vector<std::atomic<int>>& owner, std::vector<float>& vertexError,
+             int target);
+    void neighbours(int v, std::vector<int>& out) const;
+    bool canCollapse(int from, int to);
+    double distance(int from, int to) const;
+    void push(int from);
+    int collapse(int from, int to);
+};
+
+/*!
+ * \brief Partition::run simplifies the triangles of one partition until it is down to target or no collapse is
+ * within the error bound, then writes the triangles back and marks the removed ones as not alive
+ */
+void Partition::run(std::vector<vtkTypeInt32>& connectivity, std::vector<char>& alive, const vtkIdType* triangles,
+                    int count, vtkDataArray* points, const std::vector<std::atomic<int>>& owner,
+                    std::vector<float>& vertexError, int target) {
+    vertices.resize(3 * count);
+    for (int t = 0; t < count; t++)
+        for (int c = 0; c < 3; c++)
+            vertices[3 * t + c] = connectivity[3 * triangles[t] + c];
+    std::sort(vertices.begin(), vertices.end());
+    vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+    int n = (int)vertices.size();
+
+    if ((int)around.size() < n)
+        around.resize(n);
+    for (int v = 0; v < n; v++)
+        around[v].clear();
+    corner.resize(3 * count);
+    for (int t = 0; t < count; t++)
+        for (int c = 0; c < 3; c++) {
+            int v = (int)(std::lower_bound(vertices.begin(), vertices.end(), connectivity[3 * triangles[t] + c]) - vertices.begin());
+            corner[3 * t + c] = v;
+            around[v].push_back(t);
+        }
+
+    position.resize(3 * n);
+    error.resize(n);
+    locked.assign(n, 0);
+    for (int v = 0; v < n; v++) {
+        points->GetTuple(vertices[v], &position[3 * v]);
+        error[v] = vertexError[vertices[v]];
+        locked[v] = owner[vertices[v]].load(std::memory_order_relaxed) == Shared;
+    }
+
+    // Edges with one facet are open edges of the mesh, more than two is non-manifold, neither is collapsed
+    edges.clear();
+    for (int t = 0; t < count; t++)
+        for (int c = 0; c < 3; c++) {
+            int a = corner[3 * t + c], b = corner[3 * t + (c + 1) % 3];
+            edges.emplace_back(std::min(a, b), std::max(a, b));
+        }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i;
+        while (j < edges.size() && edges[j] == edges[i])
+            j++;
+        if (j - i != 2)
+            locked[edges[i].first] = locked[edges[i].second] = 1;
+        i = j;
+    }
+
+    quadrics.assign(n, Quadric());
+    for (int t = 0; t < count; t++) {
+        const double* a = &position[3 * corner[3 * t]];
+        const double* b = &position[3 * corner[3 * t + 1]];
+        const double* c = &position[3 * corner[3 * t + 2]];
+        double ab[3], ac[3], normal[3];
+        vtkMath::Subtract(b, a, ab);
+        vtkMath::Subtract(c, a, ac);
+        vtkMath::Cross(ab, ac, normal);
+        double twiceArea = vtkMath::Normalize(normal);
+        if (twiceArea <= 0.)
+            continue;
+        double d = -vtkMath::Dot(normal, a);
+        for (int k = 0; k < 3; k++)
+            quadrics[corner[3 * t + k]].addPlane(normal, d, twiceArea / 2.);
+    }
+
+    removedVertex.assign(n, 0);
+    removedTriangle.assign(count, 0);
+    stamp.assign(n, 0);
+    queue = std::priority_queue<Candidate>();
+    for (int v = 0; v < n; v++)
+        push(v);
+
+    int remaining = count;
+    while (remaining > target && !queue.empty()) {
+        Candidate candidate = queue.top();
+        queue.pop();
+        if (candidate.stamp != stamp[candidate.from] || removedVertex[candidate.from])
+            continue;
+        // A collapse next to the target can break the link condition without touching the stamp of from
+        neighbours(candidate.from, neighboursFrom);
+        if (!canCollapse(candidate.from, candidate.to)) {
+            stamp[candidate.from]++;
+            push(candidate.from);
+            continue;
+        }
+        remaining -= collapse(candidate.from, candidate.to);
+    }
+
+    for (int t = 0; t < count; t++) {
+        if (removedTriangle[t]) {
+            alive[triangles[t]] = 0;
+            continue;
+        }
+        for (int c = 0; c < 3; c++)
+            connectivity[3 * triangles[t] + c] = vertices[corner[3 * t + c]];
+    }
+    // A shared vertex may be in other partitions too, only the vertices this partition owns are written
+    for (int v = 0; v < n; v++)
+        if (!locked[v] && !removedVertex[v])
+            vertexError[vertices[v]] = error[v];
+}
+
+void Partition::neighbours(int v, std::vector<int>& out) const {
+    out.clear();
+    for (int t : around[v])
+        for (int c = 0; c < 3; c++)
+            if (corner[3 * t + c] != v)
+                out.push_back(corner[3 * t + c]);
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+/*!
+ * \brief Partition::canCollapse
+ * The collapse must keep the surface a manifold (the link condition: the two vertices only share the
+ * neighbours of the facets on their edge) and must not turn any remaining facet over
+ */
+bool Partition::canCollapse(int from, int to) {
+    neighbours(to, neighboursTo);
+    int common = 0;
+    for (int v : neighboursFrom)
+        if (std::binary_search(neighboursTo.begin(), neighboursTo.end(), v))
+            common++;
+    int onEdge = 0;
+    for (int t : around[from])
+        if (std::find(&corner[3 * t], &corner[3 * t] + 3, to) != &corner[3 * t] + 3)
+            onEdge++;
+    if (common != onEdge)
+        return false;
+
+    for (int t : around[from]) {
+        const int* c = &corner[3 * t];
+        if (c[0] == to || c[1] == to || c[2] == to)
+            continue;
+        double before[3], after[3], e1[3], e2[3];
+        const double* p[3] = { &position[3 * c[0]], &position[3 * c[1]], &position[3 * c[2]] };
+        vtkMath::Subtract(p[1], p[0], e1);
+        vtkMath::Subtract(p[2], p[0], e2);
+        vtkMath::Cross(e1, e2, before);
+        for (int k = 0; k < 3; k++)
+            if (c[k] == from)
+                p[k] = &position[3 * to];
+        vtkMath::Subtract(p[1], p[0], e1);
+        vtkMath::Subtract(p[2], p[0], e2);
+        vtkMath::Cross(e1, e2, after);
+        if (vtkMath::Dot(before, after) <= 0.)
+            return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Partition::distance
+ * \return the area weighted RMS distance of the target from the planes of both vertices, added to how far
+ * the surface around the vertex being removed had already moved
+ */
+double Partition::distance(int from, int to) const {
+    Quadric q = quadrics[from] + quadrics[to];
+    double rms = q.area > 0. ? std::sqrt(std::max(0., q.evaluate(&position[3 * to])) / q.area) : 0.;
+    return std::max((double)error[to], error[from] + rms);
+}
+
+/*!
+ * \brief Partition::push queues the cheapest valid collapse of a vertex, if it has one within the error bound
+ */
+void Partition::push(int from) {
+    if (locked[from] || removedVertex[from])
+        return;
+    neighbours(from, neighboursFrom);
+    double bestCost = std::numeric_limits<double>::max();
+    int best = -1;
+    for (int to : neighboursFrom) {
+        double cost = (quadrics[from] + quadrics[to]).evaluate(&position[3 * to]);
+        if (cost >= bestCost || distance(from, to) > maxError)
+            continue;
+        // canCollapse() overwrites neighboursTo only, so neighboursFrom stays valid through the loop
+        if (!canCollapse(from, to))
+            continue;
+        bestCost = cost;
+        best = to;
+    }
+    if (best >= 0)
+        queue.push({ bestCost, from, best, stamp[from] });
+}
+
+/*!
+ * \brief Partition::collapse moves from onto to, the facets on their edge go and the rest take to's place.
+ * Every vertex around to may now have a different best collapse, so they are all queued again.
+ * \return the number of facets removed
+ */
+int Partition::collapse(int from, int to) {
+    error[to] = (float)distance(from, to);
+    quadrics[to] = quadrics[from] + quadrics[to];
+
+    int removed = 0;
+    for (int t : around[from]) {
+        int* c = &corner[3 * t];
+        if (c[0] == to || c[1] == to || c[2] == to) {
+            removedTriangle[t] = 1;
+            removed++;
+            for (int k = 0; k < 3; k++)
+                if (c[k] != from) {
+                    std::vector<int>& list = around[c[k]];
+                    list.erase(std::find(list.begin(), list.end(), t));
+                }
+            continue;
+        }
+        for (int k = 0; k < 3; k++)
+            if (c[k] == from)
+                c[k] = to;
+        around[to].push_back(t);
+    }
+    around[from].clear();
+    removedVertex[from] = 1;
+
+    stamp[to]++;
+    push(to);
+    neighbours(to, changed);
+    for (int v : changed) {
+        stamp[v]++;
+        push(v);
+    }
+    return removed;
+}
+
+}
+
+/*!
+ * \brief MeshDecimator::decimate
+ * Each pass:
+ *  1. sorts the triangles along a Morton curve and cuts them into partitions, every other pass starts half a
+ *     partition later so the seams move
+ *  2. marks the vertices used by more than one partition, with one atomic per vertex
+ *  3. simplifies every partition on the SMP threads, each down to its share of the budget
+ *  4. drops the removed triangles
+ * until the budget is met, a pass removes almost nothing, or Passes have run. The unused points are then
+ * dropped, keeping the order of the rest.
+ */
+vtkSmartPointer<vtkPolyData> MeshDecimator::decimate(vtkPolyData* welded, const Target& target) {
+    TRACE_ZONE("decimate");
+    vtkCellArray* polys = welded->GetPolys();
+    vtkIdType triangles = polys->GetNumberOfCells();
+    vtkIdType points = welded->GetNumberOfPoints();
+    if (!target.isSet() || triangles == 0 || welded->GetNumberOfCells() != triangles
+        || polys->GetNumberOfConnectivityIds() != 3 * triangles || 3 * triangles >= std::numeric_limits<vtkTypeInt32>::max()
+        || points >= std::numeric_limits<vtkTypeInt32>::max()) {
+        LOG_DEBUG(Model) << "Not decimating a mesh that is not all triangles";
+        return welded;
+    }
+    if (target.error <= 0. && triangles <= target.triangles)
+        return welded;
+
+    std::vector<vtkTypeInt32> connectivity(3 * triangles);
+    const auto inConnectivity = vtk::DataArrayValueRange<1>(polys->GetConnectivityArray());
+    vtkSMPTools::For(0, 3 * triangles, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++)
+            connectivity[i] = (vtkTypeInt32)inConnectivity[i];
+    });
+
+    vtkDataArray* pointData = welded->GetPoints()->GetData();
+    double bounds[6];
+    welded->GetBounds(bounds);
+    double maxError = target.error > 0. ? target.error * welded->GetLength() : std::numeric_limits<double>::max();
+
+    std::vector<float> vertexError(points, 0.f);
+    std::vector<std::atomic<int>> owner(points);
+    std::vector<char> alive;
+    vtkIdType original = triangles;
+    int passes = 0;
+    for (int pass = 0; pass < Passes; pass++) {
+        if (target.triangles > 0 && triangles <= target.triangles)
+            break;
+
+        // 1. Partitions
+        std::vector<vtkIdType> order = MeshOptimizer::mortonOrder(pointData, connectivity, bounds);
+        vtkIdType shift = (pass % 2) ? PartitionTriangles / 2 : 0;
+        vtkIdType partitions = (triangles + shift + PartitionTriangles - 1) / PartitionTriangles;
+        auto first = [&](vtkIdType partition) {
+            return qBound<vtkIdType>(0, partition * PartitionTriangles - shift, triangles);
+        };
+
+        // 2. Shared vertices
+        vtkSMPTools::For(0, points, [&](vtkIdType begin, vtkIdType end) {
+            for (vtkIdType p = begin; p < end; p++)
+                owner[p].store(Unowned, std::memory_order_relaxed);
+        });
+        vtkSMPTools::For(0, partitions, 1, [&](vtkIdType begin, vtkIdType end) {
+            for (vtkIdType partition = begin; partition < end; partition++)
+                for (vtkIdType i = first(partition); i < first(partition + 1); i++)
+                    for (int c = 0; c < 3; c++) {
+                        std::atomic<int>& vertex = owner[connectivity[3 * order[i] + c]];
+                        int seen = vertex.load(std::memory_order_relaxed);
+                        while (seen != (int)partition && seen != Shared
+                               && !vertex.compare_exchange_weak(seen, seen == Unowned ? (int)partition : Shared,
+                                                                std::memory_order_relaxed)) {
+                        }
+                    }
+        });
+
+        // 3. Simplify
+        alive.assign(triangles, 1);
+        double keep = target.triangles > 0 ? (double)target.triangles / triangles : 0.;
+        vtkSMPTools::For(0, partitions, 1, [&](vtkIdType begin, vtkIdType end) {
+            Partition work;
+            work.maxError = maxError;
+            for (vtkIdType partition = begin; partition < end; partition++) {
+                vtkIdType from = first(partition);
+                int count = (int)(first(partition + 1) - from);
+                if (count > 0)
+                    work.run(connectivity, alive, &order[from], count, pointData, owner, vertexError, (int)(count * keep));
+            }
+        });
+
+        // 4. Compact
+        vtkIdType kept = 0;
+        for (vtkIdType t = 0; t < triangles; t++)
+            if (alive[t]) {
+                for (int c = 0; c < 3; c++)
+                    connectivity[3 * kept + c] = connectivity[3 * t + c];
+                kept++;
+            }
+        connectivity.resize(3 * kept);
+        vtkIdType removed = triangles - kept;
+        triangles = kept;
+        passes++;
+        if (removed < triangles / 100)
+            break;
+    }
+
+    std::vector<vtkTypeInt32> remap(points, -1);
+    for (vtkTypeInt32 v : connectivity)
+        remap[v] = 0;
+    vtkTypeInt32 vertices = 0;
+    for (vtkIdType p = 0; p < points; p++)
+        if (remap[p] == 0)
+            remap[p] = vertices++;
+
+    vtkNew<vtkFloatArray> pointArray;
+    pointArray->SetNumberOfComponents(3);
+    pointArray->SetNumberOfTuples(vertices);
+    float* outPoints = pointArray->GetPointer(0);
+    vtkSMPTools::For(0, points, [&](vtkIdType begin, vtkIdType end) {
+        double value[3];
+        for (vtkIdType p = begin; p < end; p++) {
+            if (remap[p] < 0)
+                continue;
+            pointData->GetTuple(p, value);
+            for (int k = 0; k < 3; k++)
+                outPoints[3 * remap[p] + k] = (float)value[k];
+        }
+    });
+
+    vtkNew<vtkTypeInt32Array> newConnectivity;
+    newConnectivity->SetNumberOfValues(3 * triangles);
+    vtkTypeInt32* outConnectivity = newConnectivity->GetPointer(0);
+    vtkNew<vtkTypeInt32Array> offsets;
+    offsets->SetNumberOfValues(triangles + 1);
+    vtkTypeInt32* o = offsets->GetPointer(0);
+    vtkSMPTools::For(0, triangles + 1, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++) {
+            o[i] = (vtkTypeInt32)(3 * i);
+            if (i < triangles)
+                for (int c = 0; c < 3; c++)
+                    outConnectivity[3 * i + c] = remap[connectivity[3 * i + c]];
+        }
+    });
+
+    vtkNew<vtkPoints> outputPoints;
+    outputPoints->SetData(pointArray);
+    vtkNew<vtkCellArray> outputPolys;
+    outputPolys->SetData(offsets, newConnectivity);
+
+    vtkSmartPointer<vtkPolyData> decimated = vtkSmartPointer<vtkPolyData>::New();
+    decimated->SetPoints(outputPoints);
+    decimated->SetPolys(outputPolys);
+
+    LOG_DEBUG(Model) << "Decimated" << original << "triangles to" << triangles << "in" << passes << "passes";
+    return decimated;
+}
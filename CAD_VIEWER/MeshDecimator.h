@@ -0,0 +1,51 @@
+/**     @file MeshDecimator.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Parallel quadric error simplification of welded meshes to a triangle
+  *     budget or an error bound.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_MESHDECIMATOR_H
+#define VIEWER_MESHDECIMATOR_H
+
+#include <QtGlobal>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+/*! \class MeshDecimator
+ *  \brief Removes triangles from a mesh by collapsing the edges that change its shape least.
+ *  Each vertex keeps the quadric error of the planes of the facets around it (Garland and Heckbert 1997) and
+ *  the cheapest collapses are made first. The mesh is cut into partitions along a Morton curve and each
+ *  partition is simplified on its own SMP thread with the vertices it shares with other partitions locked,
+ *  so the partitions always meet without cracks. The next pass cuts the mesh in different places so the old
+ *  seams are simplified too. A vertex only ever moves onto a neighbour (half-edge collapse), so the result is
+ *  a subset of the original points and open edges of the mesh are kept exactly.
+ *  Run it on a welded mesh before MeshNormals::smooth(), which splits vertices at creases.
+ */
+class MeshDecimator {
+public:
+    static constexpr int PartitionTriangles = 65536;    /*!< Triangles simplified in one job */
+    static constexpr int Passes = 4;                    /*!< Most passes with the partitions moved */
+
+    /*! How far to simplify, if both are set it stops at whichever is reached first */
+    struct Target {
+        qint64 triangles = 0;   /*!< Keep at most this many triangles, 0 for no budget */
+        double error = 0.;      /*!< Furthest the surface may move, as a fraction of the bounding box diagonal, 0 for no bound */
+
+        bool isSet() const { return triangles > 0 || error > 0.; }
+    };
+
+    /*!
+     * \brief decimate simplifies a welded triangle mesh
+     * \param welded is a welded triangle mesh, e.g. from MeshNormals::weld()
+     * \param target is the triangle budget and error bound
+     * \return a new mesh with float points and 32-bit cells but no point data, or the input unchanged if it
+     * is not all triangles or is already within the budget
+     */
+    static vtkSmartPointer<vtkPolyData> decimate(vtkPolyData* welded, const Target& target);
+};
+
+#endif
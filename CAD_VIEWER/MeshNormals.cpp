@@ -0,0 +1,231 @@
+/**     @file MeshNormals.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Welding of STL triangle soup and crease-angle smooth vertex normals.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "MeshNormals.h"
+#include "Trace.h"
+#include "Log.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkFloatArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+#include <vtkStaticCellLinks.h>
+#include <vtkStaticCleanPolyData.h>
+#include <vtkTypeInt32Array.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+
+/*! Facets around one point, split into groups that share a normal */
+struct PointGroups {
+    std::vector<int>    faceGroup;  /*!< Group of each facet around the point, in link order */
+    std::vector<double> reference;  /*!< Unit normal of the facet that started each group */
+    std::vector<double> sum;        /*!< Area weighted normal sum of each group */
+
+    int count() const { return (int)reference.size() / 3; }
+};
+
+/*!
+ * \brief groupFaces puts each facet around a point in the first group whose starting facet is within the
+ * crease angle of it, or in a new group. A facet with no area joins the first group, it adds nothing to
+ * the normal. The grouping only depends on the facet order in the links, so it is the same every run.
+ */
+void groupFaces(const vtkIdType* cells, vtkIdType count, const std::vector<float>& faceNormals,
+                double cosCrease, PointGroups& groups) {
+    groups.faceGroup.assign(count, -1);
+    groups.reference.clear();
+    groups.sum.clear();
+
+    bool anyDegenerate = false;
+    for (vtkIdType i = 0; i < count; i++) {
+        const float* n = &faceNormals[3 * cells[i]];
+        double length = std::sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+        if (length <= 0.) {
+            anyDegenerate = true;
+            continue;
+        }
+        double unit[3] = { n[0] / length, n[1] / length, n[2] / length };
+
+        int group = 0;
+        for (; group < groups.count(); group++)
+            if (vtkMath::Dot(unit, &groups.reference[3 * group]) >= cosCrease)
+                break;
+        if (group == groups.count()) {
+            groups.reference.insert(groups.reference.end(), unit, unit + 3);
+            groups.sum.insert(groups.sum.end(), 3, 0.);
+        }
+        for (int c = 0; c < 3; c++)
+            groups.sum[3 * group + c] += n[c];
+        groups.faceGroup[i] = group;
+    }
+
+    if (anyDegenerate) {
+        if (groups.count() == 0) {
+            groups.reference = { 0., 0., 1. };
+            groups.sum = { 0., 0., 0. };
+        }
+        for (vtkIdType i = 0; i < count; i++)
+            if (groups.faceGroup[i] < 0)
+                groups.faceGroup[i] = 0;
+    }
+}
+
+}
+
+/*!
+ * \brief MeshNormals::weld
+ * Uses vtkStaticCleanPolyData, which sorts the points into a threaded static locator instead of
+ * inserting them one at a time like the STL reader's own merging
+ */
+vtkSmartPointer<vtkPolyData> MeshNormals::weld(vtkPolyData* soup) {
+    TRACE_ZONE("weld");
+    vtkNew<vtkStaticCleanPolyData> clean;
+    clean->SetInputData(soup);
+    clean->ToleranceIsAbsoluteOn();
+    clean->SetAbsoluteTolerance(0.);
+    clean->ConvertLinesToPointsOff();
+    clean->ConvertPolysToLinesOff();
+    clean->ConvertStripsToPolysOff();
+    clean->Update();
+
+    vtkSmartPointer<vtkPolyData> welded = vtkSmartPointer<vtkPolyData>::New();
+    welded->ShallowCopy(clean->GetOutput());
+    return welded;
+}
+
+/*!
+ * \brief MeshNormals::smooth
+ * Four passes over the mesh, each split across the SMP threads:
+ *  1. the area weighted normal of every facet
+ *  2. the point to facet links (vtkStaticCellLinks), then the number of normal groups at every point
+ *  3. a prefix sum of the group counts, which gives each group its output vertex
+ *  4. the vertices, their normals and the new connectivity, each corner is written by its own point
+ * so no pass needs a lock or an atomic.
+ */
+vtkSmartPointer<vtkPolyData> MeshNormals::smooth(vtkPolyData* welded, double creaseAngle) {
+    TRACE_ZONE("smoothNormals");
+    vtkCellArray* polys = welded->GetPolys();
+    vtkIdType triangles = polys->GetNumberOfCells();
+    vtkIdType points = welded->GetNumberOfPoints();
+    if (triangles == 0 || welded->GetNumberOfCells() != triangles || polys->GetNumberOfConnectivityIds() != 3 * triangles
+        || 3 * triangles >= std::numeric_limits<vtkTypeInt32>::max()) {
+        LOG_DEBUG(Model) << "Not smoothing normals of a mesh that is not all triangles";
+        return welded;
+    }
+
+    const auto connectivity = vtk::DataArrayValueRange<1>(polys->GetConnectivityArray());
+    vtkDataArray* pointData = welded->GetPoints()->GetData();
+
+    std::vector<float> faceNormals(3 * triangles);
+    vtkSMPTools::For(0, triangles, [&](vtkIdType begin, vtkIdType end) {
+        double a[3], b[3], c[3], ab[3], ac[3], n[3];
+        for (vtkIdType t = begin; t < end; t++) {
+            pointData->GetTuple(connectivity[3 * t], a);
+            pointData->GetTuple(connectivity[3 * t + 1], b);
+            pointData->GetTuple(connectivity[3 * t + 2], c);
+            vtkMath::Subtract(b, a, ab);
+            vtkMath::Subtract(c, a, ac);
+            vtkMath::Cross(ab, ac, n);
+            for (int k = 0; k < 3; k++)
+                faceNormals[3 * t + k] = (float)n[k];
+        }
+    });
+
+    vtkNew<vtkStaticCellLinks> links;
+    links->BuildLinks(welded);
+
+    double cosCrease = std::cos(vtkMath::RadiansFromDegrees(creaseAngle));
+    std::vector<vtkIdType> firstVertex(points + 1);
+    vtkSMPTools::For(0, points, [&](vtkIdType begin, vtkIdType end) {
+        PointGroups groups;
+        for (vtkIdType p = begin; p < end; p++) {
+            groupFaces(links->GetCells(p), links->GetNcells(p), faceNormals, cosCrease, groups);
+            firstVertex[p] = groups.count();
+        }
+    });
+
+    vtkIdType vertices = 0;
+    for (vtkIdType p = 0; p < points; p++) {
+        vtkIdType count = firstVertex[p];
+        firstVertex[p] = vertices;
+        vertices += count;
+    }
+    firstVertex[points] = vertices;
+    if (vertices >= std::numeric_limits<vtkTypeInt32>::max())
+        return welded;
+
+    vtkNew<vtkFloatArray> pointArray;
+    pointArray->SetNumberOfComponents(3);
+    pointArray->SetNumberOfTuples(vertices);
+    vtkNew<vtkFloatArray> normalArray;
+    normalArray->SetName("Normals");
+    normalArray->SetNumberOfComponents(3);
+    normalArray->SetNumberOfTuples(vertices);
+    vtkNew<vtkTypeInt32Array> newConnectivity;
+    newConnectivity->SetNumberOfValues(3 * triangles);
+
+    float* outPoints = pointArray->GetPointer(0);
+    float* outNormals = normalArray->GetPointer(0);
+    vtkTypeInt32* outConnectivity = newConnectivity->GetPointer(0);
+    vtkSMPTools::For(0, points, [&](vtkIdType begin, vtkIdType end) {
+        PointGroups groups;
+        double position[3];
+        for (vtkIdType p = begin; p < end; p++) {
+            const vtkIdType* cells = links->GetCells(p);
+            vtkIdType count = links->GetNcells(p);
+            groupFaces(cells, count, faceNormals, cosCrease, groups);
+            pointData->GetTuple(p, position);
+
+            for (int g = 0; g < groups.count(); g++) {
+                vtkIdType v = firstVertex[p] + g;
+                double* n = &groups.sum[3 * g];
+                if (vtkMath::Normalize(n) == 0.)
+                    n = &groups.reference[3 * g];
+                for (int c = 0; c < 3; c++) {
+                    outPoints[3 * v + c] = (float)position[c];
+                    outNormals[3 * v + c] = (float)n[c];
+                }
+            }
+            for (vtkIdType i = 0; i < count; i++) {
+                vtkIdType t = cells[i];
+                for (int k = 0; k < 3; k++)
+                    if (connectivity[3 * t + k] == p)
+                        outConnectivity[3 * t + k] = (vtkTypeInt32)(firstVertex[p] + groups.faceGroup[i]);
+            }
+        }
+    });
+
+    vtkNew<vtkTypeInt32Array> offsets;
+    offsets->SetNumberOfValues(triangles + 1);
+    vtkTypeInt32* o = offsets->GetPointer(0);
+    vtkSMPTools::For(0, triangles + 1, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++)
+            o[i] = (vtkTypeInt32)(3 * i);
+    });
+
+    vtkNew<vtkPoints> outputPoints;
+    outputPoints->SetData(pointArray);
+    vtkNew<vtkCellArray> outputPolys;
+    outputPolys->SetData(offsets, newConnectivity);
+
+    vtkSmartPointer<vtkPolyData> smoothed = vtkSmartPointer<vtkPolyData>::New();
+    smoothed->SetPoints(outputPoints);
+    smoothed->SetPolys(outputPolys);
+    smoothed->GetPointData()->SetNormals(normalArray);
+
+    LOG_DEBUG(Model) << "Smoothed" << triangles << "triangles," << points << "points became" << vertices << "vertices";
+    return smoothed;
+}
@@ -0,0 +1,46 @@
+/**     @file MeshNormals.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Welding of STL triangle soup and crease-angle smooth vertex normals,
+  *     computed in parallel at import.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_MESHNORMALS_H
+#define VIEWER_MESHNORMALS_H
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+/*! \class MeshNormals
+ *  \brief Turns the separate corners of an STL file into a shared, smooth shaded mesh.
+ *  STL stores each facet with its own three corners and a facet normal, so curved surfaces look faceted.
+ *  weld() merges corners at the same position, then smooth() gives every vertex a normal averaged over
+ *  the facets around it. Facets meeting at more than the crease angle are kept apart: the vertex is split
+ *  so each side of the edge keeps its own normal and sharp CAD edges stay sharp.
+ *  Both run on the VTK SMP thread pool and each step is linear in the size of the mesh, so the cost is
+ *  paid once at import and the normals are then kept with the geometry (and in its CompactMesh form).
+ */
+class MeshNormals {
+public:
+    static constexpr double DefaultCreaseAngle = 30.;   /*!< Degrees between facets above which an edge is sharp */
+
+    /*!
+     * \brief weld merges points at exactly the same position and drops facets that become degenerate
+     * \param soup is the mesh, e.g. an STL read without merging
+     * \return the welded mesh
+     */
+    static vtkSmartPointer<vtkPolyData> weld(vtkPolyData* soup);
+
+    /*!
+     * \brief smooth computes area weighted vertex normals, splitting vertices at creases
+     * \param welded is a welded triangle mesh
+     * \param creaseAngle is the angle in degrees above which neighbouring facets do not share a normal
+     * \return a new mesh with float points, 32-bit cells and point normals, or the input unchanged if
+     * it is not all triangles
+     */
+    static vtkSmartPointer<vtkPolyData> smooth(vtkPolyData* welded, double creaseAngle = DefaultCreaseAngle);
+};
+
+#endif
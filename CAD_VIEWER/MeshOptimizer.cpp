@@ -0,0 +1,379 @@
+/**     @file MeshOptimizer.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Reordering of welded meshes for the GPU: triangles for vertex cache reuse
+  *     and overdraw, vertices for fetch locality.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "MeshOptimizer.h"
+#include "Trace.h"
+#include "Log.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataArrayRange.h>
+#include <vtkFloatArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+#include <vtkTypeInt32Array.h>
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+static_assert(MeshOptimizer::ClusterTriangles % MeshOptimizer::PatchTriangles == 0,
+              "Overdraw patches must not cross Tipsify clusters");
+
+namespace {
+
+/*! Spreads the low 10 bits of v out to every third bit */
+quint32 spreadBits(quint32 v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+/*! Working memory of Tipsify for one cluster, kept between the clusters a thread runs */
+struct Tipsify {
+    std::vector<vtkTypeInt32> vertices;     /*!< Vertices of the cluster, sorted, index is the local vertex */
+    std::vector<int> corner;                /*!< Local vertex of each corner */
+    std::vector<int> live;                  /*!< Triangles not yet emitted around each vertex */
+    std::vector<int> firstTriangle;         /*!< Start of each vertex's triangles in adjacency */
+    std::vector<int> adjacency;             /*!< Triangles around each vertex */
+    std::vector<int> cacheTime;             /*!< Time each vertex last entered the cache */
+    std::vector<int> deadEnd;               /*!< Recently used vertices to restart from */
+    std::vector<int> candidates;            /*!< Vertices of the triangles emitted around the fan vertex */
+    std::vector<char> emitted;
+
+    void run(const std::vector<vtkTypeInt32>& connectivity, const vtkIdType* triangles, int count,
+             int cacheSize, vtkIdType* out);
+    int nextVertex(int cacheSize, int time, int& cursor);
+};
+
+/*!
+ * \brief Tipsify::run emits the triangles around one fan vertex at a time, then moves to the neighbour that
+ * is still in the cache and has the fewest triangles left, so it is finished before it falls out
+ */
+void Tipsify::run(const std::vector<vtkTypeInt32>& connectivity, const vtkIdType* triangles, int count,
+                  int cacheSize, vtkIdType* out) {
+    vertices.resize(3 * count);
+    for (int t = 0; t < count; t++)
+        for (int c = 0; c < 3; c++)
+            vertices[3 * t + c] = connectivity[3 * triangles[t] + c];
+    std::sort(vertices.begin(), vertices.end());
+    vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+    int n = (int)vertices.size();
+
+    corner.resize(3 * count);
+    live.assign(n, 0);
+    for (int t = 0; t < count; t++)
+        for (int c = 0; c < 3; c++) {
+            int v = (int)(std::lower_bound(vertices.begin(), vertices.end(), connectivity[3 * triangles[t] + c]) - vertices.begin());
+            corner[3 * t + c] = v;
+            live[v]++;
+        }
+
+    firstTriangle.assign(n + 1, 0);
+    for (int v = 0; v < n; v++)
+        firstTriangle[v + 1] = firstTriangle[v] + live[v];
+    adjacency.resize(3 * count);
+    cacheTime.assign(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (int t = 0; t < count; t++)
+        for (int c = 0; c < 3; c++)
+            adjacency[cacheTime[corner[3 * t + c]]++] = t;
+
+    cacheTime.assign(n, 0);
+    emitted.assign(count, 0);
+    deadEnd.clear();
+    int time = cacheSize + 1;
+    int cursor = 0;
+    int written = 0;
+    for (int fan = 0; fan >= 0; fan = nextVertex(cacheSize, time, cursor)) {
+        candidates.clear();
+        for (int a = firstTriangle[fan]; a < firstTriangle[fan + 1]; a++) {
+            int t = adjacency[a];
+            if (emitted[t])
+                continue;
+            emitted[t] = 1;
+            out[written++] = triangles[t];
+            for (int c = 0; c < 3; c++) {
+                int v = corner[3 * t + c];
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Tipsify::nextVertex prefers the candidate that entered the cache longest ago but will still be in it
+ * after its remaining triangles, then the most recent dead end, then the next vertex with triangles left
+ * \return the next fan vertex, -1 once every triangle is emitted
+ */
+int Tipsify::nextVertex(int cacheSize, int time, int& cursor) {
+    int best = -1;
+    int bestPriority = -1;
+    for (int v : candidates) {
+        if (live[v] <= 0)
+            continue;
+        int priority = 0;
+        if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+            priority = time - cacheTime[v];
+        if (priority > bestPriority) {
+            bestPriority = priority;
+            best = v;
+        }
+    }
+    if (best >= 0)
+        return best;
+
+    while (!deadEnd.empty()) {
+        int v = deadEnd.back();
+        deadEnd.pop_back();
+        if (live[v] > 0)
+            return v;
+    }
+    for (; cursor < (int)live.size(); cursor++)
+        if (live[cursor] > 0)
+            return cursor;
+    return -1;
+}
+
+}
+
+/*!
+ * \brief MeshOptimizer::optimize
+ * Each stage is split across the SMP threads:
+ *  1. a Morton code of every triangle centre, then a parallel sort, so each cluster is a compact region
+ *  2. Tipsify on every cluster, the clusters are independent so the threads never share a triangle
+ *  3. optionally, patches of PatchTriangles consecutive triangles are sorted by how far they face out from
+ *     the centre of the part (the view independent ordering of Sander et al.), largest first
+ *  4. the vertices are numbered in the order the new index buffer first uses them, this is one serial pass
+ *     as each number depends on the ones before, then the points and normals are copied in parallel
+ */
+vtkSmartPointer<vtkPolyData> MeshOptimizer::optimize(vtkPolyData* mesh, bool sortForOverdraw) {
+    TRACE_ZONE("optimizeMesh");
+    vtkCellArray* polys = mesh->GetPolys();
+    vtkIdType triangles = polys->GetNumberOfCells();
+    vtkIdType points = mesh->GetNumberOfPoints();
+    if (triangles == 0 || mesh->GetNumberOfCells() != triangles || polys->GetNumberOfConnectivityIds() != 3 * triangles
+        || 3 * triangles >= std::numeric_limits<vtkTypeInt32>::max() || points >= std::numeric_limits<vtkTypeInt32>::max()) {
+        LOG_DEBUG(Model) << "Not optimising a mesh that is not all triangles";
+        return mesh;
+    }
+
+    std::vector<vtkTypeInt32> connectivity(3 * triangles);
+    const auto inConnectivity = vtk::DataArrayValueRange<1>(polys->GetConnectivityArray());
+    vtkSMPTools::For(0, 3 * triangles, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++)
+            connectivity[i] = (vtkTypeInt32)inConnectivity[i];
+    });
+
+    vtkDataArray* pointData = mesh->GetPoints()->GetData();
+    double bounds[6];
+    mesh->GetBounds(bounds);
+
+    // 1. Morton order
+    std::vector<vtkIdType> sorted = mortonOrder(pointData, connectivity, bounds);
+
+    // 2. Tipsify each cluster
+    std::vector<vtkIdType> order(triangles);
+    vtkIdType clusters = (triangles + ClusterTriangles - 1) / ClusterTriangles;
+    vtkSMPTools::For(0, clusters, 1, [&](vtkIdType begin, vtkIdType end) {
+        Tipsify tipsify;
+        for (vtkIdType cluster = begin; cluster < end; cluster++) {
+            vtkIdType first = cluster * ClusterTriangles;
+            int count = (int)std::min<vtkIdType>(ClusterTriangles, triangles - first);
+            tipsify.run(connectivity, &sorted[first], count, CacheSize, &order[first]);
+        }
+    });
+
+    // 3. Outward facing patches first
+    if (sortForOverdraw) {
+        vtkIdType patches = (triangles + PatchTriangles - 1) / PatchTriangles;
+        double centre[3] = { (bounds[0] + bounds[1]) / 2., (bounds[2] + bounds[3]) / 2., (bounds[4] + bounds[5]) / 2. };
+        std::vector<double> facing(patches);
+        vtkSMPTools::For(0, patches, [&](vtkIdType begin, vtkIdType end) {
+            double a[3], b[3], c[3], ab[3], ac[3], n[3];
+            for (vtkIdType patch = begin; patch < end; patch++) {
+                vtkIdType first = patch * PatchTriangles;
+                vtkIdType last = std::min<vtkIdType>(first + PatchTriangles, triangles);
+                double normal[3] = { 0., 0., 0. }, position[3] = { 0., 0., 0. };
+                for (vtkIdType i = first; i < last; i++) {
+                    vtkIdType t = order[i];
+                    pointData->GetTuple(connectivity[3 * t], a);
+                    pointData->GetTuple(connectivity[3 * t + 1], b);
+                    pointData->GetTuple(connectivity[3 * t + 2], c);
+                    vtkMath::Subtract(b, a, ab);
+                    vtkMath::Subtract(c, a, ac);
+                    vtkMath::Cross(ab, ac, n);
+                    for (int k = 0; k < 3; k++) {
+                        normal[k] += n[k];
+                        position[k] += (a[k] + b[k] + c[k]) / 3.;
+                    }
+                }
+                for (int k = 0; k < 3; k++)
+                    position[k] = position[k] / (last - first) - centre[k];
+                vtkMath::Normalize(normal);
+                facing[patch] = vtkMath::Dot(position, normal);
+            }
+        });
+
+        std::vector<vtkIdType> patchOrder(patches);
+        for (vtkIdType patch = 0; patch < patches; patch++)
+            patchOrder[patch] = patch;
+        vtkSMPTools::Sort(patchOrder.begin(), patchOrder.end(), [&](vtkIdType a, vtkIdType b) {
+            return facing[a] > facing[b] || (facing[a] == facing[b] && a < b);
+        });
+
+        // Only the last patch can be short, so every patch after it in the new order moves back by the difference
+        vtkIdType shortfall = patches * PatchTriangles - triangles;
+        vtkIdType lastPosition = std::find(patchOrder.begin(), patchOrder.end(), patches - 1) - patchOrder.begin();
+        std::vector<vtkIdType> reordered(triangles);
+        vtkSMPTools::For(0, patches, [&](vtkIdType begin, vtkIdType end) {
+            for (vtkIdType i = begin; i < end; i++) {
+                vtkIdType from = patchOrder[i] * PatchTriangles;
+                vtkIdType count = std::min<vtkIdType>(PatchTriangles, triangles - from);
+                vtkIdType to = i * PatchTriangles - (i > lastPosition ? shortfall : 0);
+                std::copy(order.begin() + from, order.begin() + from + count, reordered.begin() + to);
+            }
+        });
+        order.swap(reordered);
+    }
+
+    // 4. Vertices in first use order
+    std::vector<vtkTypeInt32> remap(points, -1);
+    vtkNew<vtkTypeInt32Array> newConnectivity;
+    newConnectivity->SetNumberOfValues(3 * triangles);
+    vtkTypeInt32* outConnectivity = newConnectivity->GetPointer(0);
+    vtkTypeInt32 vertices = 0;
+    for (vtkIdType i = 0; i < triangles; i++)
+        for (int c = 0; c < 3; c++) {
+            vtkTypeInt32& v = remap[connectivity[3 * order[i] + c]];
+            if (v < 0)
+                v = vertices++;
+            outConnectivity[3 * i + c] = v;
+        }
+
+    vtkDataArray* normals = mesh->GetPointData()->GetNormals();
+    vtkNew<vtkFloatArray> pointArray;
+    pointArray->SetNumberOfComponents(3);
+    pointArray->SetNumberOfTuples(vertices);
+    vtkNew<vtkFloatArray> normalArray;
+    normalArray->SetName("Normals");
+    normalArray->SetNumberOfComponents(3);
+    normalArray->SetNumberOfTuples(normals ? vertices : 0);
+    float* outPoints = pointArray->GetPointer(0);
+    float* outNormals = normalArray->GetPointer(0);
+    vtkSMPTools::For(0, points, [&](vtkIdType begin, vtkIdType end) {
+        double value[3];
+        for (vtkIdType p = begin; p < end; p++) {
+            vtkTypeInt32 v = remap[p];
+            if (v < 0)
+                continue;
+            pointData->GetTuple(p, value);
+            for (int k = 0; k < 3; k++)
+                outPoints[3 * v + k] = (float)value[k];
+            if (normals) {
+                normals->GetTuple(p, value);
+                for (int k = 0; k < 3; k++)
+                    outNormals[3 * v + k] = (float)value[k];
+            }
+        }
+    });
+
+    vtkNew<vtkTypeInt32Array> offsets;
+    offsets->SetNumberOfValues(triangles + 1);
+    vtkTypeInt32* o = offsets->GetPointer(0);
+    vtkSMPTools::For(0, triangles + 1, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++)
+            o[i] = (vtkTypeInt32)(3 * i);
+    });
+
+    vtkNew<vtkPoints> outputPoints;
+    outputPoints->SetData(pointArray);
+    vtkNew<vtkCellArray> outputPolys;
+    outputPolys->SetData(offsets, newConnectivity);
+
+    vtkSmartPointer<vtkPolyData> optimized = vtkSmartPointer<vtkPolyData>::New();
+    optimized->SetPoints(outputPoints);
+    optimized->SetPolys(outputPolys);
+    if (normals)
+        optimized->GetPointData()->SetNormals(normalArray);
+
+    // The simulation is two more passes over the index buffer, only run when the message is wanted
+    if ((int)LogLevel::Debug >= WS6_LOG_MIN_LEVEL && Log::enabled(LogLevel::Debug, LogCategory::Model))
+        LOG_DEBUG(Model) << "Optimised" << triangles << "triangles in" << clusters << "clusters, cache miss ratio"
+                         << cacheMissRatio(mesh) << "->" << cacheMissRatio(optimized);
+    return optimized;
+}
+
+/*!
+ * \brief MeshOptimizer::mortonOrder
+ * The centres are quantised to 10 bits per axis and the bits interleaved, the triangle id goes in the low
+ * 32 bits of the sort key so triangles in the same cell keep their order and every run gives the same result
+ */
+std::vector<vtkIdType> MeshOptimizer::mortonOrder(vtkDataArray* points, const std::vector<vtkTypeInt32>& connectivity,
+                                                  const double bounds[6]) {
+    TRACE_ZONE("mortonOrder");
+    vtkIdType triangles = (vtkIdType)connectivity.size() / 3;
+    double scale[3];
+    for (int k = 0; k < 3; k++)
+        scale[k] = bounds[2 * k + 1] > bounds[2 * k] ? 1023.999 / (bounds[2 * k + 1] - bounds[2 * k]) : 0.;
+
+    std::vector<quint64> keys(triangles);
+    vtkSMPTools::For(0, triangles, [&](vtkIdType begin, vtkIdType end) {
+        double a[3], b[3], c[3];
+        for (vtkIdType t = begin; t < end; t++) {
+            points->GetTuple(connectivity[3 * t], a);
+            points->GetTuple(connectivity[3 * t + 1], b);
+            points->GetTuple(connectivity[3 * t + 2], c);
+            quint32 cell[3];
+            for (int k = 0; k < 3; k++)
+                cell[k] = (quint32)qBound(0., ((a[k] + b[k] + c[k]) / 3. - bounds[2 * k]) * scale[k], 1023.);
+            quint64 code = spreadBits(cell[0]) | (spreadBits(cell[1]) << 1) | (spreadBits(cell[2]) << 2);
+            keys[t] = (code << 32) | (quint64)t;
+        }
+    });
+    vtkSMPTools::Sort(keys.begin(), keys.end());
+
+    std::vector<vtkIdType> order(triangles);
+    vtkSMPTools::For(0, triangles, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++)
+            order[i] = (vtkIdType)(keys[i] & 0xffffffffu);
+    });
+    return order;
+}
+
+/*!
+ * \brief MeshOptimizer::cacheMissRatio
+ * A vertex is in a FIFO cache if fewer than cacheSize other vertices have entered since it did, so only
+ * the time each vertex entered is kept
+ */
+double MeshOptimizer::cacheMissRatio(vtkPolyData* mesh, int cacheSize) {
+    vtkCellArray* polys = mesh->GetPolys();
+    vtkIdType triangles = polys->GetNumberOfCells();
+    if (triangles == 0)
+        return 0.;
+
+    const auto connectivity = vtk::DataArrayValueRange<1>(polys->GetConnectivityArray());
+    std::vector<qint64> entered(mesh->GetNumberOfPoints(), std::numeric_limits<qint64>::min() / 2);
+    qint64 misses = 0;
+    for (vtkIdType v : connectivity)
+        if (misses - entered[v] >= cacheSize)
+            entered[v] = misses++;
+    return (double)misses / triangles;
+}
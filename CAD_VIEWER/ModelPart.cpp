@@ -8,6 +8,10 @@
   */
 
 #include "ModelPart.h"
+#include "ModelPartArena.h"
+#include "Trace.h"
+#include "Log.h"
+#include "MeshCache.h"
 
 #include <vtkSmartPointer.h>
 #include <vtkActor.h>
@@ -22,6 +26,11 @@
 #include <QVariant>
 #include <QVector>
 #include <QDebug>
+#include <atomic>
+#include <vtkCallbackCommand.h>
+#include <vtkTransform.h>
+#include <vtkMatrixToLinearTransform.h>
+#include <vtkCommand.h>
 
 
 
@@ -43,7 +52,22 @@ ModelPart::ModelPart(const QList<QVariant>& data, ModelPart* parent )
  * Destructor
  */
 ModelPart::~ModelPart() {
-    qDeleteAll(m_childItems);
+    for (ModelPart* child : m_childItems)
+        destroy(child);
+}
+
+/*!
+ * \brief ModelPart::destroy
+ * Destroys a part and its children, giving its slot back to the arena it was made in
+ * \param part the part
+ */
+void ModelPart::destroy(ModelPart* part) {
+    if (!part)
+        return;
+    if (part->m_arena)
+        part->m_arena->destroy(part);
+    else
+        delete part;
 }
 
 /*!
@@ -57,6 +81,23 @@ void ModelPart::appendChild( ModelPart* item ) {
      */
     item->m_parentItem = this;
     m_childItems.append(item);
+    item->updateWorldMatrix();
+    for (ModelPart* part = this; part; part = part->m_parentItem)
+        part->m_totalCost += item->m_totalCost;
+}
+
+bool ModelPart::fromArena() const {
+    return m_arena != nullptr;
+}
+
+ModelPart* ModelPart::takeChild(int row) {
+    if (row < 0 || row >= m_childItems.size())
+        return nullptr;
+    ModelPart* item = m_childItems.takeAt(row);
+    item->m_parentItem = nullptr;
+    for (ModelPart* part = this; part; part = part->m_parentItem)
+        part->m_totalCost -= item->m_totalCost;
+    return item;
 }
 
 /*!
@@ -165,6 +206,8 @@ int ModelPart::row() const {
  * \param B the blue component of the rgb values
  */
 void ModelPart::setColour(const unsigned char R, const unsigned char G, const unsigned char B) {
+    if (R != getColourR() || G != getColourG() || B != getColourB())
+        dirty |= DirtyColour;
     // Replace data in column 2,3,4 with the RGB vals
     m_itemData.replace(2, R);
     m_itemData.replace(3, G);
@@ -172,6 +215,8 @@ void ModelPart::setColour(const unsigned char R, const unsigned char G, const un
 }
 
 void ModelPart::setClip(float minX, float maxX,float minY, float maxY,float minZ, float maxZ){
+    if (minX != getMinX() || maxX != getMaxX() || minY != getMinY() || maxY != getMaxY() || minZ != getMinZ() || maxZ != getMaxZ())
+        dirty |= DirtyClip;
     m_itemData.replace(5,minX);
     m_itemData.replace(6,maxX);
     m_itemData.replace(7,minY);
@@ -228,7 +273,6 @@ unsigned char ModelPart::getColourB() {
 
 
 float ModelPart::getSize(){
-    qDebug()<<"6 got size: "<<m_itemData.at(11).toFloat();
     return m_itemData.at(11).toFloat();
 }
 
@@ -247,8 +291,9 @@ vtkSmartPointer<vtkMapper> ModelPart::getMapper() {
 
 
 void ModelPart::setSize(float size){
+    if (size != getSize())
+        dirty |= DirtySize;
     m_itemData.replace(11,size);
-    qDebug()<<"7 set size: "<<size;
 }
 
 /*!
@@ -257,6 +302,8 @@ void ModelPart::setSize(float size){
  * \param isVisible A variable to show if it is visible or not
  */
 void ModelPart::setVisible(bool isVisible) {
+    if (isVisible != visible())
+        dirty |= DirtyVisibility;
     // Replace data in column 1 with the vis boolean
     m_itemData.replace(1, isVisible);
 }
@@ -272,131 +319,601 @@ bool ModelPart::visible() {
 
 /*!
  * \brief ModelPart::loadSTL
- * Loads an STL file, sets up the name, the mapper an prepares it to be rendered
+ * Loads an STL file, sets up the name, the mapper an prepares it to be rendered.
+ * This does all the work on the calling thread, the GUI uses readSTLFile() and computeClip() through the
+ * JobSystem instead so it is not blocked.
  * \param fileName
  */
 void ModelPart::loadSTL( QString fileName ) {
-    
-    // 1. Use the vtkSTLReader class to load the STL file 
+    setSource(readSTLFile(fileName), fileName);
+    setClipResult(computeClip(getSource(), clipSettings()));
+}
+
+/*!
+ * \brief ModelPart::readSTLFile
+ * Reads an STL file. This does not touch any part so it is safe to run on a worker thread. The cell
+ * structure and bounds are built here, VTK would otherwise build them lazily the first time they are
+ * needed, which is not safe once several clip jobs read the same polydata.
+ * The normals are made once here and kept with the geometry, the mapper and the clip filters pass them on.
+ * An optimised or simplified mesh is also written to the MeshCache, the next import of the same file with
+ * the same settings reads it back and skips every stage.
+ * \param fileName the file to read
+ * \param settings the crease angle, whether to optimise and how far to simplify
+ * \return the polydata, empty if the file could not be read
+ */
+vtkSmartPointer<vtkPolyData> ModelPart::readSTLFile(const QString& fileName, const ImportSettings& settings) {
+    TRACE_ZONE("loadSTL");
+    QString cacheKey;
+    vtkSmartPointer<vtkPolyData> polyData;
+    if (settings.optimize || settings.decimation.isSet()) {
+        cacheKey = MeshCache::key(fileName, settings.key());
+        polyData = MeshCache::read(cacheKey);
+    }
 
-    file = vtkNew<vtkSTLReader>();
-    file->SetFileName(fileName.toLocal8Bit());
-    file->Update();
+    if (!polyData) {
+        vtkNew<vtkSTLReader> reader;
+        reader->SetFileName(fileName.toLocal8Bit());
+        // The reader's point merging is serial, MeshNormals::weld() does it on the SMP threads
+        reader->MergingOff();
+        reader->Update();
+
+        polyData = MeshNormals::weld(reader->GetOutput());
+        // Simplified before smoothing, smooth() splits vertices at creases which would open the mesh up
+        if (settings.decimation.isSet())
+            polyData = MeshDecimator::decimate(polyData, settings.decimation);
+        if (settings.creaseAngle > 0.)
+            polyData = MeshNormals::smooth(polyData, settings.creaseAngle);
+        if (settings.optimize)
+            polyData = MeshOptimizer::optimize(polyData, settings.sortForOverdraw);
+        if (!cacheKey.isEmpty())
+            MeshCache::write(cacheKey, polyData);
+    }
+    polyData->BuildCells();
 
-    vtkSmartPointer<vtkPolyData> inputPolyData = file->GetOutput();
     double bounds[6];
-    inputPolyData->GetBounds(bounds);
-    qDebug() << "Model Bounds:"
-             << "X: [" << bounds[0] << "," << bounds[1] << "]"
-             << "Y: [" << bounds[2] << "," << bounds[3] << "]"
-             << "Z: [" << bounds[4] << "," << bounds[5] << "]";
-    qDebug() << "Input Points:" << inputPolyData->GetNumberOfPoints();
+    polyData->GetBounds(bounds);
+    LOG_DEBUG(IO) << "Read" << fileName << "points:" << polyData->GetNumberOfPoints()
+                  << "bounds X: [" << bounds[0] << "," << bounds[1] << "]"
+                  << "Y: [" << bounds[2] << "," << bounds[3] << "]"
+                  << "Z: [" << bounds[4] << "," << bounds[5] << "]";
 
+    return polyData;
+}
 
+/*!
+ * \brief ModelPart::setSource
+ * Gives the part its geometry and creates the mapper and actor used to render it. The source is shown
+ * as it is until a clip result is set; a compact part shows nothing until then. Must be called on the GUI thread.
+ * \param polyData the geometry read by readSTLFile()
+ * \param fileName the file it was read from
+ * \param compactMesh the compact form, kept instead of the polydata if given
+ */
+void ModelPart::setSource(vtkSmartPointer<vtkPolyData> polyData, const QString& fileName, std::shared_ptr<const CompactMesh> compactMesh) {
+    static std::atomic<quint64> nextGeometryId(1);
+    if (geometry == 0 || fileName != sourceFile || m_newGeometry)
+        geometry = nextGeometryId++;
+    m_newGeometry = false;
 
+    compact = compactMesh;
+    source = compact ? nullptr : polyData;
+    sourceFile = fileName;
 
     /* 2. Initialise the part's vtkMapper */
-    mapper = vtkNew<vtkDataSetMapper>();
-
-    //mapper->SetInputConnection(file->GetOutputPort());
-    mapper->SetInputConnection(file->GetOutputPort( ));
-    mapper = applyClip();
-
+    vtkSmartPointer<vtkDataSetMapper> dataSetMapper = vtkSmartPointer<vtkDataSetMapper>::New();
+    if (source)
+        dataSetMapper->SetInputData(source);
+    else
+        dataSetMapper->SetInputData(vtkSmartPointer<vtkPolyData>::New());
+    mapper = dataSetMapper;
 
     /* 3. Initialise the part's vtkActor and link to the mapper */
-    actor = vtkNew<vtkActor>();
+    if (!actor) {
+        actor = vtkNew<vtkActor>();
+        actor->GetProperty()->SetColor(1., 0., 0.35);
+    }
     actor->SetMapper(mapper);
-    actor->GetProperty()->SetColor(1., 0., 0.35);
+    if (worldMatrix)
+        actor->SetUserMatrix(worldMatrix);
+    updateCost();
+}
 
+/*!
+ * \brief ModelPart::getSource
+ * For a compact part this decodes a new copy every call, so the clip jobs decode on the worker instead.
+ * \return the unclipped geometry of the part, null for parts without geometry
+ */
+vtkSmartPointer<vtkPolyData> ModelPart::getSource() {
+    if (!source && compact)
+        return compact->decode();
+    return source;
+}
+
+std::shared_ptr<const CompactMesh> ModelPart::getCompactSource() const {
+    return compact;
+}
+
+bool ModelPart::hasGeometry() const {
+    return source || compact;
+}
+
+quint64 ModelPart::geometryId() const {
+    return geometry;
+}
+
+QString ModelPart::getSourceFile() const {
+    return sourceFile;
+}
+
+/*!
+ * \brief ModelPart::ImportSettings::key
+ * \return every setting that changes the geometry readSTLFile() makes
+ */
+QString ModelPart::ImportSettings::key() const {
+    return QString("crease=%1 optimize=%2 overdraw=%3 triangles=%4 error=%5")
+        .arg(creaseAngle).arg(optimize).arg(optimize && sortForOverdraw)
+        .arg(decimation.triangles).arg(decimation.error, 0, 'g', 9);
+}
+
+const ModelPart::ImportSettings& ModelPart::importSettings() const {
+    return m_import;
+}
+
+/*!
+ * \brief ModelPart::setImportSettings
+ * The id of the geometry keys the clip cache, so geometry read with different settings must not share it
+ */
+void ModelPart::setImportSettings(const ImportSettings& settings) {
+    if (settings.key() != m_import.key())
+        m_newGeometry = true;
+    m_import = settings;
+}
+
+bool ModelPart::isDecimated() const {
+    return m_import.decimation.isSet();
+}
+
+/*!
+ * \brief ModelPart::evictGeometry
+ * Releases the source geometry and the clip result shown by the mapper. Clips still in flight are made stale
+ * so their results do not bring the geometry back.
+ */
+void ModelPart::evictGeometry() {
+    if (!hasGeometry())
+        return;
+    source = nullptr;
+    compact = nullptr;
+    clipStageResult = nullptr;
+    beginClip();
+    if (mapper)
+        mapper->SetInputDataObject(vtkSmartPointer<vtkPolyData>::New());
+    updateCost();
+}
+
+bool ModelPart::isEvicted() const {
+    return !hasGeometry() && !sourceFile.isEmpty();
+}
+
+/*!
+ * \brief ModelPart::residentBytes
+ * \return the size of the source (full or compact) plus the clip results that are separate copies, in bytes
+ */
+qint64 ModelPart::residentBytes() const {
+    return m_ownCost.bytes();
+}
+
+ModelPart::Cost& ModelPart::Cost::operator+=(const Cost& other) {
+    triangles += other.triangles;
+    sourceBytes += other.sourceBytes;
+    clipBytes += other.clipBytes;
+    shrinkBytes += other.shrinkBytes;
+    pipelineMs += other.pipelineMs;
+    return *this;
+}
+
+ModelPart::Cost& ModelPart::Cost::operator-=(const Cost& other) {
+    triangles -= other.triangles;
+    sourceBytes -= other.sourceBytes;
+    clipBytes -= other.clipBytes;
+    shrinkBytes -= other.shrinkBytes;
+    pipelineMs -= other.pipelineMs;
+    return *this;
+}
+
+const ModelPart::Cost& ModelPart::ownCost() const {
+    return m_ownCost;
+}
+
+const ModelPart::Cost& ModelPart::totalCost() const {
+    return m_totalCost;
+}
+
+void ModelPart::setPipelineTime(double ms) {
+    Cost cost = m_ownCost;
+    cost.pipelineMs = ms;
+    setOwnCost(cost);
+}
+
+/*!
+ * \brief ModelPart::updateCost
+ * Sizes each dataset the part holds once, when it changes. A stage output that is the same object as
+ * the stage before it (e.g. no clip planes or a size of 100%) is only counted once.
+ */
+void ModelPart::updateCost() {
+    Cost cost;
+    cost.pipelineMs = m_ownCost.pipelineMs;
+    if (source) {
+        cost.triangles = source->GetNumberOfCells();
+        cost.sourceBytes = (qint64)source->GetActualMemorySize() * 1024;
+    }
+    if (compact) {
+        cost.triangles = compact->triangleCount();
+        cost.sourceBytes = compact->bytes();
+    }
+    vtkDataObject* shown = mapper ? mapper->GetInputDataObject(0, 0) : nullptr;
+    if (clipStageResult && clipStageResult.Get() != source.Get())
+        cost.clipBytes = (qint64)clipStageResult->GetActualMemorySize() * 1024;
+    if (shown && shown != source.Get() && shown != clipStageResult.Get())
+        cost.shrinkBytes = (qint64)shown->GetActualMemorySize() * 1024;
+    setOwnCost(cost);
+}
+
+void ModelPart::setOwnCost(const Cost& cost) {
+    Cost change = cost;
+    change -= m_ownCost;
+    m_ownCost = cost;
+    for (ModelPart* part = this; part; part = part->m_parentItem)
+        part->m_totalCost += change;
+}
+
+/*!
+ * \brief ModelPart::clipSettings
+ * \return the clip percentages and size of the part, copied so they can be passed to a worker
+ */
+ModelPart::ClipSettings ModelPart::clipSettings() {
+    ClipSettings settings;
+    settings.minX = getMinX();
+    settings.maxX = getMaxX();
+    settings.minY = getMinY();
+    settings.maxY = getMaxY();
+    settings.minZ = getMinZ();
+    settings.maxZ = getMaxZ();
+    settings.size = getSize();
+    return settings;
+}
+
+ModelPart::Options ModelPart::options() {
+    Options options;
+    options.name = data(0).toString();
+    options.visible = visible();
+    options.r = getColourR();
+    options.g = getColourG();
+    options.b = getColourB();
+    options.clip = clipSettings();
+    getTransform(options.translation, options.rotation, options.scale);
+    return options;
+}
+
+void ModelPart::setOptions(const Options& options) {
+    setVisible(options.visible);
+    setName(options.name);
+    setColour(options.r, options.g, options.b);
+    setClip(options.clip.minX, options.clip.maxX, options.clip.minY, options.clip.maxY, options.clip.minZ, options.clip.maxZ);
+    setSize(options.clip.size);
+    setTransform(options.translation, options.rotation, options.scale);
+}
+
+/*!
+ * \brief ModelPart::setClipResult
+ * Shows the output of computeClip(). Must be called on the GUI thread.
+ * \param result the clipped geometry
+ * \param clipStage the output of the clip planes the result was shrunk from, kept so a size change only
+ * has to re-run the shrink. Null if not known.
+ */
+void ModelPart::setClipResult(vtkSmartPointer<vtkDataSet> result, vtkSmartPointer<vtkPolyData> clipStage) {
+    if (!result || !mapper)
+        return;
+    clipStageResult = clipStage;
+    mapper->SetInputDataObject(result);
+    if (actor)
+        actor->Modified();
+    updateCost();
+}
+
+unsigned ModelPart::dirtyFlags() const {
+    return dirty;
+}
+
+void ModelPart::clearDirty(unsigned flags) {
+    dirty &= ~flags;
+}
+
+/*!
+ * \brief ModelPart::applyProperties
+ * Copies a changed colour or visibility straight onto the actor's vtkProperty and a changed transform
+ * onto the user matrices of the part and its children, nothing in the pipeline has to re-run for these.
+ * \return the dirty flags still set, i.e. the pipeline stages that need to re-run
+ */
+unsigned ModelPart::applyProperties() {
+    if (actor) {
+        if (dirty & DirtyColour)
+            actor->GetProperty()->SetColor(getColourR() / 255., getColourG() / 255., getColourB() / 255.);
+        if (dirty & DirtyVisibility)
+            actor->SetVisibility(visible());
+    }
+    clearDirty(DirtyColour | DirtyVisibility);
+    if (dirty & DirtyTransform)
+        updateWorldMatrix();
+    return dirty;
+}
+
+/*!
+ * \brief ModelPart::setTransform
+ * Builds the local matrix from the translation, rotation and scale. The actors are only updated by
+ * updateWorldMatrix(), which applyProperties() calls when DirtyTransform is set.
+ * \param translation the translation
+ * \param rotation the rotation about x, y and z in degrees
+ * \param scale the uniform scale
+ */
+void ModelPart::setTransform(const double translation[3], const double rotation[3], double scale) {
+    bool changed = scale != scaleFactor;
+    for (int i = 0; i < 3; i++) {
+        changed = changed || translation[i] != this->translation[i] || rotation[i] != this->rotation[i];
+        this->translation[i] = translation[i];
+        this->rotation[i] = rotation[i];
+    }
+    scaleFactor = scale;
+    if (!changed)
+        return;
+    dirty |= DirtyTransform;
+
+    bool identity = scale == 1.;
+    for (int i = 0; i < 3; i++)
+        identity = identity && translation[i] == 0. && rotation[i] == 0.;
+    if (identity) {
+        localMatrix = nullptr;
+        return;
+    }
+
+    if (!localMatrix)
+        localMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    composeTransform(translation, rotation, scale, localMatrix);
+}
+
+void ModelPart::composeTransform(const double translation[3], const double rotation[3], double scale, vtkMatrix4x4* matrix) {
+    vtkNew<vtkTransform> transform;
+    transform->Translate(translation);
+    transform->RotateY(rotation[1]);
+    transform->RotateX(rotation[0]);
+    transform->RotateZ(rotation[2]);
+    transform->Scale(scale, scale, scale);
+    matrix->DeepCopy(transform->GetMatrix());
+}
+
+void ModelPart::getTransform(double translation[3], double rotation[3], double& scale) const {
+    for (int i = 0; i < 3; i++) {
+        translation[i] = this->translation[i];
+        rotation[i] = this->rotation[i];
+    }
+    scale = scaleFactor;
+}
+
+vtkMatrix4x4* ModelPart::getWorldMatrix() const {
+    return worldMatrix;
+}
+
+/*!
+ * \brief ModelPart::updateWorldMatrix
+ * Multiplies the parent's world matrix by the local matrix and sets the result on the actor. The matrix
+ * object is kept and updated in place, so the VR actor made by getNewActor() follows it too. Parts with
+ * no transform of their own or above them have no matrix at all.
+ */
+void ModelPart::updateWorldMatrix() {
+    vtkMatrix4x4* parentWorld = m_parentItem ? m_parentItem->getWorldMatrix() : nullptr;
+
+    if (!parentWorld && !localMatrix) {
+        if (worldMatrix) {
+            worldMatrix->Identity();
+            worldMatrix->Modified();
+        }
+    }
+    else {
+        if (!worldMatrix)
+            worldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+        if (parentWorld && localMatrix)
+            vtkMatrix4x4::Multiply4x4(parentWorld, localMatrix, worldMatrix);
+        else
+            worldMatrix->DeepCopy(parentWorld ? parentWorld : localMatrix.Get());
+    }
+
+    if (actor && worldMatrix && actor->GetUserMatrix() != worldMatrix.Get())
+        actor->SetUserMatrix(worldMatrix);
+    clearDirty(DirtyTransform);
+
+    for (ModelPart* child : m_childItems)
+        child->updateWorldMatrix();
+}
+
+vtkSmartPointer<vtkPolyData> ModelPart::getClipStage() const {
+    return clipStageResult;
+}
+
+/*!
+ * \brief ModelPart::beginClip
+ * \return the generation of the new clip, results of older generations are dropped
+ */
+quint64 ModelPart::beginClip() {
+    return ++clipGeneration;
+}
+
+bool ModelPart::isCurrentClip(quint64 generation) const {
+    return generation == clipGeneration;
 }
 
 vtkSmartPointer<vtkDataSetMapper> ModelPart::applyClip(){//new function for clipping
+    vtkSmartPointer<vtkDataSetMapper> newMapper = vtkSmartPointer<vtkDataSetMapper>::New();
+    if (hasGeometry())
+        newMapper->SetInputData(computeClip(getSource(), clipSettings()));
+    return newMapper;
+}
+
+/*!
+ * \brief watchCancellation
+ * Each filter reports progress a few times while it runs, if the clip has been superseded the
+ * filter is told to abort so a large part does not keep a worker busy with a result nobody wants
+ * \param filter the filter to watch
+ * \param token the token to check, nothing is done if null
+ */
+static void watchCancellation(vtkAlgorithm* filter, const CancellationToken* token) {
+    if (!token)
+        return;
+    vtkNew<vtkCallbackCommand> abortCheck;
+    abortCheck->SetClientData(const_cast<CancellationToken*>(token));
+    abortCheck->SetCallback([](vtkObject* caller, unsigned long, void* clientData, void*) {
+        if (static_cast<CancellationToken*>(clientData)->isCancelled())
+            static_cast<vtkAlgorithm*>(caller)->SetAbortExecute(1);
+    });
+    filter->AddObserver(vtkCommand::ProgressEvent, abortCheck);
+}
+
+/*!
+ * \brief ModelPart::computeClip
+ * Runs both stages of the pipeline, clip planes then shrink
+ * \param source the geometry to clip
+ * \param settings the clip percentages and size
+ * \param token optional, the filters abort at their next progress report once it is cancelled
+ * \return the clipped geometry, or null if cancelled
+ */
+vtkSmartPointer<vtkDataSet> ModelPart::computeClip(vtkPolyData* source, const ClipSettings& settings, const CancellationToken* token){
+    vtkSmartPointer<vtkPolyData> clipped = computeClipPlanes(source, settings, token);
+    if (!clipped)
+        return nullptr;
+    return computeShrink(clipped, settings.size, token);
+}
+
+/*!
+ * \brief ModelPart::computeClipPlanes
+ * Runs the six clip planes on the source geometry. This only reads the source and creates new objects,
+ * so it can run on a worker thread.
+ * \param source the geometry to clip
+ * \param settings the clip percentages, the size is not used
+ * \param token optional, cancels the filters
+ * \return the clipped geometry, detached from the pipeline that made it, or null if cancelled
+ */
+vtkSmartPointer<vtkPolyData> ModelPart::computeClipPlanes(vtkPolyData* source, const ClipSettings& settings, const CancellationToken* token){
+    TRACE_ZONE("clipPlanes");
     vtkSmartPointer<vtkPlane> planeLeft = vtkSmartPointer<vtkPlane>::New ( ) ;//creates plane to hide parts of the model at coordinates x<getMinX()
-    
-    if (file)
-    {
-        vtkSmartPointer<vtkPolyData> inputPolyData = file->GetOutput();//gets the model
-
-        double bounds[6];//creates array
-        inputPolyData->GetBounds(bounds);//stores the bounds in the array - [lowest x coord, highest x coord, lowest y coord, highest y coord, lowest z coord, highest z coord]
-
-        qDebug() << "Min X=" << getMinX();
-        //SetOrigin(X,Y,Z)
-        float lowerX = bounds[0] + (getMinX() / 100.0) * (bounds[1] - bounds[0]);//uses the result from getMinX() as the proportion of the model to be cut off - e.g. if getMinX() returns 20, the first 20% of the model will be clipped
-        planeLeft->SetOrigin(lowerX, 0.0, 0.0);//sets the origin of the plane (the first X coordinate to be shown in the display)
-        planeLeft->SetNormal(1.0, 0.0, 0.0);//sets the direction of the plane to the positive X direction, so x coordinates higher than the given are showed
-
-        vtkSmartPointer<vtkClipPolyData> clipFilterL = vtkSmartPointer<vtkClipPolyData >::New();
-        clipFilterL->SetInputConnection(file->GetOutputPort());
-        clipFilterL->SetClipFunction(planeLeft.Get());//these lines are for creating the actual model that has been clipped
-
-        // Set up the second clipping plane - code is the same as above but for different clips
-        vtkSmartPointer<vtkPlane> planeRight = vtkSmartPointer<vtkPlane>::New();
-        qDebug() << "Max X=" << getMaxX();
-        float upperX = bounds[0] + (getMaxX() / 100.0) * (bounds[1] - bounds[0]);
-        planeRight->SetOrigin(upperX, 0.0, 0.0);
-        planeRight->SetNormal(-1.0, 0.0, 0.0); // Normal points along -x (keeps left side)
-
-        vtkSmartPointer<vtkClipPolyData> clipFilterR = vtkSmartPointer<vtkClipPolyData>::New();
-        clipFilterR->SetInputConnection(clipFilterL->GetOutputPort());
-        clipFilterR->SetClipFunction(planeRight.Get());
-
-        // Set up the third clipping plane
-        vtkSmartPointer<vtkPlane> planeLowerY = vtkSmartPointer<vtkPlane>::New();
-        qDebug() << "Min Y=" << getMinY();
-        float lowerY = bounds[2] + (getMinY() / 100.0) * (bounds[3] - bounds[2]);
-        planeLowerY->SetOrigin(0, lowerY, 0.0);
-        planeLowerY->SetNormal(0., 1.0, 0.0); // Normal points along y
-
-        vtkSmartPointer<vtkClipPolyData> clipFilterLowY = vtkSmartPointer<vtkClipPolyData>::New();
-        clipFilterLowY->SetInputConnection(clipFilterR->GetOutputPort());
-        clipFilterLowY->SetClipFunction(planeLowerY.Get());
-
-        // Set up the fourth clipping plane
-        vtkSmartPointer<vtkPlane> planeUpperY = vtkSmartPointer<vtkPlane>::New();
-        qDebug() << "Max Y=" << getMaxY();
-        float upperY = bounds[2] + (getMaxY() / 100.0) * (bounds[3] - bounds[2]);
-        planeUpperY->SetOrigin(0, upperY, 0.0);
-        planeUpperY->SetNormal(0, -1.0, 0.0); // Normal points along -y
-
-        vtkSmartPointer<vtkClipPolyData> clipFilterUpY = vtkSmartPointer<vtkClipPolyData>::New();
-        clipFilterUpY->SetInputConnection(clipFilterLowY->GetOutputPort());
-        clipFilterUpY->SetClipFunction(planeUpperY.Get());
-
-        // Set up the fifth clipping plane
-        vtkSmartPointer<vtkPlane> planeLowerZ = vtkSmartPointer<vtkPlane>::New();
-        qDebug() << "Min Z=" << getMinZ();
-        float lowerZ = bounds[4] + (getMinZ() / 100.0) * (bounds[5] - bounds[4]);
-        planeLowerZ->SetOrigin(0., 0., lowerZ);
-        planeLowerZ->SetNormal(0., 0., 1); // Normal points along z
-
-        vtkSmartPointer<vtkClipPolyData> clipFilterLowZ = vtkSmartPointer<vtkClipPolyData>::New();
-        clipFilterLowZ->SetInputConnection(clipFilterUpY->GetOutputPort());
-        clipFilterLowZ->SetClipFunction(planeLowerZ.Get());
-
-        // Set up the sixth clipping plane
-        vtkSmartPointer<vtkPlane> planeUpperZ = vtkSmartPointer<vtkPlane>::New();
-        qDebug() << "Max Z=" << getMaxZ();
-        float upperZ = bounds[4] + (getMaxZ() / 100.0) * (bounds[5] - bounds[4]);
-        planeUpperZ->SetOrigin(0, 0., upperZ);
-        planeUpperZ->SetNormal(0, 0., -1); // Normal points along -z
-
-        vtkSmartPointer<vtkClipPolyData> clipFilterUpZ = vtkSmartPointer<vtkClipPolyData>::New();
-        clipFilterUpZ->SetInputConnection(clipFilterLowZ->GetOutputPort());
-        clipFilterUpZ->SetClipFunction(planeUpperZ.Get());
-
-        vtkSmartPointer<vtkShrinkFilter>shrinkFilter = vtkSmartPointer<vtkShrinkFilter>::New();
-        shrinkFilter->SetInputConnection(clipFilterUpZ->GetOutputPort());
-        shrinkFilter->SetShrinkFactor(getSize() / 100);
-        qDebug() << "Size: " << getSize() << "%";
-        // shrinkFilter->Update();
-
-        vtkSmartPointer<vtkDataSetMapper> newMapper = vtkSmartPointer<vtkDataSetMapper>::New();
-        //mapper->SetInputConnection(file->GetOutputPort());
-        newMapper->SetInputConnection(shrinkFilter->GetOutputPort());
-
-        return newMapper;
-    }
+
+    if (!source)
+        return nullptr;
+
+    double bounds[6];//creates array
+    source->GetBounds(bounds);//stores the bounds in the array - [lowest x coord, highest x coord, lowest y coord, highest y coord, lowest z coord, highest z coord]
+    LOG_TRACE(Clip) << "Clip X:" << settings.minX << settings.maxX << "Y:" << settings.minY << settings.maxY
+                    << "Z:" << settings.minZ << settings.maxZ;
+
+    //SetOrigin(X,Y,Z)
+    float lowerX = bounds[0] + (settings.minX / 100.0) * (bounds[1] - bounds[0]);//uses the result from getMinX() as the proportion of the model to be cut off - e.g. if getMinX() returns 20, the first 20% of the model will be clipped
+    planeLeft->SetOrigin(lowerX, 0.0, 0.0);//sets the origin of the plane (the first X coordinate to be shown in the display)
+    planeLeft->SetNormal(1.0, 0.0, 0.0);//sets the direction of the plane to the positive X direction, so x coordinates higher than the given are showed
+
+    vtkSmartPointer<vtkClipPolyData> clipFilterL = vtkSmartPointer<vtkClipPolyData >::New();
+    clipFilterL->SetInputData(source);
+    clipFilterL->SetClipFunction(planeLeft.Get());//these lines are for creating the actual model that has been clipped
+
+    // Set up the second clipping plane - code is the same as above but for different clips
+    vtkSmartPointer<vtkPlane> planeRight = vtkSmartPointer<vtkPlane>::New();
+    float upperX = bounds[0] + (settings.maxX / 100.0) * (bounds[1] - bounds[0]);
+    planeRight->SetOrigin(upperX, 0.0, 0.0);
+    planeRight->SetNormal(-1.0, 0.0, 0.0); // Normal points along -x (keeps left side)
+
+    vtkSmartPointer<vtkClipPolyData> clipFilterR = vtkSmartPointer<vtkClipPolyData>::New();
+    clipFilterR->SetInputConnection(clipFilterL->GetOutputPort());
+    clipFilterR->SetClipFunction(planeRight.Get());
+
+    // Set up the third clipping plane
+    vtkSmartPointer<vtkPlane> planeLowerY = vtkSmartPointer<vtkPlane>::New();
+    float lowerY = bounds[2] + (settings.minY / 100.0) * (bounds[3] - bounds[2]);
+    planeLowerY->SetOrigin(0, lowerY, 0.0);
+    planeLowerY->SetNormal(0., 1.0, 0.0); // Normal points along y
+
+    vtkSmartPointer<vtkClipPolyData> clipFilterLowY = vtkSmartPointer<vtkClipPolyData>::New();
+    clipFilterLowY->SetInputConnection(clipFilterR->GetOutputPort());
+    clipFilterLowY->SetClipFunction(planeLowerY.Get());
+
+    // Set up the fourth clipping plane
+    vtkSmartPointer<vtkPlane> planeUpperY = vtkSmartPointer<vtkPlane>::New();
+    float upperY = bounds[2] + (settings.maxY / 100.0) * (bounds[3] - bounds[2]);
+    planeUpperY->SetOrigin(0, upperY, 0.0);
+    planeUpperY->SetNormal(0, -1.0, 0.0); // Normal points along -y
+
+    vtkSmartPointer<vtkClipPolyData> clipFilterUpY = vtkSmartPointer<vtkClipPolyData>::New();
+    clipFilterUpY->SetInputConnection(clipFilterLowY->GetOutputPort());
+    clipFilterUpY->SetClipFunction(planeUpperY.Get());
+
+    // Set up the fifth clipping plane
+    vtkSmartPointer<vtkPlane> planeLowerZ = vtkSmartPointer<vtkPlane>::New();
+    float lowerZ = bounds[4] + (settings.minZ / 100.0) * (bounds[5] - bounds[4]);
+    planeLowerZ->SetOrigin(0., 0., lowerZ);
+    planeLowerZ->SetNormal(0., 0., 1); // Normal points along z
+
+    vtkSmartPointer<vtkClipPolyData> clipFilterLowZ = vtkSmartPointer<vtkClipPolyData>::New();
+    clipFilterLowZ->SetInputConnection(clipFilterUpY->GetOutputPort());
+    clipFilterLowZ->SetClipFunction(planeLowerZ.Get());
+
+    // Set up the sixth clipping plane
+    vtkSmartPointer<vtkPlane> planeUpperZ = vtkSmartPointer<vtkPlane>::New();
+    float upperZ = bounds[4] + (settings.maxZ / 100.0) * (bounds[5] - bounds[4]);
+    planeUpperZ->SetOrigin(0, 0., upperZ);
+    planeUpperZ->SetNormal(0, 0., -1); // Normal points along -z
+
+    vtkSmartPointer<vtkClipPolyData> clipFilterUpZ = vtkSmartPointer<vtkClipPolyData>::New();
+    clipFilterUpZ->SetInputConnection(clipFilterLowZ->GetOutputPort());
+    clipFilterUpZ->SetClipFunction(planeUpperZ.Get());
+
+    vtkAlgorithm* filters[6] = { clipFilterL, clipFilterR, clipFilterLowY, clipFilterUpY, clipFilterLowZ, clipFilterUpZ };
+    for (vtkAlgorithm* filter : filters)
+        watchCancellation(filter, token);
+
+    clipFilterUpZ->Update();
+    if (token && token->isCancelled())
+        return nullptr;
+
+    // Copy the output so it no longer belongs to the filters, which are freed on return
+    vtkSmartPointer<vtkPolyData> result = vtkSmartPointer<vtkPolyData>::New();
+    result->ShallowCopy(clipFilterUpZ->GetOutput());
+    return result;
+}
+
+/*!
+ * \brief ModelPart::computeShrink
+ * Runs the shrink filter on the output of computeClipPlanes(). At 100% the shrink filter would only
+ * split every cell into separate points, so the clipped geometry is used as it is.
+ * \param clipped the clipped geometry
+ * \param size the size in percent
+ * \param token optional, cancels the filter
+ * \return the shrunk geometry, or null if cancelled
+ */
+vtkSmartPointer<vtkDataSet> ModelPart::computeShrink(vtkPolyData* clipped, float size, const CancellationToken* token){
+    TRACE_ZONE("shrink");
+    if (!clipped)
+        return nullptr;
+    if (size >= 100.f)
+        return clipped;
+
+    vtkSmartPointer<vtkShrinkFilter>shrinkFilter = vtkSmartPointer<vtkShrinkFilter>::New();
+    shrinkFilter->SetInputData(clipped);
+    shrinkFilter->SetShrinkFactor(size / 100);
+    LOG_TRACE(Clip) << "Shrink to" << size << "%";
+    watchCancellation(shrinkFilter, token);
+
+    shrinkFilter->Update();
+    if (token && token->isCancelled())
+        return nullptr;
+
+    vtkSmartPointer<vtkDataSet> result;
+    result.TakeReference(shrinkFilter->GetOutput()->NewInstance());
+    result->ShallowCopy(shrinkFilter->GetOutput());
+    return result;
 }
 
 /*!
@@ -407,18 +924,20 @@ vtkSmartPointer<vtkDataSetMapper> ModelPart::applyClip(){//new function for clip
 vtkSmartPointer<vtkActor> ModelPart::getActor() {
 
     if (!actor) {
-        qDebug() << "Error: Actor is null in getActor.";
+        LOG_DEBUG(Model) << "Actor is null in getActor, making one";
         actor = vtkNew<vtkActor>();
+        if (worldMatrix)
+            actor->SetUserMatrix(worldMatrix);
     }
     if (!mapper) {
-        qDebug() << "Warning: Mapper is null in getActor.";
+        LOG_DEBUG(Model) << "Mapper is null in getActor, making one";
         mapper = vtkNew<vtkDataSetMapper>();
-        if (file && file->GetOutput()) {
-            mapper->SetInputConnection(file->GetOutputPort());
+        if (source) {
+            mapper->SetInputDataObject(source);
         } else {
             vtkSmartPointer<vtkPolyData> emptyData = vtkSmartPointer<vtkPolyData>::New();//need to use empty data to avoid pipeline errors
             mapper->SetInputDataObject(emptyData);
-            qDebug() << "Error: No valid file output for mapper.";
+            LOG_DEBUG(Model) << "No geometry yet for the mapper of" << data(0).toString();
         }
     }
     actor->SetMapper(mapper);
@@ -440,15 +959,21 @@ vtkSmartPointer<vtkActor> ModelPart::getNewActor() {
      * of this function. */
 
      
-     /* 1. Create new mapper */
+     /* 1. Create new mapper. It shares the data set the GUI mapper shows (the current clip result),
+      *    so a compact part is not decoded again for VR. A compact part whose first clip has not
+      *    finished yet shows an empty mesh, only then is the source decoded. */
 
-    vtkNew<vtkPolyDataMapper> newMapper;
-    newMapper->SetInputConnection(file->GetOutputPort());
+    vtkNew<vtkDataSetMapper> newMapper;
+    vtkDataSet* shown = mapper ? vtkDataSet::SafeDownCast(mapper->GetInputDataObject(0, 0)) : nullptr;
+    if (shown && shown->GetNumberOfCells() > 0)
+        newMapper->SetInputData(shown);
+    else
+        newMapper->SetInputData(getSource());
 
      
      /* 2. Create new actor and link to mapper */
 
-    vtkActor* newActor = vtkActor::New();
+    vtkSmartPointer<vtkActor> newActor = vtkSmartPointer<vtkActor>::New();
     newActor->SetMapper(newMapper);
      
      /* 3. Link the vtkProperties of the original actor to the new actor. This means
@@ -462,6 +987,18 @@ vtkSmartPointer<vtkActor> ModelPart::getNewActor() {
 
     newActor->SetProperty(this->getActor()->GetProperty());
 
+    /* The world matrix is shared the same way, so moving the part in the tree moves it in VR too.
+     * It has to exist from now on, as the VR actor only holds on to this one matrix object. It is
+     * given as a user transform that follows the matrix, so the VR renderer can put its placement
+     * in front of it (see VRRenderThread::addActorOffline()) instead of after it. */
+    if (!worldMatrix) {
+        worldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+        getActor()->SetUserMatrix(worldMatrix);
+    }
+    vtkNew<vtkMatrixToLinearTransform> partTransform;
+    partTransform->SetInput(worldMatrix);
+    newActor->SetUserTransform(partTransform);
+
 
     /* The new vtkActor pointer must be returned here */
     return newActor;
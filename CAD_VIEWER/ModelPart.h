@@ -27,18 +27,91 @@
 #include <vtkSTLReader.h>
 #include <vtkColor.h>
 #include <vtkPolyDataMapper.h>
+#include <vtkPolyData.h>
+#include <vtkDataSet.h>
 
 #include <vtkPlane.h>
 #include <vtkClipDataSet.h>
 #include <vtkClipPolyData.h>
 #include <vtkDataSetMapper.h>
 #include <vtkShrinkFilter.h>
+#include <vtkMatrix4x4.h>
+#include "JobSystem.h"
+#include "CompactMesh.h"
+#include "MeshNormals.h"
+#include "MeshOptimizer.h"
+#include "MeshDecimator.h"
+
+#include <memory>
 #include <vtkSmartPointer.h>
 #include <vtkActor.h>
 
 
+class ModelPartArena;
+
 class ModelPart {
+    friend class ModelPartArena;
 public:
+    /** Clip percentages and size of a part, copied out of the part so they can be
+      * passed to a worker thread along with the geometry
+      */
+    struct ClipSettings {
+        float minX, maxX, minY, maxY, minZ, maxZ;
+        float size;
+    };
+
+    /** Everything the options dialog edits, copied out of or into a part in one go so an edit
+      * can be made without the dialog, e.g. when a session is replayed
+      */
+    struct Options {
+        QString name;
+        bool visible = true;
+        unsigned char r = 255, g = 0, b = 90;
+        ClipSettings clip = { 0.f, 100.f, 0.f, 100.f, 0.f, 100.f, 100.f };
+        double translation[3] = { 0., 0., 0. };
+        double rotation[3] = { 0., 0., 0. };
+        double scale = 1.;
+    };
+
+    /** How readSTLFile() prepares the geometry, chosen when files are opened
+      */
+    struct ImportSettings {
+        double creaseAngle = MeshNormals::DefaultCreaseAngle;  /**< See MeshNormals::smooth(), 0 or less for flat facets */
+        bool optimize = true;           /**< Reorder with MeshOptimizer, the result is kept in the MeshCache */
+        bool sortForOverdraw = true;    /**< Also sort patches for overdraw when optimising */
+        MeshDecimator::Target decimation;   /**< Simplify after welding, not set for full resolution */
+
+        /** Describe the settings, used to key the MeshCache and to tell whether the geometry changes
+          * @return the settings as text
+          */
+        QString key() const;
+    };
+
+    /** Properties changed since they were last applied, each one only needs part of the
+      * pipeline re-run
+      */
+    enum DirtyFlag : unsigned {
+        DirtyColour     = 1 << 0,   /**< Actor property only */
+        DirtyVisibility = 1 << 1,   /**< Actor property only */
+        DirtySize       = 1 << 2,   /**< Shrink stage */
+        DirtyClip       = 1 << 3,   /**< Clip planes and shrink stage */
+        DirtyTransform  = 1 << 4    /**< Actor user matrix of this part and its children */
+    };
+
+    /** Memory and time used by a part, or by a part and everything below it
+      */
+    struct Cost {
+        qint64 triangles = 0;       /**< Triangles in the source geometry */
+        qint64 sourceBytes = 0;     /**< Reader output, full or compact */
+        qint64 clipBytes = 0;       /**< Clip planes output, if a separate copy */
+        qint64 shrinkBytes = 0;     /**< Shrink output shown by the mapper, if a separate copy */
+        double pipelineMs = 0.;     /**< Time taken by the last read and clip or clip alone */
+
+        qint64 bytes() const { return sourceBytes + clipBytes + shrinkBytes; }
+        Cost& operator+=(const Cost& other);
+        Cost& operator-=(const Cost& other);
+    };
+
     void setMapper(vtkSmartPointer<vtkDataSetMapper> inputMapper);
     /** Constructor
      * @param data is a List (array) of strings for each property of this item (part name and visiblity in our case
@@ -52,10 +125,26 @@ public:
     ~ModelPart();
 
     /** Add a child to this item.
-      * @param item Pointer to child object (must already be allocated using new)
+      * @param item Pointer to child object (allocated using new or by a ModelPartArena)
       */
     void appendChild(ModelPart* item);
 
+    /** Remove a child from this item without destroying it
+      * @param row is the row of the child
+      * @return the child, null if row is out of range
+      */
+    ModelPart* takeChild(int row);
+
+    /** Check whether the part was made by a ModelPartArena
+      * @return true if it was, false if it was made with new
+      */
+    bool fromArena() const;
+
+    /** Destroy a part, through its arena if it came from one
+      * @param part is the part to destroy
+      */
+    static void destroy(ModelPart* part);
+
     /** Return child at position 'row' below this item
       * @param row is the row number (below this item)
       * @return pointer to the item requested.
@@ -135,11 +224,214 @@ public:
       */
     bool visible();
 	
-	/** Load STL file
+	/** Load STL file and apply the clip on the calling thread
       * @param fileName
       */
     void loadSTL(QString fileName);
 
+    /** Read an STL file, weld its corners, give it smooth normals and optimise it for the GPU, safe to
+      * call from a worker thread
+      * @param fileName is the file to read
+      * @param settings say which of the stages to run
+      * @return the geometry, ready to be shared between threads
+      */
+    static vtkSmartPointer<vtkPolyData> readSTLFile(const QString& fileName,
+                                                    const ImportSettings& settings = ImportSettings());
+
+    /** Set the geometry of the part and create its mapper and actor (GUI thread)
+      * @param polyData is the geometry from readSTLFile(), may be null if compactMesh is given
+      * @param fileName is the file it came from
+      * @param compactMesh if given the part keeps this instead of the full polydata
+      */
+    void setSource(vtkSmartPointer<vtkPolyData> polyData, const QString& fileName = QString(),
+                   std::shared_ptr<const CompactMesh> compactMesh = nullptr);
+
+    /** Get the unclipped geometry, decoded from the compact form if the part is compact
+      * @return the geometry, null if the part has none
+      */
+    vtkSmartPointer<vtkPolyData> getSource();
+
+    /** Get the compact form of the geometry
+      * @return the compact mesh, null if the part keeps a full polydata
+      */
+    std::shared_ptr<const CompactMesh> getCompactSource() const;
+
+    /** Check whether the part has geometry in memory, in either form
+      * @return true if it does
+      */
+    bool hasGeometry() const;
+
+    /** Get the file the geometry was loaded from
+      * @return the file name, empty for parts without geometry
+      */
+    QString getSourceFile() const;
+
+    /** Drop the geometry and clip result to free memory, the part keeps its file name, actor and
+      * settings and renders as empty until the geometry is set again (GUI thread)
+      */
+    void evictGeometry();
+
+    /** Check whether the geometry has been evicted
+      * @return true if the part was loaded from a file but its geometry is not in memory
+      */
+    bool isEvicted() const;
+
+    /** Get the memory used by the part's geometry and clip result
+      * @return size in bytes
+      */
+    qint64 residentBytes() const;
+
+    /** Get the cost of this part alone, kept up to date as its geometry and clip result change
+      * @return the cost
+      */
+    const Cost& ownCost() const;
+
+    /** Get the cost of this part and all the parts below it, kept up to date as any of them
+      * change so reading it does not walk the tree
+      * @return the cost
+      */
+    const Cost& totalCost() const;
+
+    /** Record how long the pipeline took the last time it ran for this part
+      * @param ms is the time in milliseconds
+      */
+    void setPipelineTime(double ms);
+
+    /** Get the id of the part's geometry, used to key cached results made from it
+      * @return the id, 0 for parts without geometry
+      */
+    quint64 geometryId() const;
+
+    /** Get the options the dialog shows
+      * @return copy of the name, visibility, colour, clip, size and transform
+      */
+    Options options();
+
+    /** Set the options the dialog edits, the dirty flags say what changed and still has to be
+      * applied (see applyProperties())
+      * @param options are the new options
+      */
+    void setOptions(const Options& options);
+
+    /** Get the settings the part's geometry is imported with
+      * @return the settings set when the part was opened
+      */
+    const ImportSettings& importSettings() const;
+
+    /** Set the settings the part's geometry is imported with, a change takes effect when the file is next
+      * read and the geometry then gets a new id
+      * @param settings are the new settings
+      */
+    void setImportSettings(const ImportSettings& settings);
+
+    /** Check whether the part is shown simplified, the full resolution is still in its source file
+      * @return true if its import settings decimate it
+      */
+    bool isDecimated() const;
+
+    /** Get the clip settings to pass to computeClip()
+      * @return copy of the clip percentages and size
+      */
+    ClipSettings clipSettings();
+
+    /** Run the clip and shrink filters, safe to call from a worker thread
+      * @param source is the geometry to clip
+      * @param settings are the clip percentages and size
+      * @param token if given, the filters stop early once it is cancelled
+      * @return the clipped geometry, null if cancelled
+      */
+    static vtkSmartPointer<vtkDataSet> computeClip(vtkPolyData* source, const ClipSettings& settings,
+                                                   const CancellationToken* token = nullptr);
+
+    /** Run only the clip planes, the first stage of computeClip()
+      * @param source is the geometry to clip
+      * @param settings are the clip percentages
+      * @param token if given, the filters stop early once it is cancelled
+      * @return the clipped geometry, null if cancelled
+      */
+    static vtkSmartPointer<vtkPolyData> computeClipPlanes(vtkPolyData* source, const ClipSettings& settings,
+                                                          const CancellationToken* token = nullptr);
+
+    /** Run only the shrink filter, the second stage of computeClip()
+      * @param clipped is the output of computeClipPlanes()
+      * @param size is the size in percent
+      * @param token if given, the filter stops early once it is cancelled
+      * @return the shrunk geometry, null if cancelled
+      */
+    static vtkSmartPointer<vtkDataSet> computeShrink(vtkPolyData* clipped, float size,
+                                                     const CancellationToken* token = nullptr);
+
+    /** Set the part's transform relative to its parent. It is stored as a 4x4 matrix and
+      * applied to the actor as a user matrix by updateWorldMatrix(), the geometry is not touched.
+      * @param translation is the translation along x, y and z
+      * @param rotation is the rotation about x, y and z in degrees (applied in the order z, x, y like vtkProp3D)
+      * @param scale is the uniform scale factor
+      */
+    void setTransform(const double translation[3], const double rotation[3], double scale);
+
+    /** Build the matrix setTransform() stores for a translation, rotation and scale
+      * @param translation is the translation along x, y and z
+      * @param rotation is the rotation about x, y and z in degrees
+      * @param scale is the uniform scale factor
+      * @param matrix receives the transform
+      */
+    static void composeTransform(const double translation[3], const double rotation[3], double scale, vtkMatrix4x4* matrix);
+
+    /** Get the part's transform relative to its parent
+      * @param translation receives the translation
+      * @param rotation receives the rotation in degrees
+      * @param scale receives the scale factor
+      */
+    void getTransform(double translation[3], double rotation[3], double& scale) const;
+
+    /** Get the transform from the part's model coordinates to the world, i.e. its own
+      * transform combined with those of its parents
+      * @return the matrix, null if it is the identity
+      */
+    vtkMatrix4x4* getWorldMatrix() const;
+
+    /** Recompute the world matrix of this part and all of its children from their parents' and
+      * set it on their actors (GUI thread)
+      */
+    void updateWorldMatrix();
+
+    /** Get the output of the clip planes behind the geometry being shown
+      * @return the clip stage output, null if not known
+      */
+    vtkSmartPointer<vtkPolyData> getClipStage() const;
+
+    /** Get the properties changed since they were last applied
+      * @return DirtyFlag bits
+      */
+    unsigned dirtyFlags() const;
+
+    /** Mark properties as applied
+      * @param flags are the DirtyFlag bits to clear
+      */
+    void clearDirty(unsigned flags);
+
+    /** Apply changed colour, visibility and transform to the actor (GUI thread)
+      * @return the dirty flags left, which need the pipeline to re-run
+      */
+    unsigned applyProperties();
+
+    /** Start a new clip of this part, any clip started before it becomes stale (GUI thread)
+      * @return the generation of the new clip
+      */
+    quint64 beginClip();
+
+    /** Check whether a clip result is still wanted
+      * @param generation is the value beginClip() returned for the clip
+      * @return true if no newer clip has been started since
+      */
+    bool isCurrentClip(quint64 generation) const;
+
+    /** Show the result of computeClip() (GUI thread)
+      * @param result is the clipped geometry
+      * @param clipStage is the clip planes output it was made from, if known
+      */
+    void setClipResult(vtkSmartPointer<vtkDataSet> result, vtkSmartPointer<vtkPolyData> clipStage = nullptr);
+
     /** Return actor
       * @return pointer to default actor for GUI rendering
       */
@@ -170,16 +462,40 @@ private:
 	/* These are vtk properties that will be used to load/render a model of this part,
 	 * commented out for now but will be used later
 	 */
-	vtkSmartPointer<vtkSTLReader>               file=NULL;               /**< Datafile from which part loaded */
+	vtkSmartPointer<vtkPolyData>                source=NULL;             /**< Geometry loaded from the datafile */
+    std::shared_ptr<const CompactMesh>          compact;                 /**< Compact geometry, used instead of source for very large parts */
+    QString                                     sourceFile;              /**< Datafile from which part loaded */
+    quint64                                     geometry = 0;            /**< Unique id of the geometry, kept while the same file is reloaded */
+    ImportSettings                              m_import;                /**< How the source file is read */
+    bool                                        m_newGeometry = false;   /**< The import settings changed, the next source gets a new id */
     vtkSmartPointer<vtkMapper>                  mapper=NULL;             /**< Mapper for rendering */
     vtkSmartPointer<vtkActor>                   actor=NULL;              /**< Actor for rendering */
     vtkColor3<unsigned char>                    colour;             /**< User defineable colour */
+    quint64                                     clipGeneration = 0;      /**< Incremented each time a clip is started */
+    vtkSmartPointer<vtkPolyData>                clipStageResult;         /**< Clip planes output, reused when only the size changes */
+    unsigned                                    dirty = 0;               /**< DirtyFlag bits */
+    double                                      translation[3] = { 0., 0., 0. };
+    double                                      rotation[3] = { 0., 0., 0. };
+    double                                      scaleFactor = 1.;
+    vtkSmartPointer<vtkMatrix4x4>               localMatrix;             /**< Transform relative to the parent, null for identity */
+    vtkSmartPointer<vtkMatrix4x4>               worldMatrix;             /**< Transform to world coordinates, null for identity, shared with the VR actor */
+    Cost                                        m_ownCost;               /**< Cost of this part's geometry */
+    Cost                                        m_totalCost;             /**< Cost of this part and its children */
 
     vtkSmartPointer<vtkMapper>                  newMapper;
     vtkSmartPointer<vtkActor>                    newActor;
     float xMin;
     float xMax; 
 
+    /** Recompute the part's own cost from the geometry it holds and pass the change up the tree */
+    void updateCost();
+    /** Set the part's own cost and add the difference to its total and its parents' totals */
+    void setOwnCost(const Cost& cost);
+
+    ModelPartArena*                             m_arena = nullptr;       /**< Arena the part was made in, null if made with new */
+    int                                         m_arenaBlock = -1;
+    int                                         m_arenaSlot = -1;
+
 };  
 
 
@@ -0,0 +1,146 @@
+/**     @file ModelPartArena.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Pool allocator for the ModelPart tree.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "ModelPartArena.h"
+#include "ModelPart.h"
+
+#include <new>
+
+static_assert(alignof(ModelPart) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "ModelPart slots are not aligned by new[]");
+
+/*!
+ * \brief ModelPartArena::ModelPartArena
+ * Constructor
+ * \param blockSize number of parts per block
+ */
+ModelPartArena::ModelPartArena(int blockSize)
+    : blockSize(blockSize > 0 ? blockSize : DefaultBlockSize), liveCount(0) {
+}
+
+ModelPartArena::~ModelPartArena() {
+    clear();
+}
+
+void ModelPartArena::addBlock(int slots) {
+    Block block;
+    block.memory.reset(new unsigned char[(size_t)slots * sizeof(ModelPart)]);
+    block.live.assign(slots, false);
+    blocks.push_back(std::move(block));
+}
+
+ModelPart* ModelPartArena::slot(int block, int index) const {
+    return reinterpret_cast<ModelPart*>(blocks[block].memory.get() + (size_t)index * sizeof(ModelPart));
+}
+
+/*!
+ * \brief ModelPartArena::create
+ * Reuses the slot of a destroyed part if there is one, otherwise takes the next slot of the last block
+ * \param data the column data
+ * \param parent the parent part
+ * \return the part
+ */
+ModelPart* ModelPartArena::create(const QList<QVariant>& data, ModelPart* parent) {
+    int block, index;
+    if (!freeSlots.empty()) {
+        block = freeSlots.back().first;
+        index = freeSlots.back().second;
+        freeSlots.pop_back();
+    }
+    else {
+        if (blocks.empty() || blocks.back().used == (int)blocks.back().live.size())
+            addBlock(blockSize);
+        block = (int)blocks.size() - 1;
+        index = blocks.back().used++;
+    }
+
+    ModelPart* part = new (slot(block, index)) ModelPart(data, parent);
+    part->m_arena = this;
+    part->m_arenaBlock = block;
+    part->m_arenaSlot = index;
+    blocks[block].live[index] = true;
+    liveCount++;
+    return part;
+}
+
+/*!
+ * \brief ModelPartArena::destroy
+ * Runs the destructor, which destroys the children, and keeps the slot for reuse
+ * \param part the part
+ */
+void ModelPartArena::destroy(ModelPart* part) {
+    if (!part || part->m_arena != this)
+        return;
+
+    int block = part->m_arenaBlock;
+    int index = part->m_arenaSlot;
+    part->~ModelPart();
+    blocks[block].live[index] = false;
+    liveCount--;
+    freeSlots.push_back(std::make_pair(block, index));
+}
+
+/*!
+ * \brief ModelPartArena::clear
+ * Destroys the live parts block by block. Children that were made with new are not in any block, so they
+ * are destroyed first, one at a time like ModelPartList::clear() does (any arena parts below them go with
+ * them). Then each part's child list is emptied, the arena children are destroyed in their own slot, so
+ * the tree is never walked recursively.
+ */
+void ModelPartArena::clear() {
+    for (size_t b = 0; b < blocks.size(); b++) {
+        for (int i = 0; i < blocks[b].used; i++) {
+            if (!blocks[b].live[i])
+                continue;
+            QList<ModelPart*>& children = slot((int)b, i)->m_childItems;
+            for (int row = children.size() - 1; row >= 0; row--) {
+                if (!children[row]->fromArena())
+                    ModelPart::destroy(children.takeAt(row));
+            }
+        }
+    }
+
+    for (size_t b = 0; b < blocks.size(); b++)
+        for (int i = 0; i < blocks[b].used; i++)
+            if (blocks[b].live[i])
+                slot((int)b, i)->m_childItems.clear();
+
+    for (size_t b = 0; b < blocks.size(); b++)
+        for (int i = 0; i < blocks[b].used; i++)
+            if (blocks[b].live[i])
+                slot((int)b, i)->~ModelPart();
+
+    blocks.clear();
+    freeSlots.clear();
+    liveCount = 0;
+}
+
+/*!
+ * \brief ModelPartArena::reserve
+ * Allocates one block large enough for the extra parts, so a bulk import does a single allocation. Any
+ * slots left at the end of the current block are skipped.
+ * \param parts number of parts about to be created
+ */
+void ModelPartArena::reserve(qint64 parts) {
+    qint64 available = (qint64)freeSlots.size();
+    if (!blocks.empty())
+        available += (qint64)blocks.back().live.size() - blocks.back().used;
+    if (parts > available)
+        addBlock((int)(parts - (qint64)freeSlots.size()));
+}
+
+qint64 ModelPartArena::size() const {
+    return liveCount;
+}
+
+qint64 ModelPartArena::capacity() const {
+    qint64 total = 0;
+    for (const Block& block : blocks)
+        total += (qint64)block.live.size();
+    return total;
+}
@@ -0,0 +1,88 @@
+/**     @file ModelPartArena.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Pool allocator for the ModelPart tree, so large assemblies are built and
+  *     torn down with a few large allocations instead of one per part.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_MODELPARTARENA_H
+#define VIEWER_MODELPARTARENA_H
+
+#include <QList>
+#include <QVariant>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+class ModelPart;
+
+/*! \class ModelPartArena
+ *  \brief Allocates ModelParts from large blocks.
+ *  Parts are placed one after another in the order they are created, so a tree built depth first is
+ *  laid out in the order it is traversed. A single part can be destroyed (its slot is reused) and
+ *  clear() destroys every part and frees all the blocks at once, without walking the tree.
+ */
+class ModelPartArena {
+public:
+    /*!
+     * Constructor
+     * \param blockSize is the number of parts in each block allocated when the arena runs out of space
+     */
+    explicit ModelPartArena(int blockSize = DefaultBlockSize);
+
+    /*! Destructor, destroys all parts still alive */
+    ~ModelPartArena();
+
+    ModelPartArena(const ModelPartArena&) = delete;
+    ModelPartArena& operator=(const ModelPartArena&) = delete;
+
+    /*!
+     * \brief create constructs a part in the arena
+     * \param data is the column data of the part
+     * \param parent is the parent of the part, it is not added to the parent's children
+     * \return the new part
+     */
+    ModelPart* create(const QList<QVariant>& data, ModelPart* parent = nullptr);
+
+    /*!
+     * \brief destroy destroys a part made by this arena along with its children
+     * \param part is the part
+     */
+    void destroy(ModelPart* part);
+
+    /*!
+     * \brief clear destroys every part in the arena and frees its memory
+     */
+    void clear();
+
+    /*!
+     * \brief reserve makes room for a number of parts in one allocation, used before a bulk import
+     * \param parts is the number of parts that will be created
+     */
+    void reserve(qint64 parts);
+
+    qint64 size() const;        /*!< \return number of live parts */
+    qint64 capacity() const;    /*!< \return number of parts that fit in the allocated blocks */
+
+    static constexpr int DefaultBlockSize = 4096;
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]>    memory;
+        std::vector<bool>                   live;
+        int                                 used = 0;   /*!< Slots handed out from the end of the block */
+    };
+
+    void addBlock(int slots);
+    ModelPart* slot(int block, int index) const;
+
+    std::vector<Block>      blocks;
+    std::vector<std::pair<int, int>> freeSlots;     /*!< Block and slot of destroyed parts, reused first */
+    int                     blockSize;
+    qint64                  liveCount;
+};
+
+#endif
@@ -14,6 +14,7 @@
 #include <QVariant>             // For QVariant, which is used in model data
 #include <QList>                // For QList, if you're using it to store children in ModelPart
 #include <QDebug>
+#include <QLocale>
 
 /*!
  * \brief ModelPartList::ModelPartList
@@ -23,7 +24,8 @@ ModelPartList::ModelPartList( const QString& data, QObject* parent ) : QAbstract
     /* Have option to specify number of visible properties for each item in tree - the root item
      * acts as the column headers
      */
-    rootItem = new ModelPart( { tr("Part"), tr("Visible?"),tr("R"),tr("G"),tr("B"),tr("XCLIPMIN"),tr("XCLIPMAX"),tr("YCLIPMIN"),tr("YCLIPMAX"),tr("ZCLIPMIN"),tr("ZCLIPMAX"),tr("SIZE") });
+    rootItem = new ModelPart( { tr("Part"), tr("Visible?"),tr("R"),tr("G"),tr("B"),tr("XCLIPMIN"),tr("XCLIPMAX"),tr("YCLIPMIN"),tr("YCLIPMAX"),tr("ZCLIPMIN"),tr("ZCLIPMAX"),tr("SIZE"),
+                              tr("TRIANGLES"),tr("MEMORY"),tr("PIPELINE") });
 }
 
 
@@ -62,20 +64,56 @@ QVariant ModelPartList::data( const QModelIndex& index, int role ) const {
     if( !index.isValid() )
         return QVariant();
 
+    /* Get a a pointer to the item referred to by the QModelIndex */
+    ModelPart* item = static_cast<ModelPart*>( index.internalPointer() );
+
+    /* The cost columns read the totals the parts keep, nothing is summed here */
+    if (index.column() >= TrianglesColumn)
+        return costData( item->totalCost(), index.column(), role );
+
     /* Role represents what this data will be used for, we only need deal with the case
      * when QT is asking for data to create and display the treeview. Return a new,
      * empty QVariant if any other request comes through. */
     if (role != Qt::DisplayRole)
         return QVariant();
 
-    /* Get a a pointer to the item referred to by the QModelIndex */
-    ModelPart* item = static_cast<ModelPart*>( index.internalPointer() );
-
     /* Each item in the tree has a number of columns ("Part" and "Visible" in this 
      * initial example) return the column requested by the QModelIndex */
     return item->data( index.column() );
 }
 
+/*!
+ * \brief ModelPartList::costData
+ * Formats one cost column, memory is shown in MB with the split by pipeline stage as its tooltip
+ * \param cost the part's total cost
+ * \param column the cost column
+ * \param role the requested role
+ * \return the value for the view
+ */
+QVariant ModelPartList::costData( const ModelPart::Cost& cost, int column, int role ) {
+    auto megabytes = [](qint64 bytes) { return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB"; };
+
+    if (role == Qt::TextAlignmentRole)
+        return QVariant(Qt::AlignRight | Qt::AlignVCenter);
+
+    if (role == Qt::ToolTipRole && column == MemoryColumn)
+        return tr("Reader output %1\nClip output %2\nShrink output %3")
+            .arg(megabytes(cost.sourceBytes), megabytes(cost.clipBytes), megabytes(cost.shrinkBytes));
+
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (column) {
+    case TrianglesColumn:
+        return QLocale().toString(cost.triangles);
+    case MemoryColumn:
+        return megabytes(cost.bytes());
+    case PipelineTimeColumn:
+        return QString::number(cost.pipelineMs, 'f', 1) + " ms";
+    }
+    return QVariant();
+}
+
 /*!
  * \brief ModelPartList::flags#
  * Returns the flags of the selected item
@@ -195,7 +233,7 @@ QModelIndex ModelPartList::appendChild(QModelIndex& parent, const QList<QVariant
 
     beginInsertRows( parent, rowCount(parent), rowCount(parent) ); 
 
-    ModelPart* childPart = new ModelPart( data, parentPart );
+    ModelPart* childPart = arena.create( data, parentPart );
 
     parentPart->appendChild(childPart);
 
@@ -209,4 +247,80 @@ QModelIndex ModelPartList::appendChild(QModelIndex& parent, const QList<QVariant
 }
 
 
+/*!
+ * \brief ModelPartList::createPart
+ * \param data the column data
+ * \return a new part allocated from the arena
+ */
+ModelPart* ModelPartList::createPart(const QList<QVariant>& data) {
+    return arena.create(data);
+}
+
+/*!
+ * \brief ModelPartList::beginBulkImport
+ * Reserves arena space for the parts and holds back view updates until endBulkImport()
+ * \param expectedParts the number of parts that will be created
+ */
+void ModelPartList::beginBulkImport(qint64 expectedParts) {
+    beginResetModel();
+    arena.reserve(expectedParts);
+}
+
+void ModelPartList::endBulkImport() {
+    endResetModel();
+}
+
+/*!
+ * \brief ModelPartList::clear
+ * Detaches the top level parts from the root and destroys the whole arena at once. Parts that were
+ * made with new are still destroyed one at a time.
+ */
+void ModelPartList::clear() {
+    beginResetModel();
+    for (int row = rootItem->childCount() - 1; row >= 0; row--) {
+        ModelPart* part = rootItem->takeChild(row);
+        if (!part->fromArena())
+            ModelPart::destroy(part);
+    }
+    arena.clear();
+    endResetModel();
+}
+
+/*!
+ * \brief ModelPartList::removeRows
+ * Removes the parts in the rows and everything below them
+ * \param row the first row
+ * \param count the number of rows
+ * \param parent the parent index
+ * \return true if the rows were removed
+ */
+bool ModelPartList::removeRows(int row, int count, const QModelIndex& parent) {
+    ModelPart* parentPart = parent.isValid() ? static_cast<ModelPart*>(parent.internalPointer()) : rootItem;
+    if (row < 0 || count <= 0 || row + count > parentPart->childCount())
+        return false;
+
+    beginRemoveRows(parent, row, row + count - 1);
+    for (int i = row + count - 1; i >= row; i--)
+        ModelPart::destroy(parentPart->takeChild(i));
+    endRemoveRows();
+    return true;
+}
+
+QModelIndex ModelPartList::indexOf(ModelPart* part) const {
+    if (!part || part == rootItem)
+        return QModelIndex();
+    return createIndex(part->row(), 0, part);
+}
 
+/*!
+ * \brief ModelPartList::costChanged
+ * Each parent's total includes the part, so the rows up to the top of the tree are refreshed
+ * \param part the part that changed
+ */
+void ModelPartList::costChanged(ModelPart* part) {
+    for (; part && part != rootItem; part = part->parentItem()) {
+        QModelIndex first = createIndex(part->row(), TrianglesColumn, part);
+        QModelIndex last = createIndex(part->row(), PipelineTimeColumn, part);
+        emit dataChanged(first, last);
+    }
+}
@@ -12,6 +12,7 @@
 
 
 #include "ModelPart.h"
+#include "ModelPartArena.h"
 
 #include <QAbstractItemModel>
 #include <QModelIndex>
@@ -24,6 +25,14 @@ class ModelPart;
 class ModelPartList : public QAbstractItemModel {
     Q_OBJECT        /**< A special Qt tag used to indicate that this is a special Qt class that might require preprocessing before compiling. */
 public:
+    /** Columns after the part's own data, computed from ModelPart::totalCost()
+      */
+    enum CostColumn {
+        TrianglesColumn = 12,   /**< Triangles in the part and the parts below it */
+        MemoryColumn,           /**< Resident geometry bytes, the tooltip splits them by pipeline stage */
+        PipelineTimeColumn      /**< Time the pipeline last took, summed over the parts below */
+    };
+
     /** Constructor
       *  Arguments are standard arguments for this type of class but are not used in this example.
       * @param data is not used
@@ -95,8 +104,54 @@ public:
       */
     QModelIndex appendChild( QModelIndex& parent, const QList<QVariant>& data );
 
+    /** Create a part in the list's arena, it still has to be appended to a parent.
+      * Parts put in the tree should be made with this rather than new.
+      * @param data is the column data of the part
+      * @return the new part
+      */
+    ModelPart* createPart( const QList<QVariant>& data );
+
+    /** Start adding many parts at once. Space for them is allocated in one block and the
+      * views are only told about the new parts when endBulkImport() is called, so parts can be
+      * made with createPart() and added with ModelPart::appendChild() directly.
+      * @param expectedParts is the number of parts about to be created
+      */
+    void beginBulkImport( qint64 expectedParts );
+
+    /** Finish a bulk import and refresh the views
+      */
+    void endBulkImport();
+
+    /** Remove every part below the root item, freeing the arena in one go
+      */
+    void clear();
+
+    /** Remove rows (and the parts below them) from under a parent
+      * @param row is the first row to remove
+      * @param count is the number of rows
+      * @param parent is the parent index
+      * @return true if the rows were removed
+      */
+    bool removeRows( int row, int count, const QModelIndex& parent = QModelIndex() ) override;
+
+    /** Get the index of a part in the tree
+      * @param part is the part
+      * @return its index in column 0, invalid for the root item
+      */
+    QModelIndex indexOf( ModelPart* part ) const;
+
+    /** Tell the views the cost columns of a part and its parents have changed. The totals are
+      * already up to date in the parts, this only makes the views read them again.
+      * @param part is the part whose geometry, clip result or pipeline time changed
+      */
+    void costChanged( ModelPart* part );
+
 
 private:
+    /** Format a cost column for a view role */
+    static QVariant costData( const ModelPart::Cost& cost, int column, int role );
+
+    ModelPartArena arena;   /**< Storage for the parts, declared first so it outlives rootItem's children */
     ModelPart *rootItem;    /**< This is a pointer to the item at the base of the tree */
 };
 #endif
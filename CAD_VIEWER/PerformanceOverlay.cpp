@@ -0,0 +1,177 @@
+/**     @file PerformanceOverlay.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     On-screen performance statistics drawn over the desktop render window.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "PerformanceOverlay.h"
+#include "GeometryMemoryManager.h"
+
+#include <vtkActor.h>
+#include <vtkActorCollection.h>
+#include <vtkCommand.h>
+#include <vtkCoordinate.h>
+#include <vtkDataSet.h>
+#include <vtkMapper.h>
+#include <vtkRendererCollection.h>
+#include <vtkSkybox.h>
+#include <vtkTextProperty.h>
+
+namespace {
+
+QString megabytes(qint64 bytes) {
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + "MB";
+}
+
+}
+
+PerformanceOverlay::PerformanceOverlay()
+    : frameTimes("frame") {
+    text = vtkSmartPointer<vtkTextActor>::New();
+    text->SetInput("Measuring...");
+    text->GetPositionCoordinate()->SetCoordinateSystemToNormalizedViewport();
+    text->SetPosition(0.01, 0.99);
+    text->SetVisibility(false);
+    text->PickableOff();
+
+    vtkTextProperty* property = text->GetTextProperty();
+    property->SetFontFamilyToCourier();
+    property->SetFontSize(14);
+    property->SetColor(1., 1., 1.);
+    property->SetVerticalJustificationToTop();
+    property->SetBackgroundColor(0., 0., 0.);
+    property->SetBackgroundOpacity(0.5);
+
+    callback = vtkSmartPointer<vtkCallbackCommand>::New();
+    callback->SetCallback(&PerformanceOverlay::onRenderEvent);
+    callback->SetClientData(this);
+
+    clock.start();
+}
+
+PerformanceOverlay::~PerformanceOverlay() {
+    if (window)
+        window->RemoveObserver(callback);
+}
+
+void PerformanceOverlay::setRenderWindow(vtkRenderWindow* window) {
+    if (this->window)
+        this->window->RemoveObserver(callback);
+    this->window = window;
+    if (window) {
+        window->AddObserver(vtkCommand::StartEvent, callback);
+        window->AddObserver(vtkCommand::EndEvent, callback);
+    }
+}
+
+/*!
+ * \brief PerformanceOverlay::setEnabled
+ * The measurements start again each time the overlay is shown, so old frames do not skew them
+ */
+void PerformanceOverlay::setEnabled(bool enabled) {
+    this->enabled = enabled;
+    text->SetVisibility(enabled);
+    if (enabled) {
+        frameTimes.reset();
+        framesSinceUpdate = 0;
+        updates = 0;
+        lastUpdateNs = clock.nsecsElapsed();
+        text->SetInput("Measuring...");
+    }
+}
+
+bool PerformanceOverlay::isEnabled() const {
+    return enabled;
+}
+
+void PerformanceOverlay::addTo(vtkRenderer* renderer) {
+    renderer->AddActor2D(text);
+}
+
+void PerformanceOverlay::recordLoad(double ms) {
+    lastLoadMs = ms;
+}
+
+void PerformanceOverlay::recordClip(double ms) {
+    lastClipMs = ms;
+}
+
+void PerformanceOverlay::setMemoryManager(const GeometryMemoryManager* manager) {
+    memoryManager = manager;
+}
+
+void PerformanceOverlay::onRenderEvent(vtkObject*, unsigned long eventId, void* clientData, void*) {
+    PerformanceOverlay* overlay = static_cast<PerformanceOverlay*>(clientData);
+    if (!overlay->enabled)
+        return;
+    if (eventId == vtkCommand::StartEvent)
+        overlay->frameStarted();
+    else
+        overlay->frameFinished();
+}
+
+void PerformanceOverlay::frameStarted() {
+    frameStartNs = clock.nsecsElapsed();
+}
+
+void PerformanceOverlay::frameFinished() {
+    qint64 now = clock.nsecsElapsed();
+    frameTimes.record((now - frameStartNs) / 1e6);
+    framesSinceUpdate++;
+    if (now - lastUpdateNs >= UpdateIntervalMs * 1000000ll)
+        updateText();
+}
+
+/*!
+ * \brief PerformanceOverlay::updateText
+ * Walks the visible actors of the first renderer for the scene counts. Each actor is one draw, and its
+ * mapper uploads float positions and normals per point and three 32-bit indices per triangle, which
+ * is what the GPU memory estimate counts. The new text is drawn by the next frame.
+ */
+void PerformanceOverlay::updateText() {
+    qint64 now = clock.nsecsElapsed();
+    double seconds = (now - lastUpdateNs) / 1e9;
+    double fps = seconds > 0. ? framesSinceUpdate / seconds : 0.;
+
+    qint64 triangles = 0;
+    qint64 gpuBytes = 0;
+    int actors = 0;
+    vtkRenderer* renderer = window ? window->GetRenderers()->GetFirstRenderer() : nullptr;
+    if (renderer) {
+        vtkActorCollection* collection = renderer->GetActors();
+        vtkCollectionSimpleIterator it;
+        collection->InitTraversal(it);
+        while (vtkActor* actor = collection->GetNextActor(it)) {
+            if (!actor->GetVisibility() || vtkSkybox::SafeDownCast(actor))
+                continue;
+            actors++;
+            vtkDataSet* input = actor->GetMapper() ? actor->GetMapper()->GetInput() : nullptr;
+            if (!input)
+                continue;
+            triangles += input->GetNumberOfCells();
+            gpuBytes += input->GetNumberOfPoints() * 24 + input->GetNumberOfCells() * 12;
+        }
+    }
+    qint64 cpuBytes = memoryManager ? memoryManager->usage().residentBytes : 0;
+
+    QString lines = QString("FPS %1   frame p50 %2ms  p99 %3ms\n")
+                        .arg(fps, 0, 'f', 1)
+                        .arg(frameTimes.percentile(50), 0, 'f', 2)
+                        .arg(frameTimes.percentile(99), 0, 'f', 2);
+    lines += QString("Triangles %1   actors/draws %2\n").arg(triangles).arg(actors);
+    lines += QString("Geometry GPU ~%1  CPU %2\n").arg(megabytes(gpuBytes), megabytes(cpuBytes));
+    lines += QString("Last load %1ms  clip %2ms")
+                 .arg(lastLoadMs, 0, 'f', 1)
+                 .arg(lastClipMs, 0, 'f', 1);
+    text->SetInput(lines.toUtf8().constData());
+
+    framesSinceUpdate = 0;
+    lastUpdateNs = now;
+    if (++updates >= WindowUpdates) {
+        frameTimes.reset();
+        updates = 0;
+    }
+}
@@ -0,0 +1,97 @@
+/**     @file PerformanceOverlay.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     On-screen performance statistics drawn over the desktop render window.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_PERFORMANCEOVERLAY_H
+#define VIEWER_PERFORMANCEOVERLAY_H
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkTextActor.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkCallbackCommand.h>
+
+#include "LatencyHistogram.h"
+
+class GeometryMemoryManager;
+
+/*! \class PerformanceOverlay
+ *  \brief Text in the corner of the render window with frame, scene and pipeline statistics.
+ *  Every frame of the render window is timed by observing its StartEvent and EndEvent, which costs two
+ *  clock reads. The text is only rebuilt when at least UpdateIntervalMs has passed since the last time,
+ *  and only after a frame that was going to happen anyway, so the overlay never causes a render itself.
+ *  Frame time percentiles cover the last few seconds. Nothing changes while the window is idle, as
+ *  VTK only renders when something moves.
+ */
+class PerformanceOverlay {
+public:
+    static constexpr int UpdateIntervalMs = 250;    /*!< Shortest time between text updates */
+    static constexpr int WindowUpdates = 20;        /*!< Updates after which the frame histogram restarts */
+
+    PerformanceOverlay();
+    ~PerformanceOverlay();
+
+    /*!
+     * \brief setRenderWindow starts timing the frames of a render window
+     * \param window the window, its first renderer is the one measured
+     */
+    void setRenderWindow(vtkRenderWindow* window);
+
+    /*!
+     * \brief setEnabled shows or hides the overlay, frames are only timed while it is shown
+     */
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    /*!
+     * \brief addTo adds the text actor to a renderer if the overlay is shown, call it again after
+     * RemoveAllViewProps()
+     */
+    void addTo(vtkRenderer* renderer);
+
+    /*!
+     * \brief recordLoad keeps the time taken by the last STL read
+     */
+    void recordLoad(double ms);
+
+    /*!
+     * \brief recordClip keeps the time taken by the last clip and shrink
+     */
+    void recordClip(double ms);
+
+    /*!
+     * \brief setMemoryManager sets where the resident geometry size shown is read from
+     */
+    void setMemoryManager(const GeometryMemoryManager* manager);
+
+private:
+    static void onRenderEvent(vtkObject* caller, unsigned long eventId, void* clientData, void* callData);
+    void frameStarted();
+    void frameFinished();
+    void updateText();
+
+    vtkSmartPointer<vtkTextActor>       text;
+    vtkSmartPointer<vtkCallbackCommand> callback;
+    vtkSmartPointer<vtkRenderWindow>    window;
+    const GeometryMemoryManager*        memoryManager = nullptr;
+    bool                                enabled = false;
+
+    LatencyHistogram                    frameTimes;
+    QElapsedTimer                       clock;
+    qint64                              frameStartNs = 0;
+    qint64                              lastUpdateNs = 0;
+    int                                 framesSinceUpdate = 0;
+    int                                 updates = 0;
+
+    double                              lastLoadMs = 0.;
+    double                              lastClipMs = 0.;
+};
+
+#endif
@@ -0,0 +1,274 @@
+/**     @file Session.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Recording of the operations a user makes, and a replayer that runs them
+  *     again against a MainWindow and times each one.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "Session.h"
+#include "mainwindow.h"
+#include "JobSystem.h"
+#include "Trace.h"
+#include "Log.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QTextStream>
+
+namespace {
+
+const char* Header = "# WS6 session 1";
+constexpr int OptionCount = 19;
+
+}
+
+void SessionLog::record(const QString& operation, const QStringList& arguments) {
+    if (!m_enabled)
+        return;
+    Entry entry;
+    entry.operation = operation;
+    for (QString argument : arguments)
+        entry.arguments.append(argument.replace('\t', ' ').replace('\n', ' ').replace('\r', ' '));
+    m_entries.append(entry);
+    LOG_DEBUG(UI) << "Session:" << operation << arguments;
+}
+
+void SessionLog::setEnabled(bool enabled) {
+    m_enabled = enabled;
+}
+
+const QList<SessionLog::Entry>& SessionLog::entries() const {
+    return m_entries;
+}
+
+bool SessionLog::write(const QString& fileName) const {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    out << Header << "\n";
+    for (const Entry& entry : m_entries) {
+        QStringList fields = entry.arguments;
+        fields.prepend(entry.operation);
+        out << fields.join('\t') << "\n";
+    }
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
+
+/*!
+ * \brief SessionLog::read
+ * Blank lines and lines starting with # are skipped, so a session can be annotated by hand
+ */
+QList<SessionLog::Entry> SessionLog::read(const QString& fileName, QString* error) {
+    QList<Entry> entries;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *error = QString("Cannot open session %1").arg(fileName);
+        return entries;
+    }
+
+    QTextStream in(&file);
+    bool first = true;
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        if (first && line != QLatin1String(Header)) {
+            *error = QString("%1 is not a session file").arg(fileName);
+            return QList<Entry>();
+        }
+        first = false;
+        if (line.trimmed().isEmpty() || line.startsWith('#'))
+            continue;
+        QStringList fields = line.split('\t');
+        Entry entry;
+        entry.operation = fields.takeFirst();
+        entry.arguments = fields;
+        entries.append(entry);
+    }
+    return entries;
+}
+
+QStringList SessionLog::optionArguments(const ModelPart::Options& options) {
+    QStringList arguments = { options.name, options.visible ? "1" : "0",
+                              QString::number(options.r), QString::number(options.g), QString::number(options.b) };
+    for (float value : { options.clip.minX, options.clip.maxX, options.clip.minY, options.clip.maxY,
+                         options.clip.minZ, options.clip.maxZ, options.clip.size })
+        arguments.append(QString::number(value, 'g', 9));
+    for (int i = 0; i < 3; i++)
+        arguments.append(QString::number(options.translation[i], 'g', 17));
+    for (int i = 0; i < 3; i++)
+        arguments.append(QString::number(options.rotation[i], 'g', 17));
+    arguments.append(QString::number(options.scale, 'g', 17));
+    return arguments;
+}
+
+bool SessionLog::parseOptions(const QStringList& arguments, ModelPart::Options* options) {
+    if (arguments.size() != OptionCount)
+        return false;
+
+    bool ok = true;
+    auto number = [&](int i) {
+        bool valid = false;
+        double value = arguments[i].toDouble(&valid);
+        ok = ok && valid;
+        return value;
+    };
+
+    options->name = arguments[0];
+    options->visible = arguments[1] == "1";
+    options->r = (unsigned char)number(2);
+    options->g = (unsigned char)number(3);
+    options->b = (unsigned char)number(4);
+    options->clip = { (float)number(5), (float)number(6), (float)number(7), (float)number(8),
+                      (float)number(9), (float)number(10), (float)number(11) };
+    for (int i = 0; i < 3; i++) {
+        options->translation[i] = number(12 + i);
+        options->rotation[i] = number(15 + i);
+    }
+    options->scale = number(18);
+    return ok;
+}
+
+/*!
+ * \brief SessionReplay::settle
+ * Waits for the workers, then delivers the continuations they posted, which may start more jobs, until
+ * nothing is left. Zero length timers such as MainWindow::scheduleRender() run in processEvents().
+ */
+void SessionReplay::settle() {
+    JobSystem& jobs = JobSystem::instance();
+    do {
+        jobs.waitForIdle();
+        QCoreApplication::sendPostedEvents();
+        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+    } while (jobs.pendingCount() > 0);
+}
+
+/*!
+ * \brief SessionReplay::run
+ * An operation naming a part that does not exist is logged and skipped, e.g. a session recorded while a
+ * file that is now missing was loaded
+ */
+QList<SessionReplay::Result> SessionReplay::run(MainWindow& window, const QList<SessionLog::Entry>& entries, const Options& options) {
+    QList<Result> results;
+    window.sessionLog().setEnabled(false);
+    settle();
+
+    for (int i = 0; i < entries.size(); i++) {
+        const SessionLog::Entry& entry = entries[i];
+        Result result = { i + 1, entry.operation, entry.arguments.join(' '), 0., false };
+        QString target = entry.arguments.value(0);
+        ModelPart* part = window.partAt(target);
+        bool needsPart = entry.operation != "vr-stop";
+
+        if (needsPart && !part) {
+            LOG_WARNING(UI) << "Session line" << i + 1 << entry.operation << "names missing part" << target;
+            result.skipped = true;
+            results.append(result);
+            continue;
+        }
+        if (!options.vr && entry.operation.startsWith("vr-")) {
+            result.skipped = true;
+            results.append(result);
+            continue;
+        }
+
+        TRACE_ZONE("replayOperation");
+        QElapsedTimer timer;
+        timer.start();
+        if (entry.operation == "open") {
+            window.openFiles(entry.arguments.mid(1), part);
+        }
+        else if (entry.operation == "open-simplified") {
+            MeshDecimator::Target decimation;
+            decimation.triangles = entry.arguments.value(1).toLongLong();
+            decimation.error = entry.arguments.value(2).toDouble();
+            window.openFiles(entry.arguments.mid(3), part, decimation);
+        }
+        else if (entry.operation == "full-resolution") {
+            window.loadFullResolution(part);
+        }
+        else if (entry.operation == "options") {
+            ModelPart::Options partOptions;
+            if (!SessionLog::parseOptions(entry.arguments.mid(1), &partOptions)) {
+                LOG_WARNING(UI) << "Session line" << i + 1 << "has bad options";
+                result.skipped = true;
+                results.append(result);
+                continue;
+            }
+            window.setPartOptions(part, partOptions);
+        }
+        else if (entry.operation == "delete") {
+            window.deletePart(part);
+        }
+        else if (entry.operation == "vr-start") {
+            window.startVR(part);
+        }
+        else if (entry.operation == "vr-stop") {
+            window.stopVR();
+        }
+        else {
+            LOG_WARNING(UI) << "Session line" << i + 1 << "has unknown operation" << entry.operation;
+            result.skipped = true;
+            results.append(result);
+            continue;
+        }
+        settle();
+        result.ms = timer.nsecsElapsed() / 1e6;
+        results.append(result);
+    }
+    return results;
+}
+
+bool SessionReplay::writeReport(const QList<Result>& results, const QString& fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    out << "line,operation,arguments,ms,skipped\n";
+    for (const Result& result : results) {
+        QString arguments = result.arguments;
+        arguments.replace('"', "\"\"");
+        out << result.line << ',' << result.operation << ",\"" << arguments << "\","
+            << QString::number(result.ms, 'f', 3) << ',' << (result.skipped ? 1 : 0) << "\n";
+    }
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
+
+QString SessionReplay::summary(const QList<Result>& results) {
+    struct Totals {
+        int count = 0;
+        int skipped = 0;
+        double totalMs = 0.;
+        double maxMs = 0.;
+    };
+    QMap<QString, Totals> totals;
+    double allMs = 0.;
+    for (const Result& result : results) {
+        Totals& t = totals[result.operation];
+        if (result.skipped) {
+            t.skipped++;
+            continue;
+        }
+        t.count++;
+        t.totalMs += result.ms;
+        t.maxMs = qMax(t.maxMs, result.ms);
+        allMs += result.ms;
+    }
+
+    QString text;
+    for (auto it = totals.begin(); it != totals.end(); ++it)
+        text += QString("%1 count=%2 total=%3ms max=%4ms skipped=%5\n")
+                    .arg(it.key(), -10)
+                    .arg(it->count)
+                    .arg(it->totalMs, 0, 'f', 1)
+                    .arg(it->maxMs, 0, 'f', 1)
+                    .arg(it->skipped);
+    text += QString("total %1ms\n").arg(allMs, 0, 'f', 1);
+    return text;
+}
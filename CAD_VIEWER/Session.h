@@ -0,0 +1,139 @@
+/**     @file Session.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Recording of the operations a user makes, and a replayer that runs them
+  *     again against a MainWindow and times each one.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_SESSION_H
+#define VIEWER_SESSION_H
+
+#include "ModelPart.h"
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class MainWindow;
+
+/*! \class SessionLog
+ *  \brief The operations of a session, one tab separated line each.
+ *  A line is an operation name followed by its arguments, e.g. "open<tab>0<tab>/data/part.stl". Parts are
+ *  named by their path of rows from the root of the tree ("0/2" is the third child of the first top level
+ *  item, "" is the root), which is the same when the session is replayed because the tree is built by
+ *  the same operations in the same order. Operations:
+ *    - open parent file...             open STL, assembly .txt, skybox .png or .hdr/.exr files
+ *    - open-simplified parent triangles error file...
+ *                                      the same, simplified to a MeshDecimator::Target
+ *    - options part name visible r g b minX maxX minY maxY minZ maxZ size tx ty tz rx ry rz scale
+ *    - delete part
+ *    - full-resolution part            read the simplified parts below part again at full resolution
+ *    - vr-start part
+ *    - vr-stop
+ */
+class SessionLog {
+public:
+    /*! One recorded operation */
+    struct Entry {
+        QString     operation;
+        QStringList arguments;
+    };
+
+    /*!
+     * \brief record appends an operation, tabs and newlines in the arguments are replaced by spaces
+     */
+    void record(const QString& operation, const QStringList& arguments = QStringList());
+
+    /*!
+     * \brief setEnabled stops or restarts recording, a replay turns it off so it does not record itself
+     */
+    void setEnabled(bool enabled);
+
+    /*!
+     * \brief entries
+     * \return the operations recorded so far
+     */
+    const QList<Entry>& entries() const;
+
+    /*!
+     * \brief write saves the session
+     * \param fileName the text file
+     * \return true if it was written
+     */
+    bool write(const QString& fileName) const;
+
+    /*!
+     * \brief read loads a session
+     * \param fileName the text file
+     * \param error receives a message if the file cannot be read
+     * \return the operations, empty on error
+     */
+    static QList<Entry> read(const QString& fileName, QString* error);
+
+    /*!
+     * \brief optionArguments
+     * \return the options as the arguments of an "options" line, after the part path
+     */
+    static QStringList optionArguments(const ModelPart::Options& options);
+
+    /*!
+     * \brief parseOptions reads the options back from the arguments after the part path
+     * \return true if there were enough valid arguments
+     */
+    static bool parseOptions(const QStringList& arguments, ModelPart::Options* options);
+
+private:
+    QList<Entry> m_entries;
+    bool m_enabled = true;
+};
+
+/*! \class SessionReplay
+ *  \brief Runs a recorded session against a MainWindow without any dialogs and reports the wall time
+ *  of each operation. An operation is timed until every job it started, and every job those started,
+ *  has finished and its result reached the GUI thread, so a load includes the read and first clip and
+ *  an options edit includes the clips it caused.
+ */
+class SessionReplay {
+public:
+    /*! Time taken by one operation */
+    struct Result {
+        int         line;       /*!< Number of the operation in the session, from 1 */
+        QString     operation;
+        QString     arguments;
+        double      ms;
+        bool        skipped;    /*!< Not run, see Options::vr */
+    };
+
+    /*! How to replay */
+    struct Options {
+        bool vr = false;        /*!< Run vr-start and vr-stop, off by default as there may be no headset */
+    };
+
+    /*!
+     * \brief run replays the operations
+     * \param window the window to run them on, it does not have to be shown
+     * \param entries the session
+     * \param options how to replay
+     * \return the time of every operation, in order
+     */
+    static QList<Result> run(MainWindow& window, const QList<SessionLog::Entry>& entries, const Options& options);
+
+    /*!
+     * \brief writeReport writes the results as CSV
+     * \return true if the file was written
+     */
+    static bool writeReport(const QList<Result>& results, const QString& fileName);
+
+    /*!
+     * \brief summary
+     * \return one line per operation type with its count, total and slowest time
+     */
+    static QString summary(const QList<Result>& results);
+
+private:
+    static void settle();
+};
+
+#endif
@@ -0,0 +1,154 @@
+/**     @file SkyboxLoader.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Loads a cross-layout PNG skybox into a cubemap texture on a worker thread.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "SkyboxLoader.h"
+#include "Trace.h"
+
+#include <QFileInfo>
+#include <QDateTime>
+
+#include <vtkNew.h>
+#include <vtkPNGReader.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+
+#include <cstring>
+
+/*!
+ * \brief SkyboxLoader::SkyboxLoader
+ * Constructor
+ * \param fileName the PNG to load
+ */
+SkyboxLoader::SkyboxLoader(const QString& fileName)
+    : m_fileName(fileName), m_cacheKey(cacheKeyFor(fileName)) {
+}
+
+QString SkyboxLoader::fileName() const {
+    return m_fileName;
+}
+
+QString SkyboxLoader::cacheKey() const {
+    return m_cacheKey;
+}
+
+/*!
+ * \brief SkyboxLoader::cacheKeyFor
+ * A file that is edited and saved again gets a new key, so a stale texture is never reused
+ * \param fileName the PNG file
+ * \return path, size and modification time of the file
+ */
+QString SkyboxLoader::cacheKeyFor(const QString& fileName) {
+    QFileInfo info(fileName);
+    return QString("%1|%2|%3").arg(info.absoluteFilePath()).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+vtkSmartPointer<vtkTexture> SkyboxLoader::texture() const {
+    return m_texture;
+}
+
+QString SkyboxLoader::errorString() const {
+    return m_error;
+}
+
+/*!
+ * \brief SkyboxLoader::sliceCrossLayout
+ * The faces are laid out as below, with each face being a quarter of the image width. Each face is
+ * copied out row by row straight from the decoded scalars, which is one pass over 6/12 of the image.
+ *
+ *          [+Y]
+ *     [-X] [+Z] [+X] [-Z]
+ *          [-Y]
+ *
+ * VTK images have their origin at the bottom-left, the row ranges below are in that orientation
+ * and match the extents the viewer has always used.
+ * \param image the decoded image
+ * \param faces the six faces in cubemap order
+ * \param error description of the problem on failure
+ * \return true on success
+ */
+bool SkyboxLoader::sliceCrossLayout(vtkImageData* image, vtkSmartPointer<vtkImageData> faces[6], QString* error) {
+    int dims[3];
+    image->GetDimensions(dims);
+    int width = dims[0];
+    int height = dims[1];
+
+    if (width * 3 != height * 4 || width % 4 != 0) {
+        if (error)
+            *error = QString("PNG must be a 4x3 cross layout (got %1x%2)").arg(width).arg(height);
+        return false;
+    }
+
+    vtkDataArray* scalars = image->GetPointData()->GetScalars();
+    if (!scalars || scalars->GetDataType() != VTK_UNSIGNED_CHAR) {
+        if (error)
+            *error = QString("PNG must be 8 bits per channel");
+        return false;
+    }
+
+    int face = width / 4;
+    int components = scalars->GetNumberOfComponents();
+    const unsigned char* src = static_cast<const unsigned char*>(scalars->GetVoidPointer(0));
+    size_t srcRow = (size_t)width * components;
+    size_t faceRow = (size_t)face * components;
+
+    /* Bottom-left corner of each face in units of the face size */
+    const int corners[6][2] = {
+        {2, 1},     // Right (Positive X)
+        {0, 1},     // Left (Negative X)
+        {1, 0},     // Top (Positive Y)
+        {1, 2},     // Bottom (Negative Y)
+        {1, 1},     // Front (Positive Z)
+        {3, 1}      // Back (Negative Z)
+    };
+
+    for (int j = 0; j < 6; j++) {
+        vtkSmartPointer<vtkImageData> f = vtkSmartPointer<vtkImageData>::New();
+        f->SetDimensions(face, face, 1);
+        f->AllocateScalars(VTK_UNSIGNED_CHAR, components);
+        unsigned char* dst = static_cast<unsigned char*>(f->GetScalarPointer());
+
+        const unsigned char* first = src + (size_t)corners[j][1] * face * srcRow + (size_t)corners[j][0] * faceRow;
+        for (int y = 0; y < face; y++)
+            std::memcpy(dst + y * faceRow, first + y * srcRow, faceRow);
+
+        faces[j] = f;
+    }
+    return true;
+}
+
+/*!
+ * \brief SkyboxLoader::load
+ * Decodes the PNG, slices it into faces and builds the cubemap. Only CPU-side objects are created
+ * here, the texture is uploaded by the GUI thread the first time it is rendered.
+ * \return true on success
+ */
+bool SkyboxLoader::load() {
+    TRACE_ZONE("skyboxLoad");
+    vtkNew<vtkPNGReader> reader;
+    if (!reader->CanReadFile(m_fileName.toLocal8Bit().constData())) {
+        m_error = QString("Cannot read PNG file");
+        return false;
+    }
+    reader->SetFileName(m_fileName.toLocal8Bit().constData());
+    reader->Update();
+
+    vtkSmartPointer<vtkImageData> faces[6];
+    if (!sliceCrossLayout(reader->GetOutput(), faces, &m_error))
+        return false;
+
+    vtkSmartPointer<vtkTexture> texture = vtkSmartPointer<vtkTexture>::New();
+    texture->CubeMapOn();
+    for (int j = 0; j < 6; j++)
+        texture->SetInputData(j, faces[j]);
+    texture->InterpolateOn();
+    texture->MipmapOn();
+
+    m_texture = texture;
+    return true;
+}
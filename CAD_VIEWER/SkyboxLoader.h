@@ -0,0 +1,85 @@
+/**     @file SkyboxLoader.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Loads a cross-layout PNG skybox into a cubemap texture, run as a JobSystem job.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_SKYBOXLOADER_H
+#define VIEWER_SKYBOXLOADER_H
+
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkTexture.h>
+
+/*! \class SkyboxLoader
+ *  \brief Job that decodes a 4x3 cross-layout PNG and builds a cubemap texture.
+ *  The image is decoded once and each face is cut out of it with a single strided copy, so any
+ *  4:3 resolution (1024x768 up to 8192x6144 and beyond) can be used. After load() has run,
+ *  texture() holds the cubemap or errorString() says why it could not be made.
+ */
+class SkyboxLoader {
+public:
+    /*!
+     * Constructor
+     * \param fileName is the PNG file to load
+     */
+    SkyboxLoader(const QString& fileName);
+
+    /*!
+     * \brief load decodes the file and builds the texture, called on a worker thread
+     * \return true if the texture was made
+     */
+    bool load();
+
+    /*!
+     * \brief fileName
+     * \return the file being loaded
+     */
+    QString fileName() const;
+
+    /*!
+     * \brief cacheKey identifies the file contents by path, size and modification time
+     * \return the key used to cache the finished texture
+     */
+    QString cacheKey() const;
+
+    /*!
+     * \brief cacheKey
+     * \param fileName is the PNG file
+     * \return the key for the file, as cacheKey() would give for a loader of that file
+     */
+    static QString cacheKeyFor(const QString& fileName);
+
+    /*!
+     * \brief texture should be called once load() has returned
+     * \return the cubemap texture, or null if loading failed
+     */
+    vtkSmartPointer<vtkTexture> texture() const;
+
+    /*!
+     * \brief errorString
+     * \return the reason loading failed, empty on success
+     */
+    QString errorString() const;
+
+    /*!
+     * \brief sliceCrossLayout cuts the six cube faces out of a 4x3 cross-layout image
+     * \param image is the decoded image, its width must be 4/3 of its height and a multiple of 4
+     * \param faces receives the faces in cubemap order (+X, -X, +Y, -Y, +Z, -Z)
+     * \param error receives a description of the problem if the image cannot be used
+     * \return true on success
+     */
+    static bool sliceCrossLayout(vtkImageData* image, vtkSmartPointer<vtkImageData> faces[6], QString* error);
+
+private:
+    QString                         m_fileName;
+    QString                         m_cacheKey;
+    QString                         m_error;
+    vtkSmartPointer<vtkTexture>     m_texture;
+};
+
+#endif
@@ -0,0 +1,169 @@
+/**     @file Trace.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Scoped-zone tracing written out as Chrome trace JSON.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "Trace.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Trace::recording(false);
+
+namespace {
+
+/*! One finished zone */
+struct Event {
+    const char*     name;
+    std::int64_t    begin;
+    std::int64_t    end;
+};
+
+/*! The events of one thread. Only its own thread appends, so the lock is only ever contended while
+ *  the trace is being cleared or written. */
+struct ThreadBuffer {
+    std::mutex          lock;
+    int                 id = 0;
+    QString             name;
+    std::vector<Event>  events;
+    quint64             dropped = 0;
+};
+
+std::mutex                                  registryLock;
+std::vector<std::shared_ptr<ThreadBuffer>>  registry;       /*!< Kept after a thread exits so its events are still written */
+std::atomic<std::int64_t>                   startTime(0);
+
+/*!
+ * \brief localBuffer
+ * \return the buffer of the calling thread, made and registered the first time
+ */
+ThreadBuffer& localBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer) {
+        buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> guard(registryLock);
+        buffer->id = (int)registry.size() + 1;
+        buffer->name = QString("Thread %1").arg(buffer->id);
+        registry.push_back(buffer);
+    }
+    return *buffer;
+}
+
+/*!
+ * \brief jsonString
+ * \return the text quoted and escaped for JSON
+ */
+QString jsonString(const QString& text) {
+    QString escaped = text;
+    escaped.replace('\\', "\\\\").replace('"', "\\\"");
+    return '"' + escaped + '"';
+}
+
+}
+
+std::int64_t Trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*!
+ * \brief Trace::start
+ * The buffers are cleared but not freed, so a second recording does not allocate again
+ */
+void Trace::start() {
+    std::lock_guard<std::mutex> guard(registryLock);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : registry) {
+        std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+        buffer->events.clear();
+        buffer->dropped = 0;
+    }
+    startTime.store(now(), std::memory_order_relaxed);
+    recording.store(true, std::memory_order_relaxed);
+}
+
+void Trace::stop() {
+    recording.store(false, std::memory_order_relaxed);
+}
+
+void Trace::setThreadName(const QString& name) {
+    ThreadBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> guard(buffer.lock);
+    buffer.name = name;
+}
+
+void Trace::record(const char* name, std::int64_t begin, std::int64_t end) {
+    ThreadBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> guard(buffer.lock);
+    if ((int)buffer.events.size() >= MaxEventsPerThread) {
+        buffer.dropped++;
+        return;
+    }
+    buffer.events.push_back({ name, begin, end });
+}
+
+/*!
+ * \brief Trace::write
+ * Writes one complete ("X") event per zone with times in microseconds from start(), and a thread_name
+ * metadata event per thread. Zones still open are not included. Recording can carry on while this runs.
+ * \param fileName the .json file
+ * \return true if the file was written
+ */
+bool Trace::write(const QString& fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        buffers = registry;
+    }
+
+    qint64 pid = QCoreApplication::applicationPid();
+    std::int64_t origin = startTime.load(std::memory_order_relaxed);
+    QTextStream out(&file);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+        std::vector<Event> events;
+        QString name;
+        quint64 dropped;
+        {
+            std::lock_guard<std::mutex> guard(buffer->lock);
+            events = buffer->events;
+            name = buffer->name;
+            dropped = buffer->dropped;
+        }
+        if (events.empty())
+            continue;
+
+        if (dropped > 0)
+            name += QString(" (%1 zones dropped)").arg(dropped);
+        out << (first ? "" : ",\n")
+            << QString("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%1,\"tid\":%2,\"args\":{\"name\":%3}}")
+                   .arg(pid).arg(buffer->id).arg(jsonString(name));
+        first = false;
+
+        for (const Event& event : events) {
+            out << QString(",\n{\"ph\":\"X\",\"name\":%1,\"pid\":%2,\"tid\":%3,\"ts\":%4,\"dur\":%5}")
+                       .arg(jsonString(QString::fromLatin1(event.name)))
+                       .arg(pid)
+                       .arg(buffer->id)
+                       .arg((event.begin - origin) / 1000.0, 0, 'f', 3)
+                       .arg((event.end - event.begin) / 1000.0, 0, 'f', 3);
+        }
+    }
+    out << "\n]}\n";
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
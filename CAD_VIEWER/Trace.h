@@ -0,0 +1,111 @@
+/**     @file Trace.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Scoped-zone tracing written out as Chrome trace JSON, which can be opened in
+  *     chrome://tracing or ui.perfetto.dev to see where the GUI, worker and VR
+  *     threads spend their time.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_TRACE_H
+#define VIEWER_TRACE_H
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+
+/*! \class Trace
+ *  \brief Records the begin and end time of named zones on every thread.
+ *  Recording is off until start() is called. While it is off a zone costs one relaxed atomic load; while
+ *  it is on it costs two clock reads and an append to a buffer owned by the thread, so it can stay
+ *  compiled in. Define WS6_NO_TRACE to remove the zones completely.
+ *  Zone names must be string literals, only the pointer is stored.
+ */
+class Trace {
+public:
+    /*!
+     * \brief start clears any earlier recording and starts recording
+     */
+    static void start();
+
+    /*!
+     * \brief stop stops recording, the events are kept until the next start()
+     */
+    static void stop();
+
+    /*!
+     * \brief isRecording
+     * \return true between start() and stop()
+     */
+    static bool isRecording() {
+        return recording.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief write writes the events recorded so far in the Chrome trace event format
+     * \param fileName the .json file
+     * \return true if the file was written
+     */
+    static bool write(const QString& fileName);
+
+    /*!
+     * \brief setThreadName names the calling thread in the trace
+     * \param name the name shown for the thread's track
+     */
+    static void setThreadName(const QString& name);
+
+    /*!
+     * \brief now
+     * \return nanoseconds since an arbitrary fixed point, the same for all threads
+     */
+    static std::int64_t now();
+
+    /*!
+     * \brief record adds a finished zone for the calling thread
+     * \param name the zone name, a string literal
+     * \param begin the start time from now()
+     * \param end the end time from now()
+     */
+    static void record(const char* name, std::int64_t begin, std::int64_t end);
+
+    static constexpr int MaxEventsPerThread = 1 << 20;  /*!< Later events on a thread are counted but dropped */
+
+private:
+    static std::atomic<bool> recording;
+};
+
+/*! \class TraceZone
+ *  \brief Records the lifetime of the object as a zone, use it through the TRACE_ZONE macro.
+ */
+class TraceZone {
+public:
+    explicit TraceZone(const char* name)
+        : name(name), begin(Trace::isRecording() ? Trace::now() : -1) {
+    }
+
+    ~TraceZone() {
+        if (begin >= 0)
+            Trace::record(name, begin, Trace::now());
+    }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char*     name;
+    std::int64_t    begin;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef WS6_NO_TRACE
+#define TRACE_ZONE(name) do {} while (0)
+#else
+/*! Records the rest of the enclosing scope as a zone called name */
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#endif
+
+#endif
@@ -0,0 +1,154 @@
+/**     @file VRFrameGovernor.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Frame-time budget governor for the VR render loop.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "VRFrameGovernor.h"
+
+/* Tuning constants - the average reacts within a few frames but ignores single spikes,
+ * decisions need a run of bad (or good) frames and each decision is given time to take
+ * effect before the next one is made.
+ */
+static const double SmoothingFactor  = 0.1;    // Weight of the newest frame in the average
+static const double OverBudgetRatio  = 0.95;   // Average above budget*ratio counts as over budget
+static const double HeadroomRatio    = 0.75;   // Average below budget*ratio counts as headroom
+static const int    FramesToDegrade  = 10;     // Consecutive frames over budget before lowering quality
+static const int    FramesToRecover  = 90;     // Consecutive frames with headroom before raising quality (~1s)
+static const int    CooldownFrames   = 30;     // Frames to wait after a decision
+
+/*!
+ * \brief VRFrameGovernor::VRFrameGovernor
+ * Constructor
+ * \param budgetMs the frame budget in milliseconds
+ */
+VRFrameGovernor::VRFrameGovernor(double budgetMs)
+    : budgetMs(budgetMs), lod(0),
+      frames(0), framesOverBudget(0), lodIncreases(0), lodDecreases(0) {
+    reset();
+}
+
+/*!
+ * \brief VRFrameGovernor::setBudget
+ * Sets the frame budget, the current quality settings are kept
+ * \param budgetMs frame budget in milliseconds
+ */
+void VRFrameGovernor::setBudget(double budgetMs) {
+    if (budgetMs <= 0.)
+        return;
+    this->budgetMs = budgetMs;
+    reset();
+}
+
+double VRFrameGovernor::budget() const {
+    return budgetMs;
+}
+
+/*!
+ * \brief VRFrameGovernor::reset
+ * Restarts the measurement, the average starts at the budget so the first frames
+ * do not trigger a decision on their own
+ */
+void VRFrameGovernor::reset() {
+    averageMs = budgetMs * HeadroomRatio;
+    framesOver = 0;
+    framesUnder = 0;
+    cooldown = CooldownFrames;
+}
+
+/*!
+ * \brief VRFrameGovernor::addFrameTime
+ * Updates the average frame time and makes a decision if needed. Quality is lowered by increasing
+ * the LOD level and raised by decreasing it, one level per decision.
+ * \param frameMs time taken by the frame in milliseconds
+ * \return true if the LOD level changed
+ */
+bool VRFrameGovernor::addFrameTime(double frameMs) {
+    frames++;
+    if (frameMs > budgetMs)
+        framesOverBudget++;
+
+    averageMs += SmoothingFactor * (frameMs - averageMs);
+
+    if (cooldown > 0) {
+        cooldown--;
+        return false;
+    }
+
+    if (averageMs > budgetMs * OverBudgetRatio) {
+        framesOver++;
+        framesUnder = 0;
+    }
+    else if (averageMs < budgetMs * HeadroomRatio) {
+        framesUnder++;
+        framesOver = 0;
+    }
+    else {
+        framesOver = 0;
+        framesUnder = 0;
+    }
+
+    bool changed = false;
+    int l = lod;
+
+    if (framesOver >= FramesToDegrade && l < MaxLodLevel) {
+        lod = l + 1;
+        lodIncreases++;
+        changed = true;
+    }
+    else if (framesUnder >= FramesToRecover && l > 0) {
+        lod = l - 1;
+        lodDecreases++;
+        changed = true;
+    }
+
+    if (changed) {
+        framesOver = 0;
+        framesUnder = 0;
+        cooldown = CooldownFrames;
+    }
+    return changed;
+}
+
+int VRFrameGovernor::lodLevel() const {
+    return lod;
+}
+
+int VRFrameGovernor::maxLodLevel() const {
+    return MaxLodLevel;
+}
+
+double VRFrameGovernor::averageFrameTime() const {
+    return averageMs;
+}
+
+/*!
+ * \brief VRFrameGovernor::counters
+ * \return a copy of the decision counters
+ */
+VRFrameGovernor::Counters VRFrameGovernor::counters() const {
+    Counters c;
+    c.frames = frames;
+    c.framesOverBudget = framesOverBudget;
+    c.lodIncreases = lodIncreases;
+    c.lodDecreases = lodDecreases;
+    return c;
+}
+
+/*!
+ * \brief VRFrameGovernor::countersString
+ * \return the counters and current decisions formatted as a single line
+ */
+QString VRFrameGovernor::countersString() const {
+    Counters c = counters();
+    return QString("budget=%1ms frames=%2 overBudget=%3 lodUp=%4 lodDown=%5 lod=%6")
+        .arg(budgetMs, 0, 'f', 2)
+        .arg(c.frames)
+        .arg(c.framesOverBudget)
+        .arg(c.lodIncreases)
+        .arg(c.lodDecreases)
+        .arg(lodLevel());
+}
@@ -0,0 +1,109 @@
+/**     @file VRFrameGovernor.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Frame-time budget governor for the VR render loop. It is fed the time taken by
+  *     each frame and decides on a level of detail (LOD) for the parts so the headset
+  *     stays inside its frame budget.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_VRFRAMEGOVERNOR_H
+#define VIEWER_VRFRAMEGOVERNOR_H
+
+#include <QString>
+
+#include <atomic>
+
+/*! \class VRFrameGovernor
+ *  \brief Feedback loop that trades render quality for frame time.
+ *  The governor keeps a smoothed average of the frame time. When the average stays over budget it raises
+ *  the LOD level, and when there is headroom again it lowers it one step at a time. The OpenVR eye
+ *  framebuffers are sized by the headset, so the render resolution is not changed. Every decision is
+ *  counted so it can be logged.
+ */
+class VRFrameGovernor {
+public:
+    /*! Snapshot of the decision counters */
+    struct Counters {
+        quint64 frames = 0;             /*!< Frames measured */
+        quint64 framesOverBudget = 0;   /*!< Frames whose own time was over the budget */
+        quint64 lodIncreases = 0;       /*!< Times a coarser LOD level was selected */
+        quint64 lodDecreases = 0;       /*!< Times a finer LOD level was selected */
+    };
+
+    /*!
+     * Constructor
+     * \param budgetMs the frame budget in milliseconds (11.1ms is 90Hz)
+     */
+    VRFrameGovernor(double budgetMs = 11.1);
+
+    /*!
+     * \brief setBudget sets the frame budget and restarts the measurement
+     * \param budgetMs frame budget in milliseconds
+     */
+    void setBudget(double budgetMs);
+
+    /*!
+     * \brief budget
+     * \return the frame budget in milliseconds
+     */
+    double budget() const;
+
+    /*!
+     * \brief addFrameTime feeds the time taken by one frame into the governor
+     * \param frameMs time taken by the frame in milliseconds
+     * \return true if the LOD level changed and should be applied
+     */
+    bool addFrameTime(double frameMs);
+
+    /*!
+     * \brief lodLevel
+     * \return the LOD level to use (0 is full detail, maxLodLevel() is the coarsest)
+     */
+    int lodLevel() const;
+
+    /*!
+     * \brief maxLodLevel
+     * \return the coarsest LOD level the governor will select
+     */
+    int maxLodLevel() const;
+
+    /*!
+     * \brief averageFrameTime
+     * \return the smoothed frame time in milliseconds
+     */
+    double averageFrameTime() const;
+
+    /*!
+     * \brief counters can be called from any thread
+     * \return a copy of the decision counters
+     */
+    Counters counters() const;
+
+    /*!
+     * \brief countersString formats the counters for the log
+     * \return one line summary of the governor state
+     */
+    QString countersString() const;
+
+    static constexpr int    MaxLodLevel = 3;        /*!< Number of coarser LOD levels available */
+
+private:
+    void reset();
+
+    double                  budgetMs;
+    double                  averageMs;
+    int                     framesOver;         /*!< Consecutive frames with the average over budget */
+    int                     framesUnder;        /*!< Consecutive frames with headroom */
+    int                     cooldown;           /*!< Frames to wait after a decision before deciding again */
+
+    std::atomic<int>        lod;
+
+    std::atomic<quint64>    frames;
+    std::atomic<quint64>    framesOverBudget;
+    std::atomic<quint64>    lodIncreases;
+    std::atomic<quint64>    lodDecreases;
+};
+
+#endif
@@ -0,0 +1,122 @@
+/**     @file VRFrameTelemetry.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Timing histograms for each stage of the VR render loop.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "VRFrameTelemetry.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDateTime>
+#include <QStringList>
+
+/*!
+ * \brief VRFrameTelemetry::VRFrameTelemetry
+ * Constructor
+ */
+VRFrameTelemetry::VRFrameTelemetry()
+    : eventProcessing("event_processing"),
+      render("render"),
+      commandDrain("command_drain"),
+      frameInterval("frame_interval") {
+    histograms[0] = &eventProcessing;
+    histograms[1] = &render;
+    histograms[2] = &commandDrain;
+    histograms[3] = &frameInterval;
+}
+
+void VRFrameTelemetry::reset() {
+    eventProcessing.reset();
+    render.reset();
+    commandDrain.reset();
+    frameInterval.reset();
+}
+
+/*!
+ * \brief VRFrameTelemetry::summary
+ * \return p50/p99 of each histogram in milliseconds
+ */
+QString VRFrameTelemetry::summary() const {
+    QStringList parts;
+    for (const LatencyHistogram* h : histograms) {
+        parts << QString("%1 p50=%2ms p99=%3ms")
+                     .arg(h->name())
+                     .arg(h->percentile(50.), 0, 'f', 2)
+                     .arg(h->percentile(99.), 0, 'f', 2);
+    }
+    return QString("frames=%1 ").arg(frameInterval.count()) + parts.join(", ");
+}
+
+/*!
+ * \brief VRFrameTelemetry::writeJson
+ * Writes an object per histogram with the summary statistics and the non-empty buckets
+ * \param fileName the file to write
+ * \return true if successful
+ */
+bool VRFrameTelemetry::writeJson(const QString& fileName) const {
+    QJsonObject root;
+    root["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+
+    QJsonObject metrics;
+    for (const LatencyHistogram* h : histograms) {
+        QJsonObject m;
+        m["count"] = (double)h->count();
+        m["mean_ms"] = h->mean();
+        m["p50_ms"] = h->percentile(50.);
+        m["p90_ms"] = h->percentile(90.);
+        m["p99_ms"] = h->percentile(99.);
+        m["max_ms"] = h->max();
+
+        QJsonArray buckets;
+        for (int i = 0; i < LatencyHistogram::BucketCount; i++) {
+            quint64 n = h->bucketCount(i);
+            if (n == 0)
+                continue;
+            QJsonObject b;
+            b["le_ms"] = LatencyHistogram::bucketUpperBound(i);
+            b["count"] = (double)n;
+            buckets.append(b);
+        }
+        m["buckets"] = buckets;
+        metrics[h->name()] = m;
+    }
+    root["metrics"] = metrics;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    file.write(QJsonDocument(root).toJson());
+    return true;
+}
+
+/*!
+ * \brief VRFrameTelemetry::writeCsv
+ * Writes a header and one row per histogram
+ * \param fileName the file to write
+ * \return true if successful
+ */
+bool VRFrameTelemetry::writeCsv(const QString& fileName) const {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    QTextStream out(&file);
+    out << "metric,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms\n";
+    for (const LatencyHistogram* h : histograms) {
+        out << h->name() << ','
+            << h->count() << ','
+            << h->mean() << ','
+            << h->percentile(50.) << ','
+            << h->percentile(90.) << ','
+            << h->percentile(99.) << ','
+            << h->max() << '\n';
+    }
+    return true;
+}
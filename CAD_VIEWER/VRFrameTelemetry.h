@@ -0,0 +1,62 @@
+/**     @file VRFrameTelemetry.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Timing histograms for each stage of the VR render loop, with output to JSON and CSV
+  *     so frame times can be compared across model sizes.
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+#ifndef VIEWER_VRFRAMETELEMETRY_H
+#define VIEWER_VRFRAMETELEMETRY_H
+
+#include "LatencyHistogram.h"
+
+#include <QString>
+
+/*! \class VRFrameTelemetry
+ *  \brief Collection of the histograms recorded by the VR render loop.
+ *  The histograms are written by the VR thread and can be read or dumped from any thread.
+ */
+class VRFrameTelemetry {
+public:
+    /*!
+     * Constructor
+     */
+    VRFrameTelemetry();
+
+    LatencyHistogram eventProcessing;   /*!< Time in DoOneEvent() not spent rendering */
+    LatencyHistogram render;            /*!< Time spent in the render window's Render() */
+    LatencyHistogram commandDrain;      /*!< Time spent applying commands queued by the GUI */
+    LatencyHistogram frameInterval;     /*!< Time between the start of consecutive frames */
+
+    /*!
+     * \brief reset clears all histograms
+     */
+    void reset();
+
+    /*!
+     * \brief summary formats p50/p99 of every histogram on one line for the log
+     * \return the summary string
+     */
+    QString summary() const;
+
+    /*!
+     * \brief writeJson writes the summary and bucket counts of every histogram
+     * \param fileName is the file to write
+     * \return true if the file was written
+     */
+    bool writeJson(const QString& fileName) const;
+
+    /*!
+     * \brief writeCsv writes one row of summary statistics per histogram
+     * \param fileName is the file to write
+     * \return true if the file was written
+     */
+    bool writeCsv(const QString& fileName) const;
+
+private:
+    const LatencyHistogram* histograms[4];
+};
+
+#endif
@@ -8,6 +8,8 @@
   */
 
 #include "VRRenderThread.h"
+#include "Trace.h"
+#include "Log.h"
 
 
 /* Vtk headers */
@@ -26,6 +28,32 @@
 #include <vtkSTLReader.h>
 #include <vtkDataSetmapper.h>
 #include <vtkCallbackCommand.h>
+#include <vtkQuadricClustering.h>
+#include <vtkGeometryFilter.h>
+#include <vtkPolyData.h>
+#include <vtkEventData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMath.h>
+
+#include <QDebug>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cmath>
+
+/* Parts with fewer triangles than this are always drawn at full detail */
+static const vtkIdType LODMinimumCells = 20000;
+
+/* The warm-up adds the actors in at most this many batches. Each batch is one Render(), and each of
+ * those waits for a vsync, so one render per actor made large assemblies slow to start.
+ */
+static const int WarmUpBatches = 16;
+
+/* Section controls - trackpad deflection below the dead zone is ignored, full deflection
+ * moves the clip plane (or changes the part size) by SectionSpeed of the range per second
+ */
+static const double SectionDeadZone = 0.15;
+static const double SectionSpeed = 0.5;
 
 
 /* The class constructor is called by MainWindow and runs in the primary program thread, this thread
@@ -41,6 +69,18 @@ VRRenderThread::VRRenderThread( QObject* parent ) {
 	rotateX = 0.;
 	rotateY = 0.;
 	rotateZ = 0.;
+
+	telemetryFile = "vr_telemetry";
+	renderMs = 0.;
+	lodDirty = true;
+
+	/* Initialise section controls - no clip plane and full size until the controller is used */
+	sectionInput[0] = 0.;
+	sectionInput[1] = 0.;
+	clipAxis = -1;
+	clipFraction = 0.;
+	partScale = 1.;
+	sectionUsed = false;
 }
 
 
@@ -56,22 +96,121 @@ VRRenderThread::~VRRenderThread() {
 
 void VRRenderThread::addActorOffline( vtkActor* actor ) {
 
+    /* Each actor only gets one placement */
+    if (actors->IsItemPresent(actor))
+        return;
+
 	/* Check to see if render thread is running */
     double* ac = actor->GetOrigin();
 	
 		/* I have found that these initial transforms will position the FS
 		 * car model in a sensible position but you can experiment
 		 */
-    actor->RotateX(-90);
-    actor->AddPosition(-ac[0]+0, -ac[1]-100, -ac[2]-200);
-
+    vtkSmartPointer<vtkTransform> placement = vtkSmartPointer<vtkTransform>::New();
+    placement->Translate(-ac[0]+0, -ac[1]-100, -ac[2]-200);
+    placement->RotateX(-90);
+
+    /* The pose is placement * (the part's transform from the tree, if it has one), so the part
+     * is moved in its own frame first and then put in the VR scene. The actor's own position and
+     * orientation stay at identity, which leaves its origin and scale for applySection(). */
+    vtkSmartPointer<vtkTransform> pose = vtkSmartPointer<vtkTransform>::New();
+    pose->Concatenate(placement);
+    if (actor->GetUserTransform())
+        pose->Concatenate(actor->GetUserTransform());
+    actor->SetUserTransform(pose);
+
+    placements.insert(actor, placement);
     actors->AddItem(actor);
 
 }
 
 
+/* VTK objects are not thread safe, so once the VR thread is running the actors collection
+ * and the renderer are only changed by the VR thread when it applies ADD_ACTORS.
+ */
+void VRRenderThread::addActor( vtkActor* actor ) {
+	if (!isRunning()) {
+		addActorOffline(actor);
+		return;
+	}
+	{
+		QMutexLocker locker(&mutex);
+		pendingActors.enqueue(actor);
+	}
+	issueCommand(ADD_ACTORS, 0);
+}
+
+
+
+void VRRenderThread::setSkybox( vtkTexture* desktopTexture, vtkFloatArray* sphericalHarmonics ) {
+	skyboxSource = desktopTexture;
+	skyboxHarmonics = sphericalHarmonics;
+}
+
+
+/* A vtkTexture belongs to one OpenGL context, so the VR window cannot use the desktop texture.
+ * Instead a second texture is made with the same input images, which are only read.
+ */
+void VRRenderThread::createSkybox() {
+	if (!skyboxSource)
+		return;
+
+	vtkSmartPointer<vtkTexture> texture = vtkSmartPointer<vtkTexture>::New();
+	bool cube = skyboxSource->GetCubeMap();
+	if (cube)
+		texture->CubeMapOn();
+	for (int port = 0; port < skyboxSource->GetNumberOfInputPorts(); port++)
+		texture->SetInputData(port, skyboxSource->GetInputDataObject(port, 0));
+	texture->SetColorMode(skyboxSource->GetColorMode());
+	texture->InterpolateOn();
+	texture->MipmapOn();
+
+	skybox = vtkSmartPointer<vtkSkybox>::New();
+	skybox->SetTexture(texture);
+	skybox->SetProjection(cube ? vtkSkybox::Cube : vtkSkybox::Sphere);
+	renderer->AddActor(skybox);
+
+	/* Equirectangular HDR environments light the scene as well */
+	if (!cube) {
+		renderer->UseImageBasedLightingOn();
+		renderer->SetEnvironmentTexture(texture);
+		if (skyboxHarmonics) {
+			renderer->UseSphericalHarmonicsOn();
+			renderer->SetSphericalHarmonics(skyboxHarmonics);
+		}
+	}
+}
+
 
+/* Commands come from the GUI thread, so they are only queued here. The VR thread takes them
+ * off the queue once per frame and applies them with applyCommand(), which means the renderer
+ * and actors are only ever touched by the VR thread.
+ */
 void VRRenderThread::issueCommand( int cmd, double value ) {
+	QMutexLocker locker(&mutex);
+	commands.enqueue(qMakePair(cmd, value));
+}
+
+
+/* Applies every command queued since the last frame, returns the time taken in ms */
+double VRRenderThread::drainCommands() {
+	std::chrono::time_point<std::chrono::steady_clock> t_start = std::chrono::steady_clock::now();
+
+	QQueue<QPair<int, double>> pending;
+	{
+		QMutexLocker locker(&mutex);
+		pending.swap(commands);
+	}
+	while (!pending.isEmpty()) {
+		QPair<int, double> c = pending.dequeue();
+		applyCommand(c.first, c.second);
+	}
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+}
+
+
+void VRRenderThread::applyCommand( int cmd, double value ) {
 
 	/* Update class variables according to command */
 	switch (cmd) {
@@ -95,6 +234,10 @@ void VRRenderThread::issueCommand( int cmd, double value ) {
 
         case REMOVE_ACTORS:
             actors->RemoveAllItems();
+            placements.clear();
+            lodActors.clear();
+            lodJobs.cancel();
+            lodJobs = CancellationToken();
 
         case RESET_RENDER:
             renderer->RemoveAllViewProps();
@@ -103,8 +246,342 @@ void VRRenderThread::issueCommand( int cmd, double value ) {
             while( (a = (vtkActor*)actors->GetNextActor() ) ) {
                 renderer->AddActor(a);
             }
+            if (skybox)
+                renderer->AddActor(skybox);
+            lodDirty = true;
+            break;
+
+        case SET_FRAME_BUDGET:
+            governor.setBudget(value);
+            break;
+
+        case DUMP_STATS:
+            dumpTelemetry();
+            break;
+
+        case ADD_ACTORS: {
+            QQueue<vtkSmartPointer<vtkActor>> added;
+            {
+                QMutexLocker locker(&mutex);
+                added.swap(pendingActors);
+            }
+            for (vtkActor* actor : added) {
+                if (actors->IsItemPresent(actor))
+                    continue;
+                addActorOffline(actor);
+                renderer->AddActor(actor);
+                lodDirty = true;
+            }
+            break;
+        }
+	}
+}
+
+
+void VRRenderThread::setTelemetryFile( const QString& baseName ) {
+	QMutexLocker locker(&mutex);
+	telemetryFile = baseName;
+}
+
+
+/* Writes the histograms to <telemetryFile>.json and <telemetryFile>.csv */
+void VRRenderThread::dumpTelemetry() {
+	QString baseName;
+	{
+		QMutexLocker locker(&mutex);
+		baseName = telemetryFile;
+	}
+	if (baseName.isEmpty())
+		return;
+
+	bool ok = telemetry.writeJson(baseName + ".json") && telemetry.writeCsv(baseName + ".csv");
+	LOG_INFO(VR) << "VR telemetry" << (ok ? "written to" : "could not be written to") << baseName << ":" << telemetry.summary();
+	emit telemetryWritten(ok, baseName, governor.countersString());
+}
+
+
+/* Each actor gets a list of mappers, one per LOD level. The coarser levels are made with
+ * vtkQuadricClustering on the job system, so a part added while VR is running does not stall
+ * the frame. Until its levels are ready the part is drawn at full detail. Switching level is
+ * then just a SetMapper() call, so the governor can change it between two frames.
+ */
+void VRRenderThread::buildLODLevels() {
+	vtkActor* a;
+	actors->InitTraversal();
+	while( (a = (vtkActor*)actors->GetNextActor() ) ) {
+		bool known = std::any_of(lodActors.begin(), lodActors.end(), [a](const LODActor& entry) { return entry.actor == a; });
+		if (!known)
+			lodActors.push_back(buildLODActor(a));
+	}
+	lodDirty = false;
+}
+
+
+VRRenderThread::LODActor VRRenderThread::buildLODActor( vtkActor* a ) {
+	LODActor entry;
+	entry.actor = a;
+	entry.levels.push_back(a->GetMapper());
+	entry.clipPlane = vtkSmartPointer<vtkPlane>::New();
+	for (int i = 0; i < 6; i++)
+		entry.bounds[i] = 0.;
+
+	vtkMapper* mapper = a->GetMapper();
+	if (mapper) {
+		mapper->Update();
+		vtkDataSet* input = mapper->GetInput();
+		vtkIdType cells = input ? input->GetNumberOfCells() : 0;
+		if (input)
+			input->GetBounds(entry.bounds);
+
+		if (cells >= LODMinimumCells) {
+			std::shared_ptr<LODBuild> build = std::make_shared<LODBuild>();
+			entry.build = build;
+			entry.buildReady = build->finished.get_future();
+
+			vtkSmartPointer<vtkDataSet> source = input;
+			int count = governor.maxLodLevel();
+			CancellationToken token = lodJobs;
+			/* The warm-up waits for these before the first frame, so they go ahead of other work */
+			JobSystem::instance().submit([build, source, count, token]() {
+				if (!token.isCancelled())
+					build->levels = makeLODLevels(source, count, token);
+				build->finished.set_value();
+			}, JobPriority::High);
+		}
+	}
+	return entry;
+}
+
+
+std::vector<vtkSmartPointer<vtkPolyData>> VRRenderThread::makeLODLevels( vtkSmartPointer<vtkDataSet> input, int count, CancellationToken token ) {
+	TRACE_ZONE("vrBuildLOD");
+	std::vector<vtkSmartPointer<vtkPolyData>> levels;
+
+	/* The clustering filter needs polydata, shrunk parts come out of the pipeline as an unstructured grid */
+	vtkSmartPointer<vtkPolyData> surface = vtkPolyData::SafeDownCast(input);
+	if (!surface) {
+		vtkNew<vtkGeometryFilter> geometry;
+		geometry->SetInputData(input);
+		geometry->Update();
+		surface = geometry->GetOutput();
+	}
+
+	/* Each level has roughly a quarter of the triangles of the one before */
+	int divisions = (int)std::sqrt((double)input->GetNumberOfCells());
+	for (int level = 1; level <= count && !token.isCancelled(); level++) {
+		divisions = std::max(16, divisions / 2);
+
+		vtkNew<vtkQuadricClustering> cluster;
+		cluster->SetInputData(surface);
+		cluster->SetNumberOfDivisions(divisions, divisions, divisions);
+		cluster->AutoAdjustNumberOfDivisionsOn();
+		cluster->Update();
+
+		levels.push_back(cluster->GetOutput());
+	}
+	return levels;
+}
+
+
+bool VRRenderThread::collectLODLevels() {
+	bool added = false;
+	for (LODActor& entry : lodActors) {
+		if (!entry.build || entry.buildReady.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			continue;
+
+		for (vtkPolyData* level : entry.build->levels) {
+			vtkNew<vtkPolyDataMapper> levelMapper;
+			levelMapper->SetInputData(level);
+			levelMapper->ScalarVisibilityOff();
+			if (clipAxis >= 0)
+				levelMapper->AddClippingPlane(entry.clipPlane);
+			entry.levels.push_back(levelMapper);
+		}
+		entry.build = nullptr;
+		added = true;
+	}
+	return added;
+}
+
+
+/* Uploads everything to the GPU before the headset is shown any frames. VTK uploads an actor's
+ * vertex buffers and compiles its shaders the first time it is rendered, which would otherwise
+ * happen in the first frames the user sees. The compositor is faded to black, then the actors
+ * are added and rendered one at a time, and finally every LOD level is rendered once so the
+ * governor can switch level without a hitch. Progress is reported through warmUpProgress().
+ */
+void VRRenderThread::warmUp() {
+	std::chrono::time_point<std::chrono::steady_clock> t_start = std::chrono::steady_clock::now();
+
+	if (vr::VRCompositor())
+		vr::VRCompositor()->FadeToColor(0.f, 0.f, 0.f, 0.f, 1.f, false);
+
+	int actorCount = actors->GetNumberOfItems();
+	int batchSize = std::max(1, (actorCount + WarmUpBatches - 1) / WarmUpBatches);
+	int batches = (actorCount + batchSize - 1) / batchSize;
+	int steps = actorCount + batches + governor.maxLodLevel() + 1;
+	int step = 0;
+
+	/* Run the pipelines and queue the jobs that make the LOD levels */
+	vtkActor* a;
+	actors->InitTraversal();
+	while( (a = (vtkActor*)actors->GetNextActor() ) ) {
+		emit warmUpProgress(100 * step++ / steps, QString("Preparing part %1 of %2").arg(lodActors.size() + 1).arg(actorCount));
+		lodActors.push_back(buildLODActor(a));
+	}
+	lodDirty = false;
+
+	/* Upload the actors' buffers and compile their shaders, a batch of actors per render */
+	for (int first = 0; first < actorCount; first += batchSize) {
+		int last = std::min(actorCount, first + batchSize);
+		emit warmUpProgress(100 * step++ / steps, QString("Uploading parts %1 - %2 of %3").arg(first + 1).arg(last).arg(actorCount));
+		for (int i = first; i < last; i++)
+			renderer->AddActor(lodActors[i].actor);
+		window->Render();
+	}
+
+	/* The LOD jobs have been running while the parts were uploaded, nothing is shown yet so wait for the rest */
+	emit warmUpProgress(100 * step / steps, QString("Simplifying parts"));
+	for (LODActor& entry : lodActors) {
+		if (entry.build)
+			entry.buildReady.wait();
+	}
+	collectLODLevels();
+
+	/* Render each coarser LOD level once so its buffers are resident too */
+	for (int level = governor.maxLodLevel(); level >= 0; level--) {
+		emit warmUpProgress(100 * step++ / steps, QString("Uploading detail level %1").arg(level));
+		for (LODActor& entry : lodActors) {
+			int l = std::min(level, (int)entry.levels.size() - 1);
+			entry.actor->SetMapper(entry.levels[l]);
+		}
+		window->Render();
+	}
+
+	if (vr::VRCompositor())
+		vr::VRCompositor()->FadeToColor(0.5f, 0.f, 0.f, 0.f, 0.f, false);
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+	emit warmUpProgress(100, QString("Ready"));
+	emit warmUpFinished(seconds);
+	LOG_INFO(VR) << "VR warm-up took" << seconds << "s for" << actorCount << "parts";
+}
+
+
+/* The section controls are on the left trackpad/joystick (see the vrbindings folder). Pushing
+ * up/down moves the clip plane along the current axis, left/right changes the size of the parts
+ * and clicking cycles the clip axis X -> Y -> Z -> off. The callbacks are run by the interactor
+ * on the VR thread.
+ */
+void VRRenderThread::addSectionActions() {
+	interactor->AddAction("/actions/vtk/in/SectionControl", true, [this](vtkEventData* ed) {
+		vtkEventDataDevice3D* edd = ed->GetAsEventDataDevice3D();
+		if (edd)
+			edd->GetTrackPadPosition(sectionInput);
+	});
+
+	interactor->AddAction("/actions/vtk/in/NextClipAxis", false, [this](vtkEventData* ed) {
+		vtkEventDataDevice3D* edd = ed->GetAsEventDataDevice3D();
+		if (edd && edd->GetAction() == vtkEventDataAction::Press) {
+			clipAxis = (clipAxis >= 2) ? -1 : clipAxis + 1;
+			sectionUsed = true;
+			attachClipPlanes();
+		}
+	});
+}
+
+
+/* Only attach the clip planes while clipping, an unused plane still costs a shader variant */
+void VRRenderThread::attachClipPlanes() {
+	for (LODActor& entry : lodActors) {
+		for (vtkMapper* m : entry.levels) {
+			m->RemoveAllClippingPlanes();
+			if (clipAxis >= 0)
+				m->AddClippingPlane(entry.clipPlane);
+		}
+	}
+}
+
+
+/* Integrates the controller input, then updates each actor's clip plane and scale. Both are
+ * applied on the GPU (a clipping plane uniform and the actor matrix), so nothing in the
+ * pipeline re-executes and the frame rate is unaffected.
+ */
+void VRRenderThread::updateSection( double dt ) {
+	if (std::fabs(sectionInput[1]) > SectionDeadZone && clipAxis >= 0) {
+		clipFraction = std::min(0.99, std::max(0., clipFraction + sectionInput[1] * SectionSpeed * dt));
+		sectionUsed = true;
+	}
+	if (std::fabs(sectionInput[0]) > SectionDeadZone) {
+		partScale = std::min(1., std::max(0.1, partScale + sectionInput[0] * SectionSpeed * dt));
+		sectionUsed = true;
+	}
+
+	if (!sectionUsed)
+		return;
+
+	/* The actors can be rotated by commands, so the world space planes are updated every frame */
+	for (LODActor& entry : lodActors)
+		applySection(entry);
+}
+
+
+void VRRenderThread::applySection( LODActor& entry ) {
+	double centre[3];
+	for (int i = 0; i < 3; i++)
+		centre[i] = 0.5 * (entry.bounds[2 * i] + entry.bounds[2 * i + 1]);
+
+	/* Scale the part about its own centre with the actor's origin and scale. These come before the
+	 * user transform, so the actor matrix is placement * tree transform * T(centre) * S * T(-centre) */
+	entry.actor->SetOrigin(centre);
+	entry.actor->SetScale(partScale);
+
+	if (clipAxis < 0)
+		return;
+
+	/* Same convention as ModelPart::applyClip() - keep everything above the given fraction of the part's size */
+	double origin[4] = { centre[0], centre[1], centre[2], 1. };
+	double normal[4] = { 0., 0., 0., 0. };
+	origin[clipAxis] = entry.bounds[2 * clipAxis] + clipFraction * (entry.bounds[2 * clipAxis + 1] - entry.bounds[2 * clipAxis]);
+	normal[clipAxis] = 1.;
+
+	/* Clipping planes are given in world coordinates */
+	vtkMatrix4x4* m = entry.actor->GetMatrix();
+	double worldOrigin[4], worldNormal[4];
+	m->MultiplyPoint(origin, worldOrigin);
+	m->MultiplyPoint(normal, worldNormal);
+	vtkMath::Normalize(worldNormal);
+
+	entry.clipPlane->SetOrigin(worldOrigin);
+	entry.clipPlane->SetNormal(worldNormal);
+}
+
+
+/* Applies the LOD level chosen by the governor to the scene */
+void VRRenderThread::applyGovernorDecision() {
+	int level = governor.lodLevel();
+	for (LODActor& entry : lodActors) {
+		int l = std::min(level, (int)entry.levels.size() - 1);
+		if (entry.actor->GetMapper() != entry.levels[l])
+			entry.actor->SetMapper(entry.levels[l]);
+	}
+
+	LOG_INFO(VR) << "VR governor:" << governor.countersString();
+}
+
 
+/* The wall time of DoOneEvent() includes the compositor blocking until the next vsync, so it
+ * always looks like a full frame. If the compositor can report the GPU time for the frame we
+ * use that instead, otherwise we fall back to the wall time.
+ */
+double VRRenderThread::measureFrameTime(double wallMs) {
+	if (vr::VRCompositor()) {
+		vr::Compositor_FrameTiming timing;
+		timing.m_nSize = sizeof(vr::Compositor_FrameTiming);
+		if (vr::VRCompositor()->GetFrameTiming(&timing, 0) && timing.m_flTotalRenderGpuMs > 0.f)
+			return timing.m_flTotalRenderGpuMs;
 	}
+	return wallMs;
 }
 
 /* This function runs in a separate thread. This means that the program 
@@ -119,6 +596,7 @@ void VRRenderThread::run() {
 	 * so there needs to be a mechanism to pass data from the GUi thread to the VR thread.
 	 */
 
+	Trace::setThreadName("VR");
 	vtkNew<vtkNamedColors> colors;
 
 	// Set the background color.
@@ -131,13 +609,9 @@ void VRRenderThread::run() {
 	renderer = vtkOpenVRRenderer::New();	
 	
 	renderer->SetBackground(colors->GetColor3d("BkgColor").GetData());
-	
-	/* Loop through list of actors provided and add to scene */
-	vtkActor* a;
-	actors->InitTraversal();
-	while( (a = (vtkActor*)actors->GetNextActor() ) ) {
-		renderer->AddActor(a);
-	}
+
+	/* The actors are added to the scene by warmUp() once the window exists */
+	createSkybox();
 
 	/* The render window is the actual GUI window
 	 * that appears on the computer screen
@@ -157,8 +631,27 @@ void VRRenderThread::run() {
 	 */
 	interactor = vtkOpenVRRenderWindowInteractor::New();									
 	interactor->SetRenderWindow(window);													
+	addSectionActions();
 	interactor->Initialize();
-	window->Render();
+
+	/* Time every Render() of the window, DoOneEvent() renders as well as processing events */
+	vtkNew<vtkCallbackCommand> renderStart;
+	renderStart->SetClientData(this);
+	renderStart->SetCallback([](vtkObject*, unsigned long, void* clientData, void*) {
+		VRRenderThread* self = static_cast<VRRenderThread*>(clientData);
+		self->t_render = std::chrono::steady_clock::now();
+	});
+	vtkNew<vtkCallbackCommand> renderEnd;
+	renderEnd->SetClientData(this);
+	renderEnd->SetCallback([](vtkObject*, unsigned long, void* clientData, void*) {
+		VRRenderThread* self = static_cast<VRRenderThread*>(clientData);
+		self->renderMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - self->t_render).count();
+	});
+	window->AddObserver(vtkCommand::StartEvent, renderStart);
+	window->AddObserver(vtkCommand::EndEvent, renderEnd);
+
+	/* Upload everything before the headset shows the first frame */
+	warmUp();
 	
 
 	/* Now start the VR - we will implement the command loop manually
@@ -167,9 +660,36 @@ void VRRenderThread::run() {
 	 */
 	endRender = false;
 	t_last = std::chrono::steady_clock::now();
+	telemetry.reset();
+	std::chrono::time_point<std::chrono::steady_clock> t_previousFrame = t_last;
 
 	while( !interactor->GetDone() && !this->endRender ) {
+		TRACE_ZONE("vrFrame");
+		/* Time the frame and let the governor decide if the quality needs to change */
+		std::chrono::time_point<std::chrono::steady_clock> t_frame = std::chrono::steady_clock::now();
+		telemetry.frameInterval.record(std::chrono::duration<double, std::milli>(t_frame - t_previousFrame).count());
+		t_previousFrame = t_frame;
+
+		renderMs = 0.;
 		interactor->DoOneEvent( window, renderer );
+		double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_frame).count();
+		telemetry.render.record(renderMs);
+		telemetry.eventProcessing.record(std::max(0., wallMs - renderMs));
+
+		/* Apply anything the GUI has asked for since the last frame */
+		telemetry.commandDrain.record(drainCommands());
+
+		/* Move the clip plane / resize the parts from the controller input */
+		updateSection(wallMs / 1000.);
+
+		if (lodDirty) {
+			buildLODLevels();
+			attachClipPlanes();
+			applyGovernorDecision();
+		}
+		bool levelsAdded = collectLODLevels();
+		if (governor.addFrameTime(measureFrameTime(wallMs)) || levelsAdded)
+			applyGovernorDecision();
 
 		/* Check to see if enough time has elapsed since last update 
 		 * This looks overcomplicated (and it is, C++ loves to make things unecessarily complicated!) but
@@ -184,26 +704,17 @@ void VRRenderThread::run() {
 		 */
 		if (std::chrono::duration_cast <std::chrono::milliseconds> (std::chrono::steady_clock::now() - t_last).count() > 20) {
 
-			/* Do things that might need doing ... */
-			vtkActorCollection* actorList = renderer->GetActors();
-			vtkActor* a;
+			/* Do things that might need doing ... the rotations are added to each actor's
+			 * placement, so the parts turn in the VR frame the same way they used to */
+			for (vtkTransform* placement : placements) {
+				/* X Rotation */
+				placement->RotateX(rotateX);
 
-			/* X Rotation */
-			actorList->InitTraversal();
-			while ((a = (vtkActor*)actorList->GetNextActor())) {
-				a->RotateX(rotateX);
-			}
+				/* Y Rotation */
+				placement->RotateY(rotateY);
 
-			/* Y Rotation */
-			actorList->InitTraversal();
-			while ((a = (vtkActor*)actorList->GetNextActor())) {
-				a->RotateY(rotateY);
-			}
-
-			/* Z Rotation */
-			actorList->InitTraversal();
-			while ((a = (vtkActor*)actorList->GetNextActor())) {
-				a->RotateZ(rotateZ);
+				/* Z Rotation */
+				placement->RotateZ(rotateZ);
 			}
 			
 			/* Remember time now */
@@ -213,6 +724,17 @@ void VRRenderThread::run() {
 
 	}
 
+	LOG_INFO(VR) << "VR governor at exit:" << governor.countersString();
+	lodJobs.cancel();
+	dumpTelemetry();
+
+	/* Hand the final section state back to the GUI so the desktop view matches */
+	if (sectionUsed)
+		emit sectionChanged(clipAxis, clipFraction * 100., partScale * 100.);
+
+	window->RemoveObserver(renderStart);
+	window->RemoveObserver(renderEnd);
+
 	window->Finalize();
 }
 
@@ -10,11 +10,18 @@
 #define VR_RENDER_THREAD_H
 
 /* Project headers */
+#include "VRFrameGovernor.h"
+#include "VRFrameTelemetry.h"
+#include "JobSystem.h"
 
 /* Qt headers */
 #include <QThread>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QQueue>
+#include <QPair>
+#include <QHash>
+#include <QString>
 
 /* Vtk headers */
 #include <vtkActor.h>
@@ -24,6 +31,18 @@
 #include <vtkOpenVRCamera.h>	
 #include <vtkActorCollection.h>
 #include <vtkCommand.h>
+#include <vtkMapper.h>
+#include <vtkPlane.h>
+#include <vtkPolyData.h>
+#include <vtkTransform.h>
+#include <vtkTexture.h>
+#include <vtkFloatArray.h>
+#include <vtkSkybox.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
 
 
 
@@ -44,7 +63,10 @@ public:
         ROTATE_Y,
         ROTATE_Z,
         REMOVE_ACTORS,
-        RESET_RENDER
+        RESET_RENDER,
+        SET_FRAME_BUDGET,
+        DUMP_STATS,
+        ADD_ACTORS
     } Command;
 
 
@@ -61,6 +83,19 @@ public:
      */
     void addActorOffline(vtkActor* actor);
 
+    /** Adds an actor from the GUI thread. Once the thread is running the actor is only queued
+      * and the VR thread adds it with the ADD_ACTORS command, before that this is the same as
+      * addActorOffline(). An actor that is already in the scene is not added again.
+      */
+    void addActor(vtkActor* actor);
+
+    /** Sets the skybox shown in VR, must be called before the thread is started. The VR
+      * thread makes its own texture from the same (already decoded) images as the desktop
+      * texture, so nothing is decoded again. If spherical harmonics are given the skybox
+      * is also used for image-based lighting.
+      */
+    void setSkybox(vtkTexture* desktopTexture, vtkFloatArray* sphericalHarmonics = nullptr);
+
 
     /** This allows commands to be issued to the VR thread in a thread safe way. 
       * Function will set variables within the class to indicate the type of
@@ -68,6 +103,38 @@ public:
       */
     void issueCommand( int cmd, double value );
 
+    /** Sets where the frame timing histograms are written, ".json" and ".csv" are
+      * appended. They are written on DUMP_STATS and when the render loop ends.
+      */
+    void setTelemetryFile( const QString& baseName );
+
+
+signals:
+    /** Emitted during the warm-up before the first VR frame is shown
+      * @param percent is how far through the warm-up the thread is
+      * @param stage describes what is being done
+      */
+    void warmUpProgress( int percent, const QString& stage );
+
+    /** Emitted when the warm-up is complete and the headset is showing the scene
+      * @param seconds is the time the warm-up took
+      */
+    void warmUpFinished( double seconds );
+
+    /** Emitted when the render loop ends if the section controls were used in VR, so
+      * the desktop parts can be updated to match what the user saw in the headset
+      * @param axis is the clip axis (0 = X, 1 = Y, 2 = Z) or -1 if clipping was turned off
+      * @param clipPercent is the lower clip position along the axis as a percentage of each part's size
+      * @param sizePercent is the scale of each part about its own centre, as a percentage
+      */
+    void sectionChanged( int axis, double clipPercent, double sizePercent );
+
+    /** Emitted after the frame timing histograms have been written by dumpTelemetry()
+      * @param ok is false if either file could not be written
+      * @param baseName is the file name without the ".json"/".csv" extension
+      * @param governor is the frame-time governor's budget, counters and LOD level
+      */
+    void telemetryWritten( bool ok, const QString& baseName, const QString& governor );
 
 protected:
     /** This is a re-implementation of a QThread function 
@@ -75,6 +142,77 @@ protected:
     void run() override;
 
 private:
+    /** The coarser LOD levels of one actor, made on the job system. The job only makes the
+      * polydata, the mappers are made by the VR thread once finished is set. */
+    struct LODBuild {
+        std::vector<vtkSmartPointer<vtkPolyData>>       levels;         /*!< Coarser levels, filled in by the job */
+        std::promise<void>                              finished;       /*!< Set by the job once levels is complete */
+    };
+
+    /** An actor in the scene together with its mappers for each LOD level, level 0 is the mapper
+      * the actor was added with. An entry is made once per actor, so level 0 is never a coarse level. */
+    struct LODActor {
+        vtkActor*                                       actor;
+        std::vector<vtkSmartPointer<vtkMapper>>         levels;
+        double                                          bounds[6];      /*!< Bounds of the part in model coordinates */
+        vtkSmartPointer<vtkPlane>                       clipPlane;      /*!< GPU clipping plane, in world coordinates */
+        std::shared_ptr<LODBuild>                       build;          /*!< Coarser levels still being made, null once added */
+        std::future<void>                               buildReady;     /*!< Ready when build has finished */
+    };
+
+    /** Applies a command on the VR thread, see issueCommand() */
+    void applyCommand( int cmd, double value );
+
+    /** Applies all queued commands and returns the time taken in ms */
+    double drainCommands();
+
+    /** Creates the VR skybox (and image-based lighting) from skyboxSource */
+    void createSkybox();
+
+    /** Writes the frame timing histograms to the telemetry file */
+    void dumpTelemetry();
+
+    /** Adds an LOD entry for every actor in the scene that does not have one yet */
+    void buildLODLevels();
+
+    /** Runs the actor's pipeline and queues the job that makes its coarser LOD levels */
+    LODActor buildLODActor( vtkActor* a );
+
+    /** Simplifies a part for each coarser LOD level, runs on a job system worker
+      * @param input is the part's geometry, it is only read
+      * @param count is the number of coarser levels
+      * @param token stops the work early when cancelled
+      * @return the levels, each with roughly a quarter of the triangles of the one before */
+    static std::vector<vtkSmartPointer<vtkPolyData>> makeLODLevels( vtkSmartPointer<vtkDataSet> input, int count, CancellationToken token );
+
+    /** Makes mappers for the LOD levels whose jobs have finished
+      * @return true if any actor got new levels */
+    bool collectLODLevels();
+
+    /** Uploads all geometry and compiles shaders before the first visible frame */
+    void warmUp();
+
+    /** Registers the controller actions for the section controls, must be called
+      * before the interactor is initialised */
+    void addSectionActions();
+
+    /** Applies the controller input to the clip plane and part scale
+      * @param dt is the time since the last call in seconds */
+    void updateSection( double dt );
+
+    /** Adds the clip plane to every LOD mapper while clipping is on, removes it otherwise */
+    void attachClipPlanes();
+
+    /** Sets the clip plane and scale transform of one actor */
+    void applySection( LODActor& entry );
+
+    /** Applies the LOD level chosen by the governor */
+    void applyGovernorDecision();
+
+    /** Time taken by the last frame, from the compositor if it reports it */
+    double measureFrameTime(double wallMs);
+
+
     /* Standard VTK VR Classes */
     vtkSmartPointer<vtkOpenVRRenderWindow>              window;
     vtkSmartPointer<vtkOpenVRRenderWindowInteractor>    interactor;
@@ -88,6 +226,10 @@ private:
     /** List of actors that will need to be added to the VR scene */
     vtkSmartPointer<vtkActorCollection>                 actors;
 
+    /** Where each actor is put in the VR scene, the first transform of its user transform.
+      * The part's own transform from the tree follows, so it moves along the part's axes */
+    QHash<vtkActor*, vtkSmartPointer<vtkTransform>>     placements;
+
     /** A timer to help implement animations and visual effects */
     std::chrono::time_point<std::chrono::steady_clock>  t_last;
 
@@ -102,6 +244,39 @@ private:
     double rotateX;         /*< Degrees to rotate around X axis (per time-step) */
     double rotateY;         /*< Degrees to rotate around Y axis (per time-step) */
     double rotateZ;         /*< Degrees to rotate around Z axis (per time-step) */
+
+    /** Commands issued by the GUI thread waiting to be applied (protected by mutex) */
+    QQueue<QPair<int, double>>                          commands;
+
+    /** Actors given to addActor() waiting for the ADD_ACTORS command (protected by mutex) */
+    QQueue<vtkSmartPointer<vtkActor>>                   pendingActors;
+
+    /** Frame-time governor */
+    VRFrameGovernor                                     governor;
+
+    /** Frame timing histograms, the file they are written to and the render timer */
+    VRFrameTelemetry                                    telemetry;
+    QString                                             telemetryFile;
+    std::chrono::time_point<std::chrono::steady_clock>  t_render;
+    double                                              renderMs;
+
+    std::vector<LODActor>                               lodActors;
+    bool                                                lodDirty;
+
+    /** Cancels the LOD jobs still queued when the actors are removed or VR stops */
+    CancellationToken                                   lodJobs;
+
+    /** Skybox given by the GUI, and the VR thread's own texture and actor made from it */
+    vtkSmartPointer<vtkTexture>                         skyboxSource;
+    vtkSmartPointer<vtkFloatArray>                      skyboxHarmonics;
+    vtkSmartPointer<vtkSkybox>                          skybox;
+
+    /** Section controls driven by the controllers (only used by the VR thread) */
+    double                                              sectionInput[2];    /*!< Latest trackpad/joystick position */
+    int                                                 clipAxis;           /*!< 0 = X, 1 = Y, 2 = Z, -1 = off */
+    double                                              clipFraction;       /*!< Lower clip position, 0 - 1 of the part size */
+    double                                              partScale;          /*!< Scale of each part about its centre, 0.1 - 1 */
+    bool                                                sectionUsed;        /*!< Controls changed since VR started */
 };
 
 
@@ -0,0 +1,124 @@
+/**     @file batch_main.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Entry point of WS6Batch, the headless batch processing tool. It needs no
+  *     display, so it can run on render servers to make thumbnails and reports or
+  *     to measure the throughput of the load and clip pipeline.
+  *
+  *     Example:
+  *         WS6Batch --clip 0,100,0,50,0,100 --size 90 --output scene.png --width 7680 --height 4320 parts.txt
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "BatchRunner.h"
+#include "Trace.h"
+#include "Log.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include <algorithm>
+#include <cstdio>
+
+/*!
+ * \brief parseNumbers
+ * Splits a comma separated list of numbers
+ * \param text the list
+ * \param count the number of values expected
+ * \param values receives the values
+ * \return true if there were exactly count numbers
+ */
+static bool parseNumbers(const QString& text, int count, float* values) {
+    QStringList parts = text.split(',');
+    if (parts.size() != count)
+        return false;
+    for (int i = 0; i < count; i++) {
+        bool ok = false;
+        values[i] = parts[i].trimmed().toFloat(&ok);
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("WS6Batch");
+    Log::configure();
+    Log::installCrashHandler(QString());
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Loads STL files, clips them and renders them offscreen to PNG, printing the time taken by each stage.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "STL files or .txt assembly manifests.", "files...");
+
+    QCommandLineOption clipOption("clip", "Clip percentages xmin,xmax,ymin,ymax,zmin,zmax (0 - 100).", "planes");
+    QCommandLineOption sizeOption("size", "Shrink size in percent (0 - 100).", "size");
+    QCommandLineOption colourOption("colour", "Part colour r,g,b (0 - 255).", "rgb");
+    QCommandLineOption outputOption({ "o", "output" }, "PNG of all the parts together.", "file");
+    QCommandLineOption thumbnailOption("thumbnails", "Directory to write one PNG per part to.", "dir");
+    QCommandLineOption widthOption("width", "Image width in pixels.", "pixels", "1920");
+    QCommandLineOption heightOption("height", "Image height in pixels.", "pixels", "1080");
+    QCommandLineOption traceOption("trace", "Write a Chrome trace of the run to this .json file.", "file");
+    QCommandLineOption repeatOption("repeat", "Run the clip stages this many times per part and report the mean.", "count", "1");
+    parser.addOptions({ clipOption, sizeOption, colourOption, outputOption, thumbnailOption,
+                        widthOption, heightOption, repeatOption, traceOption });
+    parser.process(app);
+
+    BatchRunner::Options options;
+    options.inputs = parser.positionalArguments();
+    options.output = parser.value(outputOption);
+    options.thumbnailDir = parser.value(thumbnailOption);
+    options.width = parser.value(widthOption).toInt();
+    options.height = parser.value(heightOption).toInt();
+    options.repeat = parser.value(repeatOption).toInt();
+
+    if (parser.isSet(clipOption)) {
+        float planes[6];
+        if (!parseNumbers(parser.value(clipOption), 6, planes)) {
+            fprintf(stderr, "--clip needs six comma separated numbers\n");
+            return 1;
+        }
+        options.clip.minX = planes[0];
+        options.clip.maxX = planes[1];
+        options.clip.minY = planes[2];
+        options.clip.maxY = planes[3];
+        options.clip.minZ = planes[4];
+        options.clip.maxZ = planes[5];
+    }
+    if (parser.isSet(sizeOption))
+        options.clip.size = parser.value(sizeOption).toFloat();
+    if (parser.isSet(colourOption)) {
+        float rgb[3];
+        if (!parseNumbers(parser.value(colourOption), 3, rgb)) {
+            fprintf(stderr, "--colour needs three comma separated numbers\n");
+            return 1;
+        }
+        for (int i = 0; i < 3; i++)
+            options.colour[i] = (unsigned char)std::clamp(rgb[i], 0.f, 255.f);
+    }
+
+    if (options.inputs.isEmpty() || options.width <= 0 || options.height <= 0) {
+        parser.showHelp(1);
+    }
+
+    if (parser.isSet(traceOption)) {
+        Trace::setThreadName("Main");
+        Trace::start();
+    }
+
+    BatchRunner runner(options);
+    int result = runner.run();
+
+    if (parser.isSet(traceOption)) {
+        Trace::stop();
+        if (!Trace::write(parser.value(traceOption))) {
+            fprintf(stderr, "Cannot write %s\n", qPrintable(parser.value(traceOption)));
+            return result == 0 ? 1 : result;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,83 @@
+/**     @file generate_main.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Entry point of WS6Generate, which writes procedural STL assemblies to stress
+  *     test the viewer, WS6Batch and the benchmarks. The assembly.txt it writes can be
+  *     opened from the viewer's Open File dialog or passed to WS6Batch.
+  *
+  *     Example, 100k parts and about 1B triangles from 10k unique files:
+  *         WS6Generate --parts 100000 --triangles 10000 --duplication 0.9 big
+  *
+  *     Jay Chauhan, Charles Egan and Jacob Moore 2025
+  */
+
+#include "AssemblyGenerator.h"
+#include "JobSystem.h"
+#include "Log.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+
+#include <cstdio>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("WS6Generate");
+    Log::configure();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes a procedural STL assembly and an assembly.txt manifest to load it with.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("directory", "Directory to write the assembly to.");
+
+    QCommandLineOption partsOption("parts", "Number of parts.", "count", "100");
+    QCommandLineOption trianglesOption("triangles", "Average triangles per part, sizes vary by +-50%.", "count", "10000");
+    QCommandLineOption duplicationOption("duplication", "Fraction of parts that reuse another part's STL file (0 - 1).", "ratio", "0");
+    QCommandLineOption branchingOption("branching", "Most parts or sub-assemblies in one sub-assembly.", "count", "10");
+    QCommandLineOption shapesOption("shapes", "Comma separated shapes to use: sphere, block, shell.", "list", "sphere,block,shell");
+    QCommandLineOption asciiOption("ascii", "Write ASCII STL instead of binary.");
+    QCommandLineOption seedOption("seed", "Random seed, the same seed writes the same assembly.", "seed", "1");
+    parser.addOptions({ partsOption, trianglesOption, duplicationOption, branchingOption, shapesOption,
+                        asciiOption, seedOption });
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    AssemblyGenerator::Options options;
+    options.outputDir = parser.positionalArguments().first();
+    options.parts = parser.value(partsOption).toLongLong();
+    options.triangles = parser.value(trianglesOption).toLongLong();
+    options.duplication = parser.value(duplicationOption).toDouble();
+    options.branching = parser.value(branchingOption).toInt();
+    options.binary = !parser.isSet(asciiOption);
+    options.seed = parser.value(seedOption).toUInt();
+
+    options.shapes.clear();
+    for (const QString& name : parser.value(shapesOption).split(',', Qt::SkipEmptyParts)) {
+        AssemblyGenerator::Shape shape;
+        if (!AssemblyGenerator::parseShape(name, &shape)) {
+            fprintf(stderr, "Unknown shape %s\n", qPrintable(name));
+            return 1;
+        }
+        options.shapes.append(shape);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    AssemblyGenerator::Result result = AssemblyGenerator::generate(options, &error);
+    if (result.manifest.isEmpty()) {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+
+    printf("%s: parts=%lld files=%lld triangles=%lld (%lld unique) workers=%d time=%.1fs\n",
+           qPrintable(result.manifest), (long long)options.parts, (long long)result.uniqueFiles,
+           (long long)result.totalTriangles, (long long)result.uniqueTriangles,
+           JobSystem::instance().threadCount(), timer.elapsed() / 1000.0);
+    return 0;
+}
@@ -1,10 +1,78 @@
 #include "mainwindow.h"
+#include "Log.h"
+#include "Session.h"
+#include "Trace.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+
+#include <cstdio>
+
+/*!
+ * \brief replay runs a recorded session on a hidden window and prints the time of every operation.
+ * Rendering is skipped as the window never gets a GL context, so the times are the tree, pipeline and
+ * job system work. Use -platform offscreen where there is no display.
+ */
+static int replay(QCommandLineParser& parser, const QCommandLineOption& replayOption,
+                  const QCommandLineOption& vrOption, const QCommandLineOption& reportOption,
+                  const QCommandLineOption& traceOption)
+{
+    QString error;
+    QList<SessionLog::Entry> entries = SessionLog::read(parser.value(replayOption), &error);
+    if (!error.isEmpty())
+    {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+
+    MainWindow w;
+    SessionReplay::Options options;
+    options.vr = parser.isSet(vrOption);
+    if (parser.isSet(traceOption))
+        Trace::start();
+    QList<SessionReplay::Result> results = SessionReplay::run(w, entries, options);
+    if (parser.isSet(traceOption))
+    {
+        Trace::stop();
+        Trace::write(parser.value(traceOption));
+    }
+
+    for (const SessionReplay::Result& result : results)
+    {
+        if (result.skipped)
+            printf("%4d %-8s skipped  %s\n", result.line, qPrintable(result.operation), qPrintable(result.arguments));
+        else
+            printf("%4d %-8s %8.1fms %s\n", result.line, qPrintable(result.operation), result.ms, qPrintable(result.arguments));
+    }
+    printf("%s", qPrintable(SessionReplay::summary(results)));
+
+    if (parser.isSet(reportOption) && !SessionReplay::writeReport(results, parser.value(reportOption)))
+    {
+        fprintf(stderr, "Could not write %s\n", qPrintable(parser.value(reportOption)));
+        return 1;
+    }
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    Log::configure();
+    Log::installCrashHandler(QDir::temp().filePath("WS6_crash.log"));
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption replayOption("replay", "Replay a saved session without showing the window and time each operation.", "session");
+    QCommandLineOption vrOption("replay-vr", "Also run the VR start and stop operations of the session.");
+    QCommandLineOption reportOption("report", "Write the replay times to a CSV file.", "csv");
+    QCommandLineOption traceOption("trace", "Record a Chrome trace of the replay.", "json");
+    parser.addOptions({ replayOption, vrOption, reportOption, traceOption });
+    parser.process(a);
+
+    if (parser.isSet(replayOption))
+        return replay(parser, replayOption, vrOption, reportOption, traceOption);
+
     MainWindow w;
     w.show();
     return a.exec();
@@ -9,10 +9,25 @@
 #include "VRRenderThread.h"
 #include "./ui_mainwindow.h"
 #include "optiondialog.h"
+#include "SkyboxLoader.h"
+#include "EnvironmentLoader.h"
+#include "JobSystem.h"
+#include "MeshCache.h"
+#include "ClipCache.h"
+#include "AssemblyManifest.h"
+#include "Trace.h"
+#include "Log.h"
+#include "Session.h"
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QDir>
 #include <QDialog>
+#include <QInputDialog>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QTreeWidgetItemIterator>
+#include <limits>
+#include <algorithm>
 #include <vtkrenderWindow.h>
 #include <vtkCylinderSource.h>
 #include <vtkPolyDataMapper.h>
@@ -20,12 +35,13 @@
 #include <vtkCamera.h>
 #include <vtkProperty.h>
 #include <vtkLight.h>
-#include <vtkImageClip.h>
-#include <vtkpngreader.h>
-#include <vtkImageAlgorithm.h>
-#include <vtkImageData.h>
+#include <vtkTexture.h>
+#include <vtkOpenGLRenderer.h>
 #include <vtkSkybox.h>
 #include <vtkSmartPointer.h>
+#include <vtkNew.h>
+#include <vtkMatrix4x4.h>
+#include <vtkTransform.h>
 #include <QStandardItemModel>
 
 /*!
@@ -44,6 +60,8 @@ MainWindow::MainWindow(QWidget *parent)
     // Setup ui with widgets and VTK renderer
     ui->setupUi(this);
     ui->treeView->addAction(ui->actionItems_Options);
+    ui->treeView->addAction(ui->actionFull_Resolution);
+    Trace::setThreadName("GUI");
     renderWindow = vtkSmartPointer<vtkGenericOpenGLRenderWindow>::New();
     ui->widget->setRenderWindow(renderWindow);
 
@@ -72,31 +90,19 @@ MainWindow::MainWindow(QWidget *parent)
     renderer->GetActiveCamera()->Elevation(30);
     renderer->ResetCameraClippingRange();
 
-    /*
-
-    vtkSmartPointer<vtkLight>
-
+    // A white key light that follows the camera, used alongside image-based lighting while an HDR
+    // environment is loaded. It is only added to the renderer by applyEnvironment(): any light added turns
+    // off VTK's automatic headlight, which lights the scene at full intensity the rest of the time.
     light = vtkSmartPointer<vtkLight>::New();
-    
-    //vtkSmartPointer<vtkLight> light = vtkSmartPointer<vtkLight>::New();
-    light->SetLightTypeToSceneLight();
-    light->SetPosition(3,3,3);
-    light->SetPositional(true);
-    light->SetConeAngle(10);
-    light->SetFocalPoint(0,0,0);
-    light->SetAmbientColor(0.8,0.8,0.8);
-    light->SetDiffuseColor(0.5,0.6,0.5);
-    light->SetSpecularColor(0.7,0.7,0.7);
-    light->SetIntensity(0.9);
-    // Adds a light and sets its properties
+    light->SetLightTypeToCameraLight();
+    light->SetPositional(false);
+    light->SetPosition(1, 1, 1);
     light->SetFocalPoint(0, 0, 0);
     light->SetDiffuseColor(1, 1, 1);
     light->SetAmbientColor(1, 1, 1);
     light->SetSpecularColor(1, 1, 1);
     light->SetIntensity(0.5);
 
-    */
-
     // Connecting Slots and signals of UI elements
     connect( ui->pushButton, &QPushButton::released, this, &MainWindow::handleButton );
     connect( ui->treeView, &QTreeView::clicked, this, &MainWindow::handleTreeClick );
@@ -105,6 +111,7 @@ MainWindow::MainWindow(QWidget *parent)
     // Instatiate a tree view with a part list
     this->partList = new ModelPartList("PartsList");
     ui->treeView->setModel(this->partList);
+    on_actionPart_Costs_toggled(false);
     ModelPart *rootItem = this->partList->getRootItem();
 
     // Instantiates the root item "Model" into the part list and tree view
@@ -116,13 +123,10 @@ MainWindow::MainWindow(QWidget *parent)
 
 
 
-    ModelPart* childItem = new ModelPart({ name,visible,R,G,B, 0., 100., 0., 100., 0., 100., 100 });
+    ModelPart* childItem = partList->createPart({ name,visible,R,G,B, 0., 100., 0., 100., 0., 100., 100 });
     childItem->empty_node = true;
     rootItem->appendChild(childItem);
 
-    //renderer->AddLight(light);
-    //adds the light to the renderer
-
     /* Test to check if tree view works
     for (int i =0; i<3; i++){
         QString name = QString("TopLevel %1").arg(1);
@@ -153,11 +157,29 @@ MainWindow::MainWindow(QWidget *parent)
 
     VRthread = NULL;
 
+    // Check the geometry memory budget every few seconds, hidden parts go idle without any event to hook
+    QTimer* memoryTimer = new QTimer(this);
+    connect(memoryTimer, &QTimer::timeout, this, &MainWindow::enforceMemoryBudget);
+    memoryTimer->start(5000);
+
+    overlay.setRenderWindow(renderWindow);
+    overlay.setMemoryManager(&memoryManager);
+    overlay.addTo(renderer);
+
 }
 
 // Destructor
 MainWindow::~MainWindow()
 {
+    // Stop the loads and clips still running, the job system drops the queued ones when the program exits
+    for (const CancellationToken& token : partJobs)
+        token.cancel();
+    for (const CancellationToken& token : clipJobs)
+        token.cancel();
+
+    // Keep the last session so a slow operation can be replayed even if it was not saved
+    if (!session.entries().isEmpty())
+        session.write(QDir::temp().filePath("WS6_session.txt"));
     delete ui;
 }
 
@@ -187,18 +209,48 @@ void MainWindow::handleTreeClick(){
  */
 
 void MainWindow::handleButton(){
-    QMessageBox msgBox;
+    QModelIndex index = ui->treeView->currentIndex();
+    ModelPart* selectedPart = static_cast<ModelPart*>(index.internalPointer());
+    startVR(selectedPart ? selectedPart : partList->getRootItem());
+}
 
-    //msgBox.exec();
+/*!
+ * \brief MainWindow::startVR
+ * Starts the VR renderer showing a part and the parts below it, if it is not already running
+ * \param part the part to show
+ */
+void MainWindow::startVR(ModelPart* part)
+{
+    session.record("vr-start", { partPath(part) });
 
     if (VR_ON==0)
     {
         VR_ON=1;
         VRthread = new VRRenderThread();
-        QModelIndex index = ui->treeView->currentIndex();
+        VRthread->setTelemetryFile(QDir::current().filePath("vr_telemetry"));
+
+        // Report the warm-up in the status bar, the thread signals are queued to the GUI thread
+        connect(VRthread, &VRRenderThread::warmUpProgress, this, [this](int percent, const QString& stage) {
+            emit statusUpdateMessage(QString("VR Renderer starting: %1% - %2").arg(percent).arg(stage), 0);
+        });
+        connect(VRthread, &VRRenderThread::warmUpFinished, this, [this](double seconds) {
+            emit statusUpdateMessage(QString("VR Renderer Started (warm-up %1s)").arg(seconds, 0, 'f', 1), 0);
+        });
+        connect(VRthread, &VRRenderThread::sectionChanged, this, &MainWindow::applyVRSection);
+        connect(VRthread, &VRRenderThread::telemetryWritten, this, [this](bool ok, const QString& baseName, const QString& governor) {
+            emit statusUpdateMessage(ok ? QString("VR frame stats written to %1.json/.csv (%2)").arg(baseName, governor)
+                                        : QString("VR frame stats could not be written to %1").arg(baseName), 0);
+        });
+        VRthread->issueCommand(VRRenderThread::SET_FRAME_BUDGET, vrFrameBudgetMs);
+
+        QModelIndex index = partList->indexOf(part);
+        VRroot = index;
+        vrParts.clear();
         AddVRActors(index);
+        if (currentSkybox)
+            VRthread->setSkybox(currentSkybox, currentEnvironment.sphericalHarmonics);
         VRthread->start();
-        emit statusUpdateMessage(QString("VR Renderer Started"),0);
+        emit statusUpdateMessage(QString("VR Renderer starting"),0);
     }
     else
     {
@@ -209,6 +261,17 @@ void MainWindow::handleButton(){
 
 void MainWindow::on_pushButton_3_clicked()
 {
+    stopVR();
+}
+
+/*!
+ * \brief MainWindow::stopVR
+ * Asks the VR renderer to close, if it is running
+ */
+void MainWindow::stopVR()
+{
+    session.record("vr-stop");
+
     if(VR_ON==1)
     {
         VRthread->issueCommand(0, 0);
@@ -223,29 +286,184 @@ void MainWindow::on_pushButton_3_clicked()
 }
 
 
-void MainWindow::on_pushButton_2_clicked()
+/*!
+ * \brief MainWindow::on_actionDump_VR_Stats_triggered
+ * Asks the running VR thread to write out its frame timing histograms
+ */
+void MainWindow::on_actionDump_VR_Stats_triggered()
 {
-    QModelIndex index = ui->treeView->currentIndex();
-    emit statusUpdateMessage(QString("Deleting Item"),0);
+    if (VR_ON == 1 && VRthread)
+    {
+        // The VR thread writes the files, telemetryWritten() reports the result
+        VRthread->issueCommand(VRRenderThread::DUMP_STATS, 0);
+        emit statusUpdateMessage(QString("Writing VR frame stats"), 0);
+    }
+    else
+    {
+        emit statusUpdateMessage(QString("No VR Renderer running"), 0);
+    }
+}
 
-    if (index.isValid())
+
+/*!
+ * \brief MainWindow::on_actionVR_Frame_Budget_triggered
+ * Asks for the frame time the VR renderer's LOD governor aims for, a running VR renderer is sent it straight away
+ */
+void MainWindow::on_actionVR_Frame_Budget_triggered()
+{
+    bool ok = false;
+    double budgetMs = QInputDialog::getDouble(this, tr("VR Frame Budget"),
+        tr("Frame time to aim for in ms (11.1 is 90Hz, 8.3 is 120Hz):"), vrFrameBudgetMs, 4., 50., 1, &ok);
+    if (!ok)
+        return;
+
+    vrFrameBudgetMs = budgetMs;
+    if (VR_ON == 1 && VRthread)
+        VRthread->issueCommand(VRRenderThread::SET_FRAME_BUDGET, vrFrameBudgetMs);
+    emit statusUpdateMessage(QString("VR frame budget %1ms").arg(vrFrameBudgetMs, 0, 'f', 1), 0);
+}
+
+
+/*!
+ * \brief MainWindow::on_actionMemory_Budget_triggered
+ * Reports the resident and evicted geometry and asks for a new budget in MB
+ */
+void MainWindow::on_actionMemory_Budget_triggered()
+{
+    bool ok = false;
+    int budgetMB = QInputDialog::getInt(this, tr("Memory Budget"),
+        memoryManager.usageString() + tr("\n\nGeometry memory budget (MB):"),
+        (int)(memoryManager.budget() / (1024 * 1024)), 64, 1024 * 1024, 256, &ok);
+    if (ok)
     {
-        ModelPart* selectedPart = static_cast<ModelPart*>(index.internalPointer());
+        memoryManager.setBudget((qint64)budgetMB * 1024 * 1024);
+        enforceMemoryBudget();
+    }
+    emit statusUpdateMessage(memoryManager.usageString(), 0);
+}
 
-        if (selectedPart && selectedPart != partList->getRootItem()) 
-        {
-            QModelIndex parentIndex = index.parent();
-            int row = selectedPart->row();
-            partList->removeRow(row, parentIndex);
-        }
+/*!
+ * \brief MainWindow::on_actionRecord_Trace_toggled
+ * The trace is written as Chrome trace JSON, open it in chrome://tracing or ui.perfetto.dev
+ * \param checked true when recording is started
+ */
+void MainWindow::on_actionRecord_Trace_toggled(bool checked)
+{
+    if (checked)
+    {
+        Trace::start();
+        emit statusUpdateMessage(QString("Recording trace"), 0);
+        return;
+    }
 
-        if (selectedPart->getActor()) {
-            renderer->RemoveActor(selectedPart->getActor());
-        }
+    Trace::stop();
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Trace"), "trace.json", tr("Chrome Trace (*.json)"));
+    if (fileName.isEmpty())
+        return;
+    if (Trace::write(fileName))
+        emit statusUpdateMessage(QString("Trace written to %1").arg(fileName), 0);
+    else
+        emit statusUpdateMessage(QString("Could not write %1").arg(fileName), 0);
+}
 
-        updateRender();
+/*!
+ * \brief MainWindow::on_actionSave_Log_triggered
+ * The log keeps the last Log::Slots messages of every level that is enabled
+ */
+void MainWindow::on_actionSave_Log_triggered()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Log"), "WS6.log", tr("Log Files (*.log *.txt)"));
+    if (fileName.isEmpty())
+        return;
+    if (Log::dump(fileName))
+        emit statusUpdateMessage(QString("Log written to %1").arg(fileName), 0);
+    else
+        emit statusUpdateMessage(QString("Could not write %1").arg(fileName), 0);
+}
+
+/*!
+ * \brief MainWindow::on_actionPerformance_Overlay_toggled
+ * The overlay only measures frames while it is shown, so it costs nothing when hidden
+ * \param checked true when the overlay is shown
+ */
+void MainWindow::on_actionPerformance_Overlay_toggled(bool checked)
+{
+    overlay.setEnabled(checked);
+    renderWindow->Render();
+}
+
+/*!
+ * \brief MainWindow::on_actionPart_Costs_toggled
+ * The columns are always in the model, this only hides them in the tree view
+ * \param checked true when the columns are shown
+ */
+void MainWindow::on_actionPart_Costs_toggled(bool checked)
+{
+    for (int column = ModelPartList::TrianglesColumn; column <= ModelPartList::PipelineTimeColumn; column++)
+        ui->treeView->setColumnHidden(column, !checked);
+}
+
+void MainWindow::on_actionOptimise_Meshes_toggled(bool checked)
+{
+    importSettings.optimize = checked;
+    ui->actionSort_For_Overdraw->setEnabled(checked);
+}
+
+void MainWindow::on_actionSort_For_Overdraw_toggled(bool checked)
+{
+    importSettings.sortForOverdraw = checked;
+}
+
+void MainWindow::on_actionClear_Mesh_Cache_triggered()
+{
+    qint64 removed = MeshCache::clear();
+    emit statusUpdateMessage(QString("Mesh cache cleared, %1MB freed").arg(removed / (1024.0 * 1024.0), 0, 'f', 1), 0);
+}
+
+void MainWindow::on_actionFull_Resolution_triggered()
+{
+    ModelPart* selectedPart = static_cast<ModelPart*>(ui->treeView->currentIndex().internalPointer());
+    if (selectedPart)
+        loadFullResolution(selectedPart);
+}
+
+/*!
+ * \brief MainWindow::loadFullResolution
+ * The parts keep showing their simplified geometry until the full resolution is loaded. The new
+ * geometry gets a new id, so clip results cached for the simplified one are not reused.
+ * \param part the part
+ */
+void MainWindow::loadFullResolution(ModelPart* part)
+{
+    session.record("full-resolution", { partPath(part) });
+    int count = 0;
+    QList<ModelPart*> pending = { part };
+    while (!pending.isEmpty())
+    {
+        ModelPart* next = pending.takeLast();
+        for (int row = 0; row < next->childCount(); row++)
+            pending.append(next->child(row));
+        if (!next->isDecimated() || next->getSourceFile().isEmpty())
+            continue;
+
+        ModelPart::ImportSettings settings = next->importSettings();
+        settings.decimation = MeshDecimator::Target();
+        next->setImportSettings(settings);
+        loadPart(next, next->getSourceFile());
+        count++;
+    }
+    emit statusUpdateMessage(QString("Loading %1 parts at full resolution").arg(count), 0);
+}
 
 
+void MainWindow::on_pushButton_2_clicked()
+{
+    QModelIndex index = ui->treeView->currentIndex();
+    emit statusUpdateMessage(QString("Deleting Item"),0);
+
+    if (index.isValid())
+    {
+        deletePart(static_cast<ModelPart*>(index.internalPointer()));
     }
 
     else 
@@ -254,6 +472,30 @@ void MainWindow::on_pushButton_2_clicked()
     }
 }
 
+/*!
+ * \brief MainWindow::deletePart
+ * Removes a part and everything below it from the tree and the renderer
+ * \param part the part, nothing is done for the root item
+ */
+void MainWindow::deletePart(ModelPart* part)
+{
+    if (!part || part == partList->getRootItem())
+        return;
+    session.record("delete", { partPath(part) });
+
+    // Stop any loads or clips still running for the part, their results must not reach a deleted part
+    releasePart(part);
+    if (part->getActor()) {
+        renderer->RemoveActor(part->getActor());
+    }
+
+    QModelIndex parentIndex = partList->indexOf(part->parentItem());
+    int row = part->row();
+    partList->removeRow(row, parentIndex);
+
+    updateRender();
+}
+
 
 /*!
  * \brief MainWindow::on_actionItems_Options_triggered
@@ -272,95 +514,37 @@ void MainWindow::on_actionItems_Options_triggered()
     if (!selectedPart) return;
 
     // Get data from selected part
-    // Get data from selected part
-
-    qDebug()<<"getting data from selected part";
-    QString name = selectedPart->data(0).toString();
-    bool vis = selectedPart->data(1).toBool();
-    qint64 R = selectedPart->getColourR();
-    qint64 G = selectedPart->getColourG();
-    qint64 B = selectedPart->getColourB();
-    float xmin = selectedPart->getMinX();
-    float xmax = selectedPart->getMaxX();
-    float ymin = selectedPart->getMinY();
-    float ymax = selectedPart->getMaxY();
-    float zmin = selectedPart->getMinZ();
-    float zmax = selectedPart->getMaxZ();
-    float size = selectedPart->getSize();
-    qDebug()<<"got data from selected part";
-
+    ModelPart::Options options = selectedPart->options();
+    LOG_DEBUG(UI) << "Options for" << options.name << "size" << options.clip.size;
 
     // Set accessed data in dialog box
-    qDebug()<<"setting data in dialog box";
-    dialog.setVisibility(vis);
-    dialog.set_name(name);
-    dialog.set_R(R);
-    dialog.set_G(G);
-    dialog.set_B(B); 
-    dialog.set_B(B);
-    dialog.set_Clip(xmin, xmax, ymin, ymax, zmin, zmax);
-    dialog.setSize(size);
-    qDebug()<<"3 Set size: "<<size;
-    qDebug()<<"set data in dialog box";
+    dialog.setVisibility(options.visible);
+    dialog.set_name(options.name);
+    dialog.set_R(options.r);
+    dialog.set_G(options.g);
+    dialog.set_B(options.b);
+    dialog.set_Clip(options.clip.minX, options.clip.maxX, options.clip.minY, options.clip.maxY, options.clip.minZ, options.clip.maxZ);
+    dialog.setSize(options.clip.size);
+    dialog.set_Transform(options.translation, options.rotation, options.scale);
 
     // if the accept button is pressed
     if (dialog.exec() == QDialog::Accepted){
         emit statusUpdateMessage(QString("Dialog accepted"), 0);
 
-
         // use get functions in dialog to get users choice
-        qDebug()<<"getting user choice";
-        bool n_vis = dialog.getVisibility();
-        QString n_name = dialog.get_name();
-        double n_R = dialog.get_R();
-        double n_G = dialog.get_G();
-        double n_B = dialog.get_B();    
-        float minX = dialog.get_MinX();
-        float maxX = dialog.get_MaxX();
-        float minY = dialog.get_MinY();
-        float maxY = dialog.get_MaxY();
-        float minZ = dialog.get_MinZ();
-        float maxZ = dialog.get_MaxZ();
-        float sizeF = dialog.getSize();
-        qDebug()<<"4 got size: "<<sizeF;
-        qDebug()<<"got user choice";
-
-
-        // update the selected item
-        qDebug()<<"updating selected item";
-        selectedPart->setVisible(n_vis);
-        selectedPart->setName(n_name);
-        selectedPart->setColour(n_R,n_G,n_B);
-        selectedPart->setClip(minX,maxX,minY,maxY,minZ,maxZ);
-        selectedPart->setSize(sizeF);
-
-        if (selectedPart->empty_node==false)
-        {
-            selectedPart->setMapper(selectedPart->applyClip());
-            selectedPart->getMapper()->Update();
-            selectedPart->getMapper()->Modified();
-            selectedPart->getActor()->Modified();
-        }
-
-        qDebug()<<"5 set size: "<<sizeF;
-        qDebug()<<"updated selected item";
-
-
-        // if an actor for the model part exists
-        if (selectedPart->getActor()) {
-            // Set the colour and visibility
-            selectedPart->getActor()->GetProperty()->SetColor(n_R / 255, n_G / 255, n_B / 255);
-            selectedPart->getActor()->SetVisibility(n_vis);
-
-
-            qDebug()<<"Set colour and visibility";
-        }
-
-
-        //update child items
-        updateChildren(selectedPart, vis, n_R, n_G, n_B, minX, maxX, minY, maxY, minZ, maxZ, sizeF);
-
-
+        options.visible = dialog.getVisibility();
+        options.name = dialog.get_name();
+        options.r = dialog.get_R();
+        options.g = dialog.get_G();
+        options.b = dialog.get_B();
+        options.clip = { dialog.get_MinX(), dialog.get_MaxX(), dialog.get_MinY(), dialog.get_MaxY(),
+                         dialog.get_MinZ(), dialog.get_MaxZ(), dialog.getSize() };
+        dialog.get_Translation(options.translation);
+        dialog.get_Rotation(options.rotation);
+        options.scale = dialog.get_Scale();
+        LOG_DEBUG(UI) << "Options accepted for" << options.name << "size" << options.clip.size;
+
+        setPartOptions(selectedPart, options);
     }
 
     // if cancel button is clicked
@@ -368,6 +552,32 @@ void MainWindow::on_actionItems_Options_triggered()
         emit statusUpdateMessage(QString("Dialog rejected"),0);
     }
 }
+/*!
+ * \brief MainWindow::setPartOptions
+ * Applies options edited in the dialog to a part and copies them down to its children
+ * \param part the part
+ * \param options the new options
+ */
+void MainWindow::setPartOptions(ModelPart* part, const ModelPart::Options& options)
+{
+    QStringList arguments = SessionLog::optionArguments(options);
+    arguments.prepend(partPath(part));
+    session.record("options", arguments);
+
+    // the transform is relative to the parent, so children follow it through their world matrices
+    // and it is not copied down to them by updateChildren
+    part->setOptions(options);
+
+    // only the parts of the pipeline affected by what changed are re-run
+    applyPartChanges(part, JobPriority::High);
+
+    //update child items
+    const ModelPart::ClipSettings& clip = options.clip;
+    updateChildren(part, options.visible, options.r, options.g, options.b,
+                   clip.minX, clip.maxX, clip.minY, clip.maxY, clip.minZ, clip.maxZ, clip.size);
+    renderWindow->Render();
+}
+
 /*!
  * \brief MainWindow::on_actionOpen_File_triggered
  * When the open file action is triggered, a message is emitted to the staus bar and dialog box is opened to choose a STL or txt file
@@ -381,10 +591,81 @@ void MainWindow::on_actionOpen_File_triggered(){
         this,
         tr("Open Files"),
         "C:\\",
-        tr("STL Files(*.stl);;Text Files(*.txt);;PNG Files(*.png)"));
+        tr("STL Files(*.stl);;Text Files(*.txt);;PNG Files(*.png);;HDR Environments(*.hdr *.exr)"));
 
     //emit statusUpdateMessage(QString(fileName),0);
 
+    MeshDecimator::Target decimation;
+    if (!chooseDecimation(fileNames, &decimation))
+        return;
+
+    QModelIndex index = ui->treeView->currentIndex();
+    ModelPart* selectedPart = static_cast<ModelPart*>(index.internalPointer());
+    if (!selectedPart)//nothing selected, e.g. the selected item was deleted
+        selectedPart = partList->getRootItem();
+    openFiles(fileNames, selectedPart, decimation);
+}
+
+/*!
+ * \brief MainWindow::chooseDecimation
+ * The triangle count is estimated from the file size as if it were binary STL, 50 bytes a triangle, so
+ * ASCII files are overestimated and may be asked about sooner
+ */
+bool MainWindow::chooseDecimation(const QStringList& fileNames, MeshDecimator::Target* target)
+{
+    qint64 largest = 0;
+    for (const QString& fileName : fileNames)
+    {
+        QFileInfo fileInfo(fileName);
+        if (fileInfo.suffix().toLower() == "stl")
+            largest = qMax(largest, (fileInfo.size() - 84) / 50);
+    }
+    if (largest < decimationPromptTriangles)
+        return true;
+
+    QStringList choices = { tr("Full resolution"), tr("Triangle budget per part"), tr("Error bound") };
+    bool ok = false;
+    QString choice = QInputDialog::getItem(this, tr("Simplify Parts"),
+        tr("The largest part has about %1 million triangles. Open the parts at:").arg(largest / 1e6, 0, 'f', 1),
+        choices, 0, false, &ok);
+    if (!ok)
+        return false;
+
+    if (choice == choices[1])
+    {
+        target->triangles = QInputDialog::getInt(this, tr("Simplify Parts"), tr("Triangles per part:"),
+            1000000, 1000, std::numeric_limits<int>::max(), 100000, &ok);
+    }
+    else if (choice == choices[2])
+    {
+        target->error = QInputDialog::getDouble(this, tr("Simplify Parts"),
+            tr("Furthest the surface may move, as a % of the part's size:"), 0.1, 0.001, 10., 3, &ok) / 100.;
+    }
+    return ok;
+}
+
+/*!
+ * \brief MainWindow::openFiles
+ * Opens STL files and assemblies into the tree below a part, and skyboxes and environments
+ * \param fileNames the files
+ * \param parent the part new parts are added to
+ */
+void MainWindow::openFiles(const QStringList& fileNames, ModelPart* parent, const MeshDecimator::Target& decimation)
+{
+    if (fileNames.isEmpty())
+        return;
+    QStringList arguments = fileNames;
+    if (decimation.isSet())
+    {
+        arguments.prepend(QString::number(decimation.error, 'g', 9));
+        arguments.prepend(QString::number(decimation.triangles));
+    }
+    arguments.prepend(partPath(parent));
+    session.record(decimation.isSet() ? "open-simplified" : "open", arguments);
+
+    ModelPart::ImportSettings settings = importSettings;
+    settings.decimation = decimation;
+
     // for all items selected in the file directory
     for (int i=0;i<fileNames.size();i++)
     {
@@ -392,90 +673,589 @@ void MainWindow::on_actionOpen_File_triggered(){
         QString fileExtension = fileInfo.suffix().toLower();
         if (fileExtension == "png")//checks if the loaded file is a png (skybox)
         {
-            // Load the (single cross-layout) PNG
-            vtkNew<vtkPNGReader> reader;
-            reader->SetFileName(fileNames[i].toStdString().c_str());
-            reader->Update();
-
-            // Verify dimensions - makes sure the image is the right resolution
-            int* extent = reader->GetOutput()->GetExtent();
-            int width = extent[1] - extent[0] + 1;
-            int height = extent[3] - extent[2] + 1;
-            if (width != 1024 || height != 768)
+            loadSkybox(fileNames[i]);
+        }
+
+        else if (fileExtension == "hdr" || fileExtension == "exr")//equirectangular HDR environment (skybox and lighting)
+        {
+            loadEnvironment(fileNames[i]);
+        }
+
+        else if (fileExtension == "txt")//assembly manifest, a tree of parts
+        {
+            loadAssembly(fileNames[i], parent, settings);
+        }
+
+        else{
+            // Create a new model part item with default perameters and append it to the tree
+            QString visible("true");
+            qint64 R(255);
+            qint64 G(0);
+            qint64 B(90);
+
+            ModelPart* childItem = partList->createPart({ fileNames[i].section('/', -1),visible,R,G,B, 0.,100.,0.,100.,0.,100.,100});
+            parent->appendChild(childItem);
+            childItem->setImportSettings(settings);
+
+            // Load the selected STL file in the background, it is added to the renderer when ready
+            loadPart(childItem, fileNames[i]);
+            emit statusUpdateMessage(QString("Loading STL File "+QString(fileNames[i])), 0);
+        }
+    }
+}
+
+/*!
+ * \brief MainWindow::partPath
+ * \param part the part
+ * \return the rows from the root down to the part separated by /, empty for the root item
+ */
+QString MainWindow::partPath(ModelPart* part)
+{
+    QStringList rows;
+    for (; part && part != partList->getRootItem(); part = part->parentItem())
+        rows.prepend(QString::number(part->row()));
+    return rows.join('/');
+}
+
+/*!
+ * \brief MainWindow::partAt
+ * \param path a path made by partPath()
+ * \return the part, null if the path does not name one
+ */
+ModelPart* MainWindow::partAt(const QString& path)
+{
+    ModelPart* part = partList->getRootItem();
+    for (const QString& row : path.split('/', Qt::SkipEmptyParts))
+    {
+        bool ok = false;
+        part = part->child(row.toInt(&ok));
+        if (!ok || !part)
+            return nullptr;
+    }
+    return part;
+}
+
+SessionLog& MainWindow::sessionLog()
+{
+    return session;
+}
+
+/*!
+ * \brief MainWindow::on_actionSave_Session_triggered
+ * The session can be replayed with WS6 --replay to time every operation again
+ */
+void MainWindow::on_actionSave_Session_triggered()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Session"), "session.txt", tr("Sessions (*.txt)"));
+    if (fileName.isEmpty())
+        return;
+    if (session.write(fileName))
+        emit statusUpdateMessage(QString("Session of %1 operations written to %2").arg(session.entries().size()).arg(fileName), 0);
+    else
+        emit statusUpdateMessage(QString("Could not write %1").arg(fileName), 0);
+}
+
+/*!
+ * \brief MainWindow::loadAssembly
+ * Builds the whole tree from the manifest in one bulk import, so the tree view is reset once rather than
+ * told about every row, then starts loading every part. Groups become empty nodes.
+ * \param fileName the manifest
+ * \param parent the part the top level items are added to
+ */
+void MainWindow::loadAssembly(const QString& fileName, ModelPart* parent, const ModelPart::ImportSettings& settings)
+{
+    QString error;
+    QList<AssemblyManifest::Node> nodes = AssemblyManifest::read(fileName, &error);
+    if (!error.isEmpty())
+    {
+        emit statusUpdateMessage(error, 0);
+        return;
+    }
+
+    QList<QPair<ModelPart*, QString>> loads;
+    QList<ModelPart*> parents = { parent };
+    partList->beginBulkImport(nodes.size());
+    for (const AssemblyManifest::Node& node : nodes)
+    {
+        ModelPart* part = partList->createPart({ node.name, QString("true"), 255, 0, 90, 0., 100., 0., 100., 0., 100., 100 });
+        parents.resize(node.depth + 1);
+        parents[node.depth]->appendChild(part);
+        parents.append(part);
+
+        if (node.file.isEmpty())
+            part->empty_node = true;
+        else
+        {
+            part->setImportSettings(settings);
+            loads.append({ part, node.file });
+        }
+    }
+    partList->endBulkImport();
+
+    for (const auto& load : loads)
+        loadPart(load.first, load.second);
+    emit statusUpdateMessage(QString("Loading %1 parts from %2").arg(loads.size()).arg(fileName), 0);
+}
+
+/*!
+ * \brief MainWindow::loadPart
+ * Reads the STL file and runs the clip filters in one job, the part gets its geometry and is
+ * added to the renderer in the continuation on the GUI thread.
+ * \param part the part to load into
+ * \param fileName the STL file
+ */
+void MainWindow::loadPart(ModelPart* part, const QString& fileName)
+{
+    struct Loaded {
+        vtkSmartPointer<vtkPolyData> source;
+        std::shared_ptr<const CompactMesh> compact;
+        vtkSmartPointer<vtkPolyData> clipStage;
+        vtkSmartPointer<vtkDataSet> clipped;
+        double readMs = 0.;
+        double pipelineMs = 0.;
+    };
+
+    ModelPart::ClipSettings settings = part->clipSettings();
+    quint64 generation = part->beginClip();
+    bool reload = part->isEvicted();
+    qint64 threshold = compactThreshold;
+    ModelPart::ImportSettings import = part->importSettings();
+    JobSystem::instance().run(
+        [fileName, settings, threshold, import](const CancellationToken& token) {
+            Loaded loaded;
+            QElapsedTimer timer;
+            timer.start();
+            loaded.source = ModelPart::readSTLFile(fileName, import);
+            loaded.readMs = timer.nsecsElapsed() / 1e6;
+
+            // Very large parts are kept compact, the full polydata is only used for the first clip
+            if (loaded.source->GetNumberOfPolys() > threshold)
+                loaded.compact = CompactMesh::encode(loaded.source);
+
+            if (!token.isCancelled())
+                loaded.clipStage = ModelPart::computeClipPlanes(loaded.source, settings, &token);
+            if (loaded.clipStage)
+                loaded.clipped = ModelPart::computeShrink(loaded.clipStage, settings.size, &token);
+            if (loaded.compact && loaded.clipped)
             {
-                emit statusUpdateMessage(QString("Error: PNG must be 1024x768 for 4x3 cross layout"), 0);
-                continue;
+                CompactMesh::use32BitCells(loaded.clipStage);
+                CompactMesh::use32BitCells(loaded.clipped);
             }
-
-            // Face size is 256x256 (1024/4 = 256, 768/3 = 256)
-            int faceSize = 256;
-
-            // Define the six faces' extents in the cross layout - "refolds" the faces on the skybox
-            int faceExtents[6][4] = {
-                {512, 768, 256, 512},  // Right (Positive X)
-                {0, 256, 256, 512},    // Left (Negative X)
-                {256, 512, 0, 256},    // Top (Positive Y)
-                {256, 512, 512, 768},  // Bottom (Negative Y)
-                {256, 512, 256, 512},  // Front (Positive Z)
-                {768, 1024, 256, 512}  // Back (Negative Z)
-            };
-
-            // Create cubemap texture
-            vtkNew<vtkTexture> texture;
-            texture->CubeMapOn();
-            for (int j = 0; j < 6; j++)
+            loaded.pipelineMs = timer.nsecsElapsed() / 1e6;
+            return loaded;
+        },
+        this,
+        [this, part, fileName, generation, settings, reload](Loaded loaded) {
+            reloading.remove(part);
+            overlay.recordLoad(loaded.readMs);
+            part->setSource(loaded.source, fileName, loaded.compact);
+            memoryManager.add(part);
+            // The clip settings were changed while loading, the initial clip is stale so clip again
+            if (part->isCurrentClip(generation))
+            {
+                part->setClipResult(loaded.clipped, loaded.clipStage);
+                ClipCache::instance().insert(part->geometryId(), settings, loaded.clipped);
+            }
+            else
+                submitClip(part, JobPriority::High);
+            part->setPipelineTime(loaded.pipelineMs);
+            partList->costChanged(part);
+            // A part reloaded after eviction is already in the scene, it only needs drawing again
+            if (reload)
             {
-                vtkNew<vtkImageClip> clip;
-                clip->SetInputConnection(reader->GetOutputPort());
-                clip->SetOutputWholeExtent(faceExtents[j][0], faceExtents[j][1] - 1, faceExtents[j][2], faceExtents[j][3] - 1, 0, 0);
-                clip->ClipDataOn();
-                clip->Update();
+                renderWindow->Render();
+                return;
+            }
+
+            renderer->AddActor(part->getActor());
+            emit statusUpdateMessage(QString("Loaded STL File "+fileName), 0);
+
+            // Update the render to show new model, once for all the parts that finish together
+            scheduleRender();
+            enforceMemoryBudget();
+        },
+        partToken(part), JobPriority::Normal);
+}
+
+/*!
+ * \brief MainWindow::applyPartChanges
+ * Applies the properties changed on a part since they were last applied. Colour and visibility are set on the
+ * actor straight away, a size change only re-runs the shrink stage and only a clip change re-runs the clip planes.
+ * \param part the part
+ * \param priority the priority of any pipeline job
+ */
+void MainWindow::applyPartChanges(ModelPart* part, JobPriority priority)
+{
+    unsigned dirty = part->dirtyFlags();
+    if (dirty == 0)
+        return;
+
+    if (part->empty_node)
+    {
+        // A group has no geometry of its own, but its transform still moves everything below it
+        if (dirty & ModelPart::DirtyTransform)
+            part->updateWorldMatrix();
+        part->clearDirty(dirty);
+        return;
+    }
 
-                texture->SetInputConnection(j, clip->GetOutputPort());
+    if (dirty & ModelPart::DirtyVisibility)
+        ensureResident(part);
+    dirty = part->applyProperties();
+
+    if (dirty & (ModelPart::DirtyClip | ModelPart::DirtySize))
+    {
+        // The stored clip stage can only be reused if no clip is still on its way to replace it
+        bool shrinkOnly = !(dirty & ModelPart::DirtyClip) && part->getClipStage() && !clipJobs.contains(part);
+        submitClip(part, priority, shrinkOnly);
+    }
+    part->clearDirty(ModelPart::DirtyClip | ModelPart::DirtySize);
+}
+
+/*!
+ * \brief MainWindow::submitClip
+ * Copies the clip settings of the part and runs the clip filters on a worker, the result is swapped into
+ * the part's mapper on the GUI thread.
+ * Each call starts a new clip generation for the part. The previous clip's token is cancelled, which makes
+ * its filters abort at their next progress report, and a result that still arrives from an older generation
+ * is dropped, so only the latest settings ever reach the mapper.
+ * Results are kept in the ClipCache, going back to settings used before swaps the cached result in without
+ * running the filters.
+ * \param part the part to clip
+ * \param priority the job priority
+ * \param shrinkOnly re-run only the shrink stage on the part's stored clip stage output
+ */
+void MainWindow::submitClip(ModelPart* part, JobPriority priority, bool shrinkOnly)
+{
+    quint64 generation = part->beginClip();
+
+    auto previous = clipJobs.find(part);
+    if (previous != clipJobs.end())
+    {
+        previous.value().cancel();
+        clipJobs.erase(previous);
+    }
+
+    // Still loading, the load notices the new generation and clips again when it finishes
+    if (!part->hasGeometry())
+        return;
+
+    memoryManager.touch(part);
+    ModelPart::ClipSettings settings = part->clipSettings();
+    vtkSmartPointer<vtkDataSet> cached = ClipCache::instance().find(part->geometryId(), settings);
+    if (cached)
+    {
+        // At full size the result is the clip stage output itself
+        part->setClipResult(cached, settings.size >= 100.f ? vtkPolyData::SafeDownCast(cached) : nullptr);
+        partList->costChanged(part);
+        renderWindow->Render();
+        return;
+    }
+
+    struct Clipped {
+        vtkSmartPointer<vtkPolyData> clipStage;
+        vtkSmartPointer<vtkDataSet> result;
+        double ms = 0.;
+    };
+
+    // Compact parts are decoded on the worker and their result is stored with 32-bit cells
+    std::shared_ptr<const CompactMesh> compact = part->getCompactSource();
+    vtkSmartPointer<vtkPolyData> clipStage = shrinkOnly ? part->getClipStage() : nullptr;
+    vtkSmartPointer<vtkPolyData> source = (compact || clipStage) ? nullptr : part->getSource();
+    CancellationToken partAlive = partToken(part);
+    // Only a queued job has a token, a part without one may reuse its clip stage
+    CancellationToken clipToken;
+    clipJobs.insert(part, clipToken);
+    JobSystem::instance().run(
+        [source, compact, clipStage, settings, partAlive](const CancellationToken& token) {
+            Clipped clipped;
+            if (partAlive.isCancelled())
+                return clipped;
+            QElapsedTimer timer;
+            timer.start();
+            clipped.clipStage = clipStage;
+            if (!clipped.clipStage)
+                clipped.clipStage = ModelPart::computeClipPlanes(compact ? compact->decode() : source, settings, &token);
+            if (clipped.clipStage)
+                clipped.result = ModelPart::computeShrink(clipped.clipStage, settings.size, &token);
+            // The stored clip stage may be on screen, only convert what was made here
+            if (compact && clipped.result)
+            {
+                if (!clipStage)
+                    CompactMesh::use32BitCells(clipped.clipStage);
+                if (clipped.result.Get() != clipped.clipStage.Get())
+                    CompactMesh::use32BitCells(clipped.result);
             }
-            texture->InterpolateOn();
-            texture->MipmapOn();
+            clipped.ms = timer.nsecsElapsed() / 1e6;
+            return clipped;
+        },
+        this,
+        [this, part, generation, partAlive, settings](Clipped clipped) {
+            if (partAlive.isCancelled())
+                return;
+            if (!part->isCurrentClip(generation))
+                return;
+            clipJobs.remove(part);
+            if (!clipped.result)
+                return;
+            overlay.recordClip(clipped.ms);
+            ClipCache::instance().insert(part->geometryId(), settings, clipped.result);
+            part->setClipResult(clipped.result, clipped.clipStage);
+            part->setPipelineTime(clipped.ms);
+            partList->costChanged(part);
+            renderWindow->Render();
+        },
+        clipToken, priority);
+}
 
-            // Create and configure skybox
-            vtkSmartPointer <vtkSkybox>skyboxActor = vtkSmartPointer<vtkSkybox>::New(); // Store in member variable
-            skyboxActor->SetTexture(texture);
-            skyboxActor->SetProjection(vtkSkybox::Cube);
+/*!
+ * \brief MainWindow::ensureResident
+ * Starts a background reload of a part whose geometry was evicted, if the part is now visible.
+ * Nothing is done if a reload is already in flight.
+ * \param part the part
+ */
+void MainWindow::ensureResident(ModelPart* part)
+{
+    memoryManager.touch(part);
+    if (!part->isEvicted() || !part->visible() || reloading.contains(part))
+        return;
 
-            // Add skybox to renderer
-            renderer->AddActor(skyboxActor);
-            renderer->SetBackground(0.0, 0.0, 0.0);
-            renderer->GetActiveCamera()->SetClippingRange(1.0, 10000.0);
-            renderer->ResetCameraClippingRange();
+    reloading.insert(part);
+    loadPart(part, part->getSourceFile());
+}
 
-            emit statusUpdateMessage(QString("Skybox added using cross-layout PNG: ") + fileNames[i], 0);
+/*!
+ * \brief MainWindow::enforceMemoryBudget
+ * Evicts hidden parts through the memory manager. Their clip jobs are cancelled and their cached clip
+ * results dropped, so nothing is left holding the geometry.
+ */
+void MainWindow::enforceMemoryBudget()
+{
+    QList<ModelPart*> evicted = memoryManager.enforce();
+    for (ModelPart* part : evicted)
+    {
+        auto clip = clipJobs.find(part);
+        if (clip != clipJobs.end())
+        {
+            clip.value().cancel();
+            clipJobs.erase(clip);
         }
+        ClipCache::instance().removeGeometry(part->geometryId());
+        partList->costChanged(part);
+    }
 
+    if (!evicted.isEmpty())
+        emit statusUpdateMessage(memoryManager.usageString(), 0);
+}
 
+CancellationToken MainWindow::partToken(ModelPart* part)
+{
+    auto it = partJobs.find(part);
+    if (it == partJobs.end())
+        it = partJobs.insert(part, CancellationToken());
+    return it.value();
+}
 
-        else{
-            // Create a new model part item with default perameters and append it to the tree
-            QString visible("true");
-            qint64 R(255);
-            qint64 G(0);
-            qint64 B(90);
+/*!
+ * \brief MainWindow::releasePart
+ * Cancels the jobs of a part and all of its children, forgets their tokens and drops their cached clip results
+ * \param part the part about to be deleted
+ */
+void MainWindow::releasePart(ModelPart* part)
+{
+    auto it = partJobs.find(part);
+    if (it != partJobs.end())
+    {
+        it.value().cancel();
+        partJobs.erase(it);
+    }
+    auto clip = clipJobs.find(part);
+    if (clip != clipJobs.end())
+    {
+        clip.value().cancel();
+        clipJobs.erase(clip);
+    }
+    if (part->geometryId() != 0)
+        ClipCache::instance().removeGeometry(part->geometryId());
+    memoryManager.remove(part);
+    reloading.remove(part);
+    vrParts.remove(part);
+    for (int i = 0; i < part->childCount(); i++)
+        releasePart(part->child(i));
+}
+/*!
+ * \brief MainWindow::loadSkybox
+ * Loads a cross-layout PNG as the skybox. A skybox that has been loaded before is taken from the cache and
+ * applied straight away, otherwise the PNG is decoded and sliced into a cubemap on the job system and applied
+ * when it is ready.
+ * \param fileName the PNG file
+ */
+void MainWindow::loadSkybox(const QString& fileName)
+{
+    QString key = SkyboxLoader::cacheKeyFor(fileName);
+    if (skyboxCache.contains(key))
+    {
+        applySkybox(skyboxCache.value(key));
+        emit statusUpdateMessage(QString("Skybox applied from cache: ") + fileName, 0);
+        return;
+    }
 
-            ModelPart* childItem = new ModelPart({ fileNames[i].section('/', -1),visible,R,G,B, 0.,100.,0.,100.,0.,100.,100});
-            QModelIndex index = ui->treeView->currentIndex();
-            ModelPart* selectedPart = static_cast<ModelPart*>(index.internalPointer());
-            selectedPart->appendChild(childItem);
+    std::shared_ptr<SkyboxLoader> loader = std::make_shared<SkyboxLoader>(fileName);
+    JobSystem::instance().run(
+        [loader](const CancellationToken&) { return loader->load(); },
+        this,
+        [this, loader](bool loaded) {
+            if (loaded)
+            {
+                skyboxCache.insert(loader->cacheKey(), loader->texture());
+                applySkybox(loader->texture());
+                emit statusUpdateMessage(QString("Skybox added using cross-layout PNG: ") + loader->fileName(), 0);
+            }
+            else
+            {
+                emit statusUpdateMessage(QString("Error: ") + loader->errorString(), 0);
+            }
+        },
+        CancellationToken(), JobPriority::Low);
+    emit statusUpdateMessage(QString("Loading skybox: ") + fileName, 0);
+}
 
-            // Load the selected STL file and update status bar
-            childItem->loadSTL(fileNames[i]);
-            emit statusUpdateMessage(QString("Loaded STL File"+QString(fileNames[i])), 0);
+/*!
+ * \brief MainWindow::applySkybox
+ * Shows a cubemap texture as the skybox
+ * \param texture the cubemap
+ */
+void MainWindow::applySkybox(vtkSmartPointer<vtkTexture> texture)
+{
+    if (!skyboxActor)
+    {
+        skyboxActor = vtkSmartPointer<vtkSkybox>::New();
+        skyboxActor->SetProjection(vtkSkybox::Cube);
+    }
+    skyboxActor->SetProjection(vtkSkybox::Cube);
+    skyboxActor->SetTexture(texture);
+
+    // A cross-layout PNG is only a backdrop, it does not light the scene
+    renderer->UseImageBasedLightingOff();
+    renderer->SetEnvironmentTexture(nullptr);
+    currentEnvironment = Environment();
+    currentEnvironmentKey.clear();
+    currentSkybox = texture;
+
+    // With no lights left the renderer makes its headlight again, and the parts go back to their normal shading
+    renderer->RemoveLight(light);
+    updateShading(partList->getRootItem());
+
+    // Add skybox to renderer
+    renderer->RemoveActor(skyboxActor);
+    renderer->AddActor(skyboxActor);
+    renderer->SetBackground(0.0, 0.0, 0.0);
+    renderer->GetActiveCamera()->SetClippingRange(1.0, 10000.0);
+    renderer->ResetCameraClippingRange();
+    renderWindow->Render();
+}
+
+/*!
+ * \brief MainWindow::loadEnvironment
+ * Loads an equirectangular HDR environment as the skybox and for image-based lighting. The environment
+ * being shown is applied straight away, otherwise an EnvironmentLoader reads it on the job system. A
+ * decoded environment is about 100MB, so only the current one is kept in memory; one opened before is
+ * read back from the loader's disk cache instead of being decoded again.
+ * \param fileName the .hdr or .exr file
+ */
+void MainWindow::loadEnvironment(const QString& fileName)
+{
+    QString key = SkyboxLoader::cacheKeyFor(fileName);
+    if (currentEnvironment.texture && key == currentEnvironmentKey)
+    {
+        applyEnvironment(currentEnvironment);
+        emit statusUpdateMessage(QString("Environment already loaded: ") + fileName, 0);
+        return;
+    }
 
-            // Add the loaded STL file to the renderer
-            renderer->AddActor(childItem->getActor());
+    std::shared_ptr<EnvironmentLoader> loader = std::make_shared<EnvironmentLoader>(fileName);
+    JobSystem::instance().run(
+        [loader](const CancellationToken&) { return loader->load(); },
+        this,
+        [this, loader, key](bool loaded) {
+            if (loaded)
+            {
+                applyEnvironment(loader->environment());
+                currentEnvironmentKey = key;
+                emit statusUpdateMessage(QString("Environment added%1: ").arg(loader->fromCache() ? " (from disk cache)" : "") + loader->fileName(), 0);
+            }
+            else
+            {
+                emit statusUpdateMessage(QString("Error: ") + loader->errorString(), 0);
+            }
+        },
+        CancellationToken(), JobPriority::Low);
+    emit statusUpdateMessage(QString("Loading environment: ") + fileName, 0);
+}
 
-            // Update the render to show new model
-            updateRender();
-        }
+/*!
+ * \brief MainWindow::applyEnvironment
+ * Shows the environment as a spherical skybox and uses it for PBR image-based lighting. The irradiance was
+ * precomputed by the loader, the specular prefilter is done once by VTK on the GPU.
+ * \param environment the loaded environment
+ */
+void MainWindow::applyEnvironment(const Environment& environment)
+{
+    if (!skyboxActor)
+        skyboxActor = vtkSmartPointer<vtkSkybox>::New();
+    skyboxActor->SetProjection(vtkSkybox::Sphere);
+    skyboxActor->SetTexture(environment.texture);
+
+    renderer->UseImageBasedLightingOn();
+    renderer->SetEnvironmentTexture(environment.texture);
+    vtkOpenGLRenderer* glRenderer = vtkOpenGLRenderer::SafeDownCast(renderer);
+    if (glRenderer && environment.sphericalHarmonics)
+    {
+        glRenderer->UseSphericalHarmonicsOn();
+        glRenderer->SetSphericalHarmonics(environment.sphericalHarmonics);
     }
+    currentEnvironment = environment;
+    currentSkybox = environment.texture;
+
+    // The key light replaces the automatic headlight (and any light made before it)
+    renderer->RemoveAllLights();
+    renderer->AddLight(light);
+
+    renderer->RemoveActor(skyboxActor);
+    renderer->AddActor(skyboxActor);
+    updateRender();
+}
+
+/*!
+ * \brief MainWindow::applyShading
+ * Parts need PBR shading to pick up image-based lighting, without an environment they use the Gouraud
+ * shading they are made with
+ * \param part the part, nothing is done if it has no actor
+ */
+void MainWindow::applyShading(ModelPart* part)
+{
+    if (!part->getActor())
+        return;
+    vtkProperty* property = part->getActor()->GetProperty();
+    if (currentEnvironment.texture)
+        property->SetInterpolationToPBR();
+    else if (property->GetInterpolation() == VTK_PBR)
+        property->SetInterpolationToGouraud();
 }
+
+/*!
+ * \brief MainWindow::updateShading
+ * Sets the shading of a part and every part below it for the current environment
+ * \param part the part to start from
+ */
+void MainWindow::updateShading(ModelPart* part)
+{
+    if (part != partList->getRootItem())
+        applyShading(part);
+    for (int i = 0; i < part->childCount(); i++)
+        updateShading(part->child(i));
+}
+
 /*!
  * \brief MainWindow::UpdateRenderFromTree
  * Updates the renderer when a valid index is passed by adding the actor for the selected part
@@ -490,6 +1270,7 @@ void MainWindow::UpdateRenderFromTree(const QModelIndex& index) {
 
         if (selectedPart->getActor())
         {
+            applyShading(selectedPart);
             renderer->AddActor(selectedPart->getActor());
         }
 
@@ -525,6 +1306,7 @@ void MainWindow::UpdateRenderFromTree(const QModelIndex& index) {
  */
 void MainWindow::updateChildren(ModelPart* parent, bool vis, double r, double g, double b, float xmin, float xmax, float ymin, float ymax, float zmin, float zmax, float size)
 {
+    TRACE_ZONE("updateChildren");
     // for the number of children of the passed item
     for (int i = 0; i < parent->childCount(); i++)
     {
@@ -535,41 +1317,142 @@ void MainWindow::updateChildren(ModelPart* parent, bool vis, double r, double g,
         childPart->setClip(xmin, xmax, ymin, ymax, zmin, zmax);
         childPart->setSize(size);
 
+        // colour and visibility go straight to the actor, clip and size changes are re-run on the job system
+        applyPartChanges(childPart, JobPriority::Normal);
 
+        // Recursivly run this function for any children of this model part
+        updateChildren(childPart, vis, r, g, b, xmin, xmax, ymin, ymax, zmin, zmax, size);
+    }
+}
 
-        // if the model part has an actor set colour and visibility
-        if (childPart->getActor())
+/*!
+ * \brief MainWindow::applyVRSection
+ * Called when the VR renderer closes after the controller section controls were used. The clip plane and scale
+ * are copied onto the parts that were shown in VR so the desktop view matches the headset.
+ * If the user turned clipping off in VR the parts' clip values are left as they were.
+ * \param axis the clip axis or -1
+ * \param clipPercent the lower clip position along the axis, as a percentage of the geometry each VR actor showed
+ * \param sizePercent the scale of each part about its centre
+ */
+void MainWindow::applyVRSection(int axis, double clipPercent, double sizePercent)
+{
+    ModelPart* part = VRroot.isValid() ? static_cast<ModelPart*>(VRroot.internalPointer()) : partList->getRootItem();
+
+    vtkNew<vtkMatrix4x4> parentWorld;
+    if (part->parentItem() && part->parentItem()->getWorldMatrix())
+        parentWorld->DeepCopy(part->parentItem()->getWorldMatrix());
+    applySectionToPart(part, axis, clipPercent, sizePercent / 100., parentWorld, parentWorld, 1.);
+    updateRender();
+
+    emit statusUpdateMessage(QString("Applied VR section: scale %1%").arg(sizePercent, 0, 'f', 0), 0);
+}
+
+/*!
+ * \brief MainWindow::applySectionToPart
+ * VR scales each of its actors about the centre of the geometry it shows, after the part's own transform. The
+ * same change is made to the part's transform: its world matrix W becomes W * T(c) * S * T(-c), and the local
+ * transform is worked out from the parent's new world matrix so the children are not scaled twice. The
+ * rotation is kept, only the translation and scale change.
+ */
+void MainWindow::applySectionToPart(ModelPart* part, int axis, float clipPercent, double scale,
+                                    vtkMatrix4x4* parentWorld, vtkMatrix4x4* parentNewWorld, double parentScale)
+{
+    vtkNew<vtkMatrix4x4> world;
+    vtkNew<vtkMatrix4x4> newWorld;
+    world->DeepCopy(parentWorld);
+    newWorld->DeepCopy(parentNewWorld);
+    double ownScale = 1.;
+
+    if (part != partList->getRootItem())
+    {
+        // VR measures the clip against the geometry its actor showed, which may already be clipped, but the
+        // part's clip values are percentages of the unclipped source, so the plane's position is converted
+        vtkDataSet* shown = part->getMapper() ? part->getMapper()->GetInput() : nullptr;
+        float clip[6] = { part->getMinX(), part->getMaxX(), part->getMinY(), part->getMaxY(), part->getMinZ(), part->getMaxZ() };
+        if (axis >= 0 && axis < 3)
         {
-            childPart->getActor()->GetProperty()->SetColor(r / 255, g / 255, b / 255);
-            childPart->getActor()->SetVisibility(vis);
-            // Update size (scale) and clipping if not an empty node
-            if (childPart->empty_node == false)
+            clip[2 * axis] = clipPercent;
+            vtkSmartPointer<vtkPolyData> source = vrParts.contains(part) && shown ? part->getSource() : nullptr;
+            if (source)
             {
-                // Set the actor's scale to reflect the size
-                childPart->getActor()->SetScale(size/100);
-                // Reapply clipping filter and update the mapper
-                childPart->setMapper(childPart->applyClip());
-                childPart->getMapper()->Update();
-                childPart->getMapper()->Modified();
-                childPart->getActor()->Modified();
+                double shownBounds[6], sourceBounds[6];
+                shown->GetBounds(shownBounds);
+                source->GetBounds(sourceBounds);
+                double position = shownBounds[2 * axis] + clipPercent / 100. * (shownBounds[2 * axis + 1] - shownBounds[2 * axis]);
+                double extent = sourceBounds[2 * axis + 1] - sourceBounds[2 * axis];
+                if (extent > 0.)
+                    clip[2 * axis] = (float)std::clamp(100. * (position - sourceBounds[2 * axis]) / extent, 0., 100.);
             }
         }
-
-        // Recursivly run this function for any children of this model part
-        updateChildren(childPart, vis, r, g, b, xmin, xmax, ymin, ymax, zmin, zmax, size);
+        part->setClip(clip[0], clip[1], clip[2], clip[3], clip[4], clip[5]);
+
+        double translation[3], rotation[3], partScale;
+        part->getTransform(translation, rotation, partScale);
+        vtkNew<vtkMatrix4x4> local;
+        ModelPart::composeTransform(translation, rotation, partScale, local);
+        vtkMatrix4x4::Multiply4x4(parentWorld, local, world);
+
+        // Only the parts that had a VR actor were scaled, the centre is that of the geometry the actor showed
+        vtkNew<vtkTransform> section;
+        section->SetMatrix(world);
+        if (vrParts.contains(part) && shown && scale != 1.)
+        {
+            double bounds[6], centre[3];
+            shown->GetBounds(bounds);
+            for (int i = 0; i < 3; i++)
+                centre[i] = 0.5 * (bounds[2 * i] + bounds[2 * i + 1]);
+            section->Translate(centre);
+            section->Scale(scale, scale, scale);
+            section->Translate(-centre[0], -centre[1], -centre[2]);
+            ownScale = scale;
+        }
+        newWorld->DeepCopy(section->GetMatrix());
+
+        // New local transform = parent's new world inverse * new world
+        vtkNew<vtkMatrix4x4> parentInverse;
+        vtkMatrix4x4::Invert(parentNewWorld, parentInverse);
+        vtkMatrix4x4::Multiply4x4(parentInverse, newWorld, local);
+        for (int i = 0; i < 3; i++)
+            translation[i] = local->GetElement(i, 3);
+        part->setTransform(translation, rotation, partScale * ownScale / parentScale);
+
+        // Re-run the clip pipeline stages affected for parts with geometry, the transform goes straight to the actor
+        applyPartChanges(part, JobPriority::Normal);
     }
+
+    for (int i = 0; i < part->childCount(); i++)
+        applySectionToPart(part->child(i), axis, clipPercent, scale, world, newWorld, ownScale);
 }
 
 /*!
  * \brief MainWindow::updateRender
  * Refreshes the renderer so all actors are set to default
  */
+/*!
+ * \brief MainWindow::scheduleRender
+ * Runs updateRender once the events already queued have been handled. When a large assembly is loading
+ * many parts finish at about the same time and each would otherwise rebuild the whole scene.
+ */
+void MainWindow::scheduleRender() {
+    if (renderPending)
+        return;
+    renderPending = true;
+    QTimer::singleShot(0, this, [this]() {
+        renderPending = false;
+        updateRender();
+    });
+}
+
 void MainWindow::updateRender() {
+    TRACE_ZONE("updateRender");
     // Remove all actors from render window
     renderer->RemoveAllViewProps();
 
     //add all actors to render window and render
     UpdateRenderFromTree(partList->index(0, 0, QModelIndex()));
+    if (skyboxActor)
+        renderer->AddActor(skyboxActor);
+    overlay.addTo(renderer);
     renderer->Render();
 
     // Reset the camera
@@ -577,7 +1460,6 @@ void MainWindow::updateRender() {
     renderer->GetActiveCamera()->Azimuth(30);
     renderer->GetActiveCamera()->Elevation(30);
     renderer->ResetCameraClippingRange();
-    //renderer->AddLight(light);
 
 
     if (VR_ON == 1)
@@ -605,9 +1487,12 @@ void MainWindow::AddVRActors(const QModelIndex& index) {
         // Add the actor for the selected part to the vr render thread
         ModelPart* selectedPart = static_cast<ModelPart*>(index.internalPointer());
 
-        if(selectedPart->getActor())
+        // Evicted parts have no geometry to copy, they are hidden anyway. Each part is only sent once, as
+        // updateRender() calls this again every time the scene changes
+        if(selectedPart->getActor() && selectedPart->hasGeometry() && !vrParts.contains(selectedPart))
         {
-            VRthread->addActorOffline(selectedPart->getNewActor());
+            vrParts.insert(selectedPart);
+            VRthread->addActor(selectedPart->getNewActor());
         }
 
     }
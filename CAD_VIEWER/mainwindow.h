@@ -11,6 +11,11 @@
 #include "Modelpart.h"
 #include "ModelpartList.h"
 #include "VRRenderThread.h"
+#include "EnvironmentLoader.h"
+#include "JobSystem.h"
+#include "GeometryMemoryManager.h"
+#include "PerformanceOverlay.h"
+#include "Session.h"
 #include <vtkRenderer.h>
 #include <vtkGenericOpenGLRenderWindow.h>
 #include <vtkLight.h>
@@ -21,6 +26,7 @@
 #include <QThread>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QPersistentModelIndex>
 
 /* Vtk headers */
 #include <vtkActor.h>
@@ -31,6 +37,9 @@
 #include <vtkActorCollection.h>
 #include <vtkCommand.h>
 #include <vtkSkybox.h>
+#include <vtkTexture.h>
+#include <QHash>
+#include <QSet>
 
 
 QT_BEGIN_NAMESPACE
@@ -60,6 +69,11 @@ public:
      * \brief The function updates the vtk to change it to the current values
     */
     void updateRender();
+    /*!
+     * \brief scheduleRender
+     * Calls updateRender once for any number of requests made before control returns to the event loop
+     */
+    void scheduleRender();
     /*!
      * \brief UpdateRenderFromTree
      * Updates the index in the tree
@@ -67,8 +81,89 @@ public:
      */
     void UpdateRenderFromTree(const QModelIndex& index);
 
+    /*!
+     * \brief applyShading
+     * Uses PBR shading for a part while an environment lights the scene, Gouraud otherwise
+     * \param part the part
+     */
+    void applyShading(ModelPart* part);
+
+    /*!
+     * \brief updateShading
+     * Runs applyShading() on a part and every part below it
+     * \param part the part to start from
+     */
+    void updateShading(ModelPart* part);
+
     void AddVRActors( const QModelIndex& index);
 
+    /*!
+     * \brief openFiles
+     * Opens STL files and assembly manifests as parts below a parent, PNG files as a skybox and HDR
+     * files as an environment, without asking for anything
+     * \param fileNames the files
+     * \param parent the part the new parts are added to
+     * \param decimation how far to simplify the new parts, not set for full resolution
+     */
+    void openFiles(const QStringList& fileNames, ModelPart* parent,
+                   const MeshDecimator::Target& decimation = MeshDecimator::Target());
+
+    /*!
+     * \brief loadFullResolution
+     * Reads the simplified parts below and including a part again at full resolution, e.g. before
+     * clipping them precisely
+     * \param part the part
+     */
+    void loadFullResolution(ModelPart* part);
+
+    /*!
+     * \brief setPartOptions
+     * Does what accepting the options dialog does, without the dialog
+     * \param part the part edited
+     * \param options the options to give it
+     */
+    void setPartOptions(ModelPart* part, const ModelPart::Options& options);
+
+    /*!
+     * \brief deletePart
+     * Removes a part and its children
+     * \param part the part to remove
+     */
+    void deletePart(ModelPart* part);
+
+    /*!
+     * \brief startVR
+     * Starts the VR renderer with a part and its children
+     * \param part the part to show in VR
+     */
+    void startVR(ModelPart* part);
+
+    /*!
+     * \brief stopVR
+     * Closes the VR renderer
+     */
+    void stopVR();
+
+    /*!
+     * \brief partPath
+     * \param part the part
+     * \return the path of rows that names the part in a session, see SessionLog
+     */
+    QString partPath(ModelPart* part);
+
+    /*!
+     * \brief partAt
+     * \param path a path returned by partPath()
+     * \return the part, null if there is no part at the path
+     */
+    ModelPart* partAt(const QString& path);
+
+    /*!
+     * \brief sessionLog
+     * \return the operations recorded so far
+     */
+    SessionLog& sessionLog();
+
 
     /*!
      * \brief updateChildren
@@ -81,7 +176,124 @@ public:
      */
     void updateChildren(ModelPart* parent, bool vis, double r, double g, double b, float xmin, float xmax, float ymin, float ymax, float zmin, float zmax, float size);
 
+    /*!
+     * \brief applyVRSection
+     * Copies the clip plane and part scale the user set with the VR controllers onto the parts that were shown in VR
+     * \param axis the clip axis (0 = X, 1 = Y, 2 = Z) or -1 if clipping was off
+     * \param clipPercent the lower clip position along the axis
+     * \param sizePercent the scale of each part about its centre, as a percentage
+     */
+    void applyVRSection(int axis, double clipPercent, double sizePercent);
+
+    /*!
+     * \brief loadSkybox
+     * Loads a 4x3 cross-layout PNG as the skybox, in the background unless it is already cached
+     * \param fileName the PNG file
+     */
+    void loadSkybox(const QString& fileName);
+
+    /*!
+     * \brief applySkybox
+     * Shows a cubemap texture as the skybox
+     * \param texture the cubemap texture
+     */
+    void applySkybox(vtkSmartPointer<vtkTexture> texture);
+
+    /*!
+     * \brief loadEnvironment
+     * Loads an equirectangular .hdr/.exr environment as the skybox and image-based lighting
+     * \param fileName the environment file
+     */
+    void loadEnvironment(const QString& fileName);
+
+    /*!
+     * \brief applyEnvironment
+     * Shows a loaded environment and lights the scene with it
+     * \param environment the environment
+     */
+    void applyEnvironment(const Environment& environment);
+
+    /*!
+     * \brief loadPart
+     * Reads an STL file and clips it on the job system, the part is shown when both are done
+     * \param part the tree item to load into
+     * \param fileName the STL file
+     */
+    void loadPart(ModelPart* part, const QString& fileName);
+
+    /*!
+     * \brief loadAssembly
+     * Adds the tree of parts in an assembly manifest (.txt) below a part and loads their STL files
+     * \param fileName the manifest
+     * \param parent the part the top level items are added to
+     * \param settings how the parts are imported
+     */
+    void loadAssembly(const QString& fileName, ModelPart* parent, const ModelPart::ImportSettings& settings);
+
+    /*!
+     * \brief chooseDecimation
+     * Asks whether to simplify the parts being opened, only if one of the STL files is large
+     * \param fileNames the files being opened
+     * \param target receives the triangle budget or error bound, left unset for full resolution
+     * \return false if the user cancelled the open
+     */
+    bool chooseDecimation(const QStringList& fileNames, MeshDecimator::Target* target);
+
+    /*!
+     * \brief submitClip
+     * Re-runs the clip and shrink filters of a part on the job system with its current settings,
+     * cancelling any clip of the part still in flight
+     * \param part the part to clip
+     * \param priority the job priority, High for the part the user is editing
+     * \param shrinkOnly re-run only the shrink stage on the stored clip stage output
+     */
+    void submitClip(ModelPart* part, JobPriority priority = JobPriority::High, bool shrinkOnly = false);
+
+    /*!
+     * \brief applyPartChanges
+     * Applies the properties changed on a part, re-running only the pipeline stages they affect
+     * \param part the part
+     * \param priority the priority of any pipeline job
+     */
+    void applyPartChanges(ModelPart* part, JobPriority priority);
+
+    /*!
+     * \brief ensureResident
+     * Reloads the geometry of a visible part that was evicted by the memory manager
+     * \param part the part being shown
+     */
+    void ensureResident(ModelPart* part);
+
+    /*!
+     * \brief enforceMemoryBudget
+     * Lets the memory manager evict hidden parts and drops their cached clip results
+     */
+    void enforceMemoryBudget();
+
 private:
+    friend class Benchmarks; /*!< Builds trees in partList and renders the renderer offscreen >*/
+
+    /*!
+     * \brief releasePart
+     * Cancels the jobs of a part and its children and drops their cached results, called before they are deleted
+     */
+    void releasePart(ModelPart* part);
+
+    /*!
+     * \brief partToken
+     * \return the cancellation token shared by all jobs of the part
+     */
+    CancellationToken partToken(ModelPart* part);
+
+    /*!
+     * \brief applySectionToPart
+     * Applies the VR section state to a part and all of its children
+     * \param parentWorld the parent's world matrix before the change
+     * \param parentNewWorld the parent's world matrix after the change
+     * \param parentScale the scale the parent was given about its centre, 1 if it was not in VR
+     */
+    void applySectionToPart(ModelPart* part, int axis, float clipPercent, double scale,
+                            vtkMatrix4x4* parentWorld, vtkMatrix4x4* parentNewWorld, double parentScale);
 
     Ui::MainWindow *ui; /*!< Pointer to the ui>*/
     ModelPartList* partList; /*!< Pointer to the ModelPartList file>*/
@@ -89,7 +301,24 @@ private:
     vtkSmartPointer<vtkGenericOpenGLRenderWindow> renderWindow;/*!< Pointer to the vtk generic open GL renderer window >*/
     bool VR_ON = 0;
     vtkSmartPointer<vtkSkybox> skyboxActor;
+    QHash<QString, vtkSmartPointer<vtkTexture>> skyboxCache; /*!< Finished cubemaps, keyed by SkyboxLoader::cacheKey() >*/
+    Environment currentEnvironment; /*!< Environment lighting the scene, texture is null when there is none >*/
+    QString currentEnvironmentKey; /*!< SkyboxLoader::cacheKeyFor() of currentEnvironment, only the current one is kept in memory >*/
+    vtkSmartPointer<vtkTexture> currentSkybox; /*!< Texture of the skybox being shown, shared with VR >*/
     VRRenderThread* VRthread;
+    QPersistentModelIndex VRroot; /*!< Tree item that was sent to the VR renderer >*/
+    QSet<ModelPart*> vrParts; /*!< Parts whose actors have been sent to the VR renderer since it started >*/
+    double vrFrameBudgetMs = 11.1; /*!< Frame time the VR renderer's governor aims for, sent when VR starts >*/
+    QHash<ModelPart*, CancellationToken> partJobs; /*!< Token for the in-flight jobs of each part, cancelled when the part is deleted >*/
+    GeometryMemoryManager memoryManager; /*!< Evicts the geometry of hidden parts when over budget >*/
+    qint64 compactThreshold = CompactMesh::DefaultTriangleThreshold; /*!< Parts with more triangles than this are kept in compact form >*/
+    ModelPart::ImportSettings importSettings; /*!< How parts opened from now on are prepared >*/
+    qint64 decimationPromptTriangles = 2000000; /*!< Opening an STL file with about this many triangles asks whether to simplify it >*/
+    bool renderPending = false; /*!< A scheduleRender() call is waiting to run >*/
+    SessionLog session; /*!< Every operation the user has made, saved by Save Session and on exit >*/
+    PerformanceOverlay overlay; /*!< Frame, scene and pipeline statistics drawn over the render window >*/
+    QSet<ModelPart*> reloading; /*!< Evicted parts whose geometry is being read back >*/
+    QHash<ModelPart*, CancellationToken> clipJobs; /*!< Token for the latest clip of each part, cancelled when a newer clip supersedes it >*/
 
     vtkSmartPointer<vtkLight> light;
 
@@ -137,6 +366,83 @@ private slots:
 
     void on_pushButton_3_clicked();
 
+    /*!
+     * \brief on_actionDump_VR_Stats_triggered
+     * Asks the VR thread to write its frame timing histograms to file
+     */
+    void on_actionDump_VR_Stats_triggered();
+
+    /*!
+     * \brief on_actionVR_Frame_Budget_triggered
+     * Lets the user change the frame time the VR renderer aims for
+     */
+    void on_actionVR_Frame_Budget_triggered();
+
+    /*!
+     * \brief on_actionMemory_Budget_triggered
+     * Shows the resident and evicted geometry and lets the user change the memory budget
+     */
+    void on_actionMemory_Budget_triggered();
+
+    /*!
+     * \brief on_actionRecord_Trace_toggled
+     * Starts recording a trace, or stops and asks where to save it
+     * \param checked true to start recording
+     */
+    void on_actionRecord_Trace_toggled(bool checked);
+
+    /*!
+     * \brief on_actionSave_Log_triggered
+     * Writes the log ring buffer to a file the user chooses
+     */
+    void on_actionSave_Log_triggered();
+
+    /*!
+     * \brief on_actionPerformance_Overlay_toggled
+     * Shows or hides the performance statistics over the render window
+     * \param checked true to show the overlay
+     */
+    void on_actionPerformance_Overlay_toggled(bool checked);
+
+    /*!
+     * \brief on_actionPart_Costs_toggled
+     * Shows or hides the triangle, memory and pipeline time columns of the tree view
+     * \param checked true to show the columns
+     */
+    void on_actionPart_Costs_toggled(bool checked);
+
+    /*!
+     * \brief on_actionOptimise_Meshes_toggled
+     * Turns the MeshOptimizer stage of the import on or off for the parts opened from now on
+     * \param checked true to optimise
+     */
+    void on_actionOptimise_Meshes_toggled(bool checked);
+
+    /*!
+     * \brief on_actionSort_For_Overdraw_toggled
+     * Turns the overdraw sort of the MeshOptimizer stage on or off for the parts opened from now on
+     * \param checked true to sort
+     */
+    void on_actionSort_For_Overdraw_toggled(bool checked);
+
+    /*!
+     * \brief on_actionClear_Mesh_Cache_triggered
+     * Deletes every mesh in the import cache on disk
+     */
+    void on_actionClear_Mesh_Cache_triggered();
+
+    /*!
+     * \brief on_actionFull_Resolution_triggered
+     * Reads the selected part and the parts below it again without simplifying them
+     */
+    void on_actionFull_Resolution_triggered();
+
+    /*!
+     * \brief on_actionSave_Session_triggered
+     * Writes the operations made so far to a session file that WS6 --replay can run again
+     */
+    void on_actionSave_Session_triggered();
+
 };
 
 
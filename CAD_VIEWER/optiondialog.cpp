@@ -152,7 +152,6 @@ void OptionDialog::set_Clip(float xmin, float xmax, float ymin, float ymax, floa
 }
 void OptionDialog::setSize(float size){
     ui->sizeSlider->setValue(size);
-    qDebug()<<"1 Set size: "<<size;
 }
 float OptionDialog::get_MinX()
 {
@@ -187,6 +186,54 @@ float OptionDialog::get_MaxZ()
 
 float OptionDialog::getSize(){
     float size = ui->sizeSlider->value();
-    qDebug()<<"2 Got size: "<<size;
     return size;
 }
+
+/*!
+ * \brief OptionDialog::set_Transform
+ * Sets the transform of the part relative to its parent in the dialog
+ * \param translation translation along x, y and z
+ * \param rotation rotation about x, y and z in degrees
+ * \param scale uniform scale factor
+ */
+void OptionDialog::set_Transform(const double translation[3], const double rotation[3], double scale)
+{
+    ui->translateX->setValue(translation[0]);
+    ui->translateY->setValue(translation[1]);
+    ui->translateZ->setValue(translation[2]);
+    ui->rotateX->setValue(rotation[0]);
+    ui->rotateY->setValue(rotation[1]);
+    ui->rotateZ->setValue(rotation[2]);
+    ui->scaleBox->setValue(scale);
+}
+
+/*!
+ * \brief OptionDialog::get_Translation
+ * \param translation receives the translation along x, y and z
+ */
+void OptionDialog::get_Translation(double translation[3])
+{
+    translation[0] = ui->translateX->value();
+    translation[1] = ui->translateY->value();
+    translation[2] = ui->translateZ->value();
+}
+
+/*!
+ * \brief OptionDialog::get_Rotation
+ * \param rotation receives the rotation about x, y and z in degrees
+ */
+void OptionDialog::get_Rotation(double rotation[3])
+{
+    rotation[0] = ui->rotateX->value();
+    rotation[1] = ui->rotateY->value();
+    rotation[2] = ui->rotateZ->value();
+}
+
+/*!
+ * \brief OptionDialog::get_Scale
+ * \return the uniform scale factor
+ */
+double OptionDialog::get_Scale()
+{
+    return ui->scaleBox->value();
+}
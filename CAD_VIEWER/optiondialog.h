@@ -43,6 +43,11 @@ public:
 
     float getSize();
 
+    void set_Transform(const double translation[3], const double rotation[3], double scale);
+    void get_Translation(double translation[3]);
+    void get_Rotation(double rotation[3]);
+    double get_Scale();
+
 
 private slots:
     void on_lineEdit_editingFinished();